@@ -14,4 +14,5 @@ if( NOT XRDCEPH_SUBMODULE )
 endif()
 
 define_default( ENABLE_TESTS    FALSE )
+define_default( ENABLE_BENCHMARKS FALSE )
 define_default( ENABLE_CEPH     TRUE )
@@ -5,6 +5,7 @@ set( TRUE_VAR TRUE )
 component_status( CEPH     TRUE_VAR        CEPH_FOUND )
 component_status( XROOTD   TRUE_VAR        XROOTD_FOUND )
 component_status( TESTS    BUILD_TESTS     CPPUNIT_FOUND )
+component_status( BENCH    ENABLE_BENCHMARKS TRUE_VAR )
 
 message( STATUS "----------------------------------------" )
 message( STATUS "Installation path: " ${CMAKE_INSTALL_PREFIX} )
@@ -16,4 +17,5 @@ message( STATUS "" )
 message( STATUS "CEPH:              " ${STATUS_CEPH} )
 message( STATUS "XRootD:            " ${STATUS_XROOTD} )
 message( STATUS "Tests:             " ${STATUS_TESTS} )
+message( STATUS "Benchmarks:        " ${STATUS_BENCH} )
 message( STATUS "----------------------------------------" )
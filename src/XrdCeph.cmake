@@ -15,11 +15,18 @@ set( XRD_CEPH_POSIX_SOVERSION 0 )
 add_library(
   XrdCephPosix
   SHARED
-  XrdCeph/XrdCephPosix.cc     XrdCeph/XrdCephPosix.hh )
+  XrdCeph/XrdCephPosix.cc        XrdCeph/XrdCephPosix.hh
+  XrdCeph/XrdCephBackend.cc      XrdCeph/XrdCephBackend.hh
+  XrdCeph/XrdCephMemBackend.cc   XrdCeph/XrdCephMemBackend.hh
+  XrdCeph/XrdCephFaultBackend.cc XrdCeph/XrdCephFaultBackend.hh
+  XrdCeph/XrdCephTrace.cc        XrdCeph/XrdCephTrace.hh
+  XrdCeph/XrdCephFdTable.cc      XrdCeph/XrdCephFdTable.hh
+  XrdCeph/XrdCephRegistry.cc     XrdCeph/XrdCephRegistry.hh
+  XrdCeph/XrdCephAffinity.cc     XrdCeph/XrdCephAffinity.hh )
 
 # needed during the transition between ceph giant and ceph hammer
 # for object listing API
-set_property(SOURCE XrdCeph/XrdCephPosix.cc
+set_property(SOURCE XrdCeph/XrdCephBackend.cc
   PROPERTY COMPILE_FLAGS " -Wno-deprecated-declarations")
 
 target_link_libraries(
@@ -0,0 +1,179 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <algorithm>
+#include <sstream>
+#include "XrdCeph/XrdCephAffinity.hh"
+
+/// parses a cpu list as found in /sys, e.g. "0-7,16-23"
+static void parseCpuList(const char *list, std::vector<unsigned int> &cpus) {
+  const char *p = list;
+  while (*p) {
+    char *end;
+    unsigned long first = strtoul(p, &end, 10);
+    if (end == p) break;
+    unsigned long last = first;
+    p = end;
+    if ('-' == *p) {
+      last = strtoul(p + 1, &end, 10);
+      p = end;
+    }
+    for (unsigned long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+      cpus.push_back(cpu);
+    }
+    if (',' != *p) break;
+    p++;
+  }
+}
+
+/// reads the cpus of each NUMA node, empty if the topology is not available
+static void readNumaNodes(std::vector<std::vector<unsigned int> > &nodes) {
+  const char *root = "/sys/devices/system/node";
+  DIR *dir = opendir(root);
+  if (0 == dir) return;
+  std::vector<unsigned int> ids;
+  while (struct dirent *entry = readdir(dir)) {
+    char *end;
+    if (strncmp(entry->d_name, "node", 4)) continue;
+    unsigned long id = strtoul(entry->d_name + 4, &end, 10);
+    if (end != entry->d_name + 4 && 0 == *end) ids.push_back(id);
+  }
+  closedir(dir);
+  std::sort(ids.begin(), ids.end());
+  for (std::vector<unsigned int>::const_iterator it = ids.begin(); it != ids.end(); it++) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/node%u/cpulist", root, *it);
+    FILE *f = fopen(path, "r");
+    if (0 == f) continue;
+    char list[4096];
+    std::vector<unsigned int> cpus;
+    if (fgets(list, sizeof(list), f)) parseCpuList(list, cpus);
+    fclose(f);
+    if (!cpus.empty()) nodes.push_back(cpus);
+  }
+}
+
+XrdCephAffinity::XrdCephAffinity() :
+  m_mode(CEPH_AFFINITY_NONE), m_nbConnections(0), m_nbGroups(1) {
+  memset(m_groupOfCpu, 0, sizeof(m_groupOfCpu));
+}
+
+void XrdCephAffinity::init(XrdCephAffinityMode mode, unsigned int nbConnections) {
+  {
+    XrdSysMutexHelper lock(m_mutex);
+    if (mode == m_mode && nbConnections == m_nbConnections) return;
+  }
+  std::vector<std::vector<unsigned int> > nodes;
+  if (CEPH_AFFINITY_NONE != mode) readNumaNodes(nodes);
+  init(mode, nbConnections, nodes);
+}
+
+void XrdCephAffinity::init(XrdCephAffinityMode mode, unsigned int nbConnections,
+                           const std::vector<std::vector<unsigned int> > &nodes) {
+  XrdSysMutexHelper lock(m_mutex);
+  m_mode = mode;
+  m_nbConnections = nbConnections;
+  m_nbGroups = 1;
+  memset(m_groupOfCpu, 0, sizeof(m_groupOfCpu));
+  m_groupCpus.clear();
+  if (CEPH_AFFINITY_NONE == mode || 0 == nbConnections) return;
+  // only keep the cpus the process may run on
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed)) {
+    for (unsigned int cpu = 0; cpu < CPU_SETSIZE; cpu++) CPU_SET(cpu, &allowed);
+  }
+  std::vector<std::vector<unsigned int> > usable;
+  for (std::vector<std::vector<unsigned int> >::const_iterator node = nodes.begin(); node != nodes.end(); node++) {
+    std::vector<unsigned int> cpus;
+    for (std::vector<unsigned int>::const_iterator cpu = node->begin(); cpu != node->end(); cpu++) {
+      if (*cpu < CPU_SETSIZE && CPU_ISSET(*cpu, &allowed)) cpus.push_back(*cpu);
+    }
+    if (!cpus.empty()) usable.push_back(cpus);
+  }
+  if (usable.empty()) {
+    // no NUMA information, a single node with all allowed cpus
+    std::vector<unsigned int> cpus;
+    for (unsigned int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+    }
+    usable.push_back(cpus);
+  }
+  // the units shared out between groups are nodes or single cpus
+  std::vector<std::vector<unsigned int> > units;
+  if (CEPH_AFFINITY_NUMA == mode) {
+    units = usable;
+  } else {
+    for (std::vector<std::vector<unsigned int> >::const_iterator node = usable.begin(); node != usable.end(); node++) {
+      for (std::vector<unsigned int>::const_iterator cpu = node->begin(); cpu != node->end(); cpu++) {
+        units.push_back(std::vector<unsigned int>(1, *cpu));
+      }
+    }
+  }
+  if (units.empty()) return;
+  m_nbGroups = std::min<size_t>(units.size(), nbConnections);
+  m_groupCpus.resize(m_nbGroups);
+  for (unsigned int g = 0; g < m_nbGroups; g++) CPU_ZERO(&m_groupCpus[g]);
+  // consecutive units go to the same group
+  for (size_t u = 0; u < units.size(); u++) {
+    unsigned int group = u * m_nbGroups / units.size();
+    for (std::vector<unsigned int>::const_iterator cpu = units[u].begin(); cpu != units[u].end(); cpu++) {
+      m_groupOfCpu[*cpu] = group;
+      CPU_SET(*cpu, &m_groupCpus[group]);
+    }
+  }
+}
+
+bool XrdCephAffinity::cpus(unsigned int connection, cpu_set_t &set) const {
+  if (m_groupCpus.empty()) return false;
+  set = m_groupCpus[connection % m_nbGroups];
+  return true;
+}
+
+std::string XrdCephAffinity::describe() const {
+  std::ostringstream s;
+  if (m_groupCpus.empty()) return "no cpu affinity";
+  s << m_nbGroups << (CEPH_AFFINITY_NUMA == m_mode ? " NUMA groups" : " cpu groups");
+  for (unsigned int g = 0; g < m_nbGroups; g++) {
+    s << (g ? ", " : " : ") << CPU_COUNT(&m_groupCpus[g]) << " cpus";
+  }
+  return s.str();
+}
+
+XrdCephAffinityScope::XrdCephAffinityScope(const XrdCephAffinity &affinity, unsigned int connection) :
+  m_pinned(false) {
+  cpu_set_t set;
+  if (affinity.cpus(connection, set) &&
+      0 == pthread_getaffinity_np(pthread_self(), sizeof(m_saved), &m_saved)) {
+    m_pinned = (0 == pthread_setaffinity_np(pthread_self(), sizeof(set), &set));
+  }
+}
+
+XrdCephAffinityScope::~XrdCephAffinityScope() {
+  if (m_pinned) pthread_setaffinity_np(pthread_self(), sizeof(m_saved), &m_saved);
+}
@@ -0,0 +1,107 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+#ifndef _XRD_CEPH_AFFINITY_H
+#define _XRD_CEPH_AFFINITY_H
+
+#include <sched.h>
+#include <string>
+#include <vector>
+#include "XrdSys/XrdSysPthread.hh"
+
+/// ways of binding the cluster connections to the cpus of the machine
+enum XrdCephAffinityMode {
+  /// connections are shared by all threads
+  CEPH_AFFINITY_NONE,
+  /// connections are spread over the NUMA nodes
+  CEPH_AFFINITY_NUMA,
+  /// connections are spread over sets of consecutive cpus
+  CEPH_AFFINITY_CPU
+};
+
+//------------------------------------------------------------------------------
+//! Association of the cluster connections to groups of cpus.
+//!
+//! The cpus usable by the process are split into groups, NUMA nodes or sets
+//! of consecutive cpus depending on the mode, with no more groups than
+//! connections. Connection i belongs to group i % nbGroups(). A thread
+//! is local to the group of the cpu it runs on, and uses the connections of
+//! that group. The threads of a connection (messengers, finishers running
+//! the completion callbacks) are pinned to the cpus of its group, as they
+//! inherit the affinity of the thread creating the connection.
+//------------------------------------------------------------------------------
+class XrdCephAffinity {
+public:
+  XrdCephAffinity();
+
+  /// computes the groups for the given mode and number of connections, using
+  /// the NUMA topology found in /sys. Not to be called concurrently with
+  /// other methods, unless parameters are unchanged
+  void init(XrdCephAffinityMode mode, unsigned int nbConnections);
+  /// same with a given topology : the cpus of each NUMA node
+  void init(XrdCephAffinityMode mode, unsigned int nbConnections,
+            const std::vector<std::vector<unsigned int> > &nodes);
+
+  /// number of groups of cpus, 1 if the mode is CEPH_AFFINITY_NONE
+  unsigned int nbGroups() const { return m_nbGroups; }
+  /// group of the given cpu
+  unsigned int groupOfCpu(unsigned int cpu) const {
+    return cpu < CPU_SETSIZE ? m_groupOfCpu[cpu] : 0;
+  }
+  /// group local to the calling thread
+  unsigned int localGroup() const {
+    if (m_nbGroups <= 1) return 0;
+    int cpu = sched_getcpu();
+    return cpu < 0 ? 0 : groupOfCpu(cpu);
+  }
+  /// fills the cpus of the group of the given connection, returns false
+  /// if connections are not bound to cpus
+  bool cpus(unsigned int connection, cpu_set_t &set) const;
+  /// human readable description of the groups
+  std::string describe() const;
+
+private:
+  XrdSysMutex m_mutex;
+  XrdCephAffinityMode m_mode;
+  unsigned int m_nbConnections;
+  unsigned int m_nbGroups;
+  unsigned short m_groupOfCpu[CPU_SETSIZE];
+  std::vector<cpu_set_t> m_groupCpus;
+};
+
+//------------------------------------------------------------------------------
+//! Pins the calling thread to the cpus of a connection for its lifetime,
+//! the previous affinity being restored at the end of the scope
+//------------------------------------------------------------------------------
+class XrdCephAffinityScope {
+public:
+  XrdCephAffinityScope(const XrdCephAffinity &affinity, unsigned int connection);
+  ~XrdCephAffinityScope();
+  /// whether the thread could be pinned
+  bool pinned() const { return m_pinned; }
+private:
+  bool m_pinned;
+  cpu_set_t m_saved;
+};
+
+#endif // _XRD_CEPH_AFFINITY_H
@@ -0,0 +1,278 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+/*
+ * Implementation of the XrdCephBackend interface on top of librados and
+ * libradosstriper, plus the striping helpers shared by all backends.
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <radosstriper/libradosstriper.hpp>
+
+#include "XrdCeph/XrdCephBackend.hh"
+
+/// small struct carrying the user callback through a librados completion
+struct RadosAioArgs {
+  RadosAioArgs(CephAioCB *c, void *a) : cb(c), arg(a) {}
+  CephAioCB *cb;
+  void *arg;
+};
+
+static void radosAioComplete(rados_completion_t c, void *arg) {
+  RadosAioArgs *args = reinterpret_cast<RadosAioArgs*>(arg);
+  int rc = rados_aio_get_return_value(c);
+  args->cb(args->arg, rc);
+  delete args;
+}
+
+class XrdCephRadosStriper : public XrdCephStriper {
+public:
+  libradosstriper::RadosStriper m_striper;
+  int set_object_layout_stripe_count(unsigned int stripe_count) {
+    return m_striper.set_object_layout_stripe_count(stripe_count);
+  }
+  int set_object_layout_stripe_unit(unsigned int stripe_unit) {
+    return m_striper.set_object_layout_stripe_unit(stripe_unit);
+  }
+  int set_object_layout_object_size(unsigned int object_size) {
+    return m_striper.set_object_layout_object_size(object_size);
+  }
+  int stat(const std::string &soid, uint64_t *psize, time_t *pmtime) {
+    return m_striper.stat(soid, psize, pmtime);
+  }
+  int read(const std::string &soid, ceph::bufferlist *pbl, size_t len, uint64_t off) {
+    return m_striper.read(soid, pbl, len, off);
+  }
+  int write(const std::string &soid, const ceph::bufferlist &bl, size_t len, uint64_t off) {
+    return m_striper.write(soid, bl, len, off);
+  }
+  int aio_read(const std::string &soid, ceph::bufferlist *pbl, size_t len, uint64_t off,
+               CephAioCB *cb, void *arg) {
+    RadosAioArgs *args = new RadosAioArgs(cb, arg);
+    librados::AioCompletion *completion =
+      librados::Rados::aio_create_completion(args, radosAioComplete, NULL);
+    int rc = m_striper.aio_read(soid, completion, pbl, len, off);
+    // the completion never fires when the submission fails
+    if (rc < 0) delete args;
+    completion->release();
+    return rc;
+  }
+  int aio_write(const std::string &soid, const ceph::bufferlist &bl, size_t len, uint64_t off,
+                CephAioCB *cb, void *arg) {
+    RadosAioArgs *args = new RadosAioArgs(cb, arg);
+    librados::AioCompletion *completion =
+      librados::Rados::aio_create_completion(args, radosAioComplete, NULL);
+    int rc = m_striper.aio_write(soid, completion, bl, len, off);
+    if (rc < 0) delete args;
+    completion->release();
+    return rc;
+  }
+  int getxattr(const std::string &soid, const char *name, ceph::bufferlist &bl) {
+    return m_striper.getxattr(soid, name, bl);
+  }
+  int getxattrs(const std::string &soid, std::map<std::string, ceph::bufferlist> &attrset) {
+    return m_striper.getxattrs(soid, attrset);
+  }
+  int setxattr(const std::string &soid, const char *name, ceph::bufferlist &bl) {
+    return m_striper.setxattr(soid, name, bl);
+  }
+  int rmxattr(const std::string &soid, const char *name) {
+    return m_striper.rmxattr(soid, name);
+  }
+  int trunc(const std::string &soid, uint64_t size) {
+    return m_striper.trunc(soid, size);
+  }
+  int remove(const std::string &soid) {
+    return m_striper.remove(soid);
+  }
+};
+
+class XrdCephRadosObjectList : public XrdCephObjectList {
+public:
+  XrdCephRadosObjectList(librados::IoCtx &ioctx) :
+    m_ioctx(ioctx), m_iterator(ioctx.nobjects_begin()) {}
+  bool next(std::string &oid) {
+    if (m_iterator == m_ioctx.nobjects_end()) {
+      return false;
+    }
+    oid = m_iterator->get_oid();
+    m_iterator++;
+    return true;
+  }
+private:
+  librados::IoCtx &m_ioctx;
+  librados::NObjectIterator m_iterator;
+};
+
+class XrdCephRadosIoCtx : public XrdCephIoCtx {
+public:
+  librados::IoCtx m_ioctx;
+  XrdCephObjectList* list_objects() {
+    return new XrdCephRadosObjectList(m_ioctx);
+  }
+  int getxattrs(const std::string &oid, std::map<std::string, ceph::bufferlist> &attrset) {
+    return m_ioctx.getxattrs(oid, attrset);
+  }
+  int aio_read_extents(const std::string &oid, std::vector<CephObjectRead> &reads,
+                       CephAioCB *cb, void *arg) {
+    librados::ObjectReadOperation op;
+    for (std::vector<CephObjectRead>::iterator it = reads.begin(); it != reads.end(); it++) {
+      op.read(it->offset, it->length, &it->bl, &it->rval);
+    }
+    RadosAioArgs *args = new RadosAioArgs(cb, arg);
+    librados::AioCompletion *completion =
+      librados::Rados::aio_create_completion(args, radosAioComplete, NULL);
+    int rc = m_ioctx.aio_operate(oid, completion, &op, NULL);
+    if (rc < 0) delete args;
+    completion->release();
+    return rc;
+  }
+  int striper_create(XrdCephStriper **striper) {
+    XrdCephRadosStriper *s = new XrdCephRadosStriper;
+    int rc = libradosstriper::RadosStriper::striper_create(m_ioctx, &s->m_striper);
+    if (rc) {
+      delete s;
+      return rc;
+    }
+    *striper = s;
+    return 0;
+  }
+};
+
+class XrdCephRadosCluster : public XrdCephCluster {
+public:
+  int init(const char *id) {
+    return m_cluster.init(id);
+  }
+  int conf_read_file(const char *path) {
+    return m_cluster.conf_read_file(path);
+  }
+  int conf_parse_env(const char *env) {
+    return m_cluster.conf_parse_env(env);
+  }
+  int conf_set(const char *option, const char *value) {
+    return m_cluster.conf_set(option, value);
+  }
+  int conf_get(const char *option, std::string &value) {
+    return m_cluster.conf_get(option, value);
+  }
+  int connect() {
+    return m_cluster.connect();
+  }
+  void shutdown() {
+    m_cluster.shutdown();
+  }
+  int ioctx_create(const char *pool, XrdCephIoCtx **ioctx) {
+    XrdCephRadosIoCtx *io = new XrdCephRadosIoCtx;
+    int rc = m_cluster.ioctx_create(pool, io->m_ioctx);
+    if (rc) {
+      delete io;
+      return rc;
+    }
+    *ioctx = io;
+    return 0;
+  }
+  int cluster_stat(librados::cluster_stat_t &result) {
+    return m_cluster.cluster_stat(result);
+  }
+private:
+  librados::Rados m_cluster;
+};
+
+class XrdCephRadosBackend : public XrdCephBackend {
+public:
+  const char* name() { return "rados"; }
+  XrdCephCluster* newCluster() { return new XrdCephRadosCluster; }
+};
+
+XrdCephBackend* XrdCephGetRadosBackend() {
+  static XrdCephRadosBackend backend;
+  return &backend;
+}
+
+std::string ceph_object_name(const std::string &soid, unsigned long long objectNo) {
+  char suffix[18];
+  snprintf(suffix, sizeof(suffix), ".%016llx", objectNo);
+  return soid + suffix;
+}
+
+static inline bool isPow2(unsigned long long v) {
+  return v && 0 == (v & (v - 1));
+}
+
+/// quotient and remainder of a / b, with b = 1 << shift for power of two layouts
+template<bool Pow2> static inline unsigned long long layoutDiv(unsigned long long a, unsigned long long b,
+                                                             unsigned int shift) {
+  return Pow2 ? a >> shift : a / b;
+}
+template<bool Pow2> static inline unsigned long long layoutMod(unsigned long long a, unsigned long long b,
+                                                             unsigned int shift) {
+  return Pow2 ? a & (b - 1) : a % b;
+}
+
+template<bool Pow2> static void fileToExtents(unsigned int nbStripes, unsigned long long stripeUnit,
+                                              unsigned long long objectSize, uint64_t off, size_t len,
+                                              std::vector<CephObjectExtent> &extents) {
+  // same arithmetic as Striper::file_to_extents in ceph
+  unsigned long long stripesPerObject = objectSize / stripeUnit;
+  unsigned int stripeUnitShift = Pow2 ? __builtin_ctzll(stripeUnit) : 0;
+  unsigned int nbStripesShift = Pow2 ? __builtin_ctzll(nbStripes) : 0;
+  unsigned int stripesPerObjectShift = Pow2 ? __builtin_ctzll(stripesPerObject) : 0;
+  size_t done = 0;
+  while (done < len) {
+    uint64_t cur = off + done;
+    unsigned long long blockNo = layoutDiv<Pow2>(cur, stripeUnit, stripeUnitShift);
+    unsigned long long stripeNo = layoutDiv<Pow2>(blockNo, nbStripes, nbStripesShift);
+    unsigned long long stripePos = layoutMod<Pow2>(blockNo, nbStripes, nbStripesShift);
+    unsigned long long objectSetNo = layoutDiv<Pow2>(stripeNo, stripesPerObject, stripesPerObjectShift);
+    unsigned long long blockOffset = layoutMod<Pow2>(cur, stripeUnit, stripeUnitShift);
+    unsigned long long stripeInObject = layoutMod<Pow2>(stripeNo, stripesPerObject, stripesPerObjectShift);
+    size_t pieceLen = stripeUnit - blockOffset;
+    if (pieceLen > len - done) pieceLen = len - done;
+    CephObjectExtent ext;
+    ext.objectNo = (Pow2 ? objectSetNo << nbStripesShift : objectSetNo * nbStripes) + stripePos;
+    ext.offset = (Pow2 ? stripeInObject << stripeUnitShift : stripeInObject * stripeUnit) + blockOffset;
+    ext.length = pieceLen;
+    ext.bufferOffset = done;
+    // merge with the previous piece when contiguous in the same object
+    if (!extents.empty() && extents.back().objectNo == ext.objectNo &&
+        extents.back().offset + extents.back().length == ext.offset &&
+        extents.back().bufferOffset + extents.back().length == ext.bufferOffset) {
+      extents.back().length += pieceLen;
+    } else {
+      extents.push_back(ext);
+    }
+    done += pieceLen;
+  }
+}
+
+void ceph_file_to_extents(unsigned int nbStripes, unsigned long long stripeUnit,
+                          unsigned long long objectSize, uint64_t off, size_t len,
+                          std::vector<CephObjectExtent> &extents) {
+  if (isPow2(stripeUnit) && isPow2(nbStripes) && isPow2(objectSize / stripeUnit)) {
+    fileToExtents<true>(nbStripes, stripeUnit, objectSize, off, len, extents);
+  } else {
+    fileToExtents<false>(nbStripes, stripeUnit, objectSize, off, len, extents);
+  }
+}
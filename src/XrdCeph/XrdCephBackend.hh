@@ -0,0 +1,176 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+/*
+ * This interface abstracts the subset of librados and libradosstriper used by
+ * XrdCephPosix, so that the POSIX layer can run against a real ceph cluster or
+ * against a stand-in implementation (see XrdCephMemBackend.hh).
+ */
+
+#ifndef _XRD_CEPH_BACKEND_H
+#define _XRD_CEPH_BACKEND_H
+
+#include <stdint.h>
+#include <time.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <rados/librados.hpp>
+
+/// callback used by the backends to report completion of an asynchronous call
+/// rc is the return code of the operation, following librados conventions
+typedef void(CephAioCB)(void *arg, int rc);
+
+//------------------------------------------------------------------------------
+//! Striped file API, mirroring libradosstriper::RadosStriper.
+//! A striper is bound to a pool (see XrdCephIoCtx) and to a layout that is
+//! used when new files are created.
+//------------------------------------------------------------------------------
+class XrdCephStriper {
+public:
+  virtual ~XrdCephStriper() {}
+  virtual int set_object_layout_stripe_count(unsigned int stripe_count) = 0;
+  virtual int set_object_layout_stripe_unit(unsigned int stripe_unit) = 0;
+  virtual int set_object_layout_object_size(unsigned int object_size) = 0;
+  virtual int stat(const std::string &soid, uint64_t *psize, time_t *pmtime) = 0;
+  virtual int read(const std::string &soid, ceph::bufferlist *pbl, size_t len, uint64_t off) = 0;
+  virtual int write(const std::string &soid, const ceph::bufferlist &bl, size_t len, uint64_t off) = 0;
+  /// asynchronous read, cb is called with arg once pbl is filled
+  virtual int aio_read(const std::string &soid, ceph::bufferlist *pbl, size_t len, uint64_t off,
+                       CephAioCB *cb, void *arg) = 0;
+  /// asynchronous write, cb is called with arg once data are safe
+  virtual int aio_write(const std::string &soid, const ceph::bufferlist &bl, size_t len, uint64_t off,
+                        CephAioCB *cb, void *arg) = 0;
+  virtual int getxattr(const std::string &soid, const char *name, ceph::bufferlist &bl) = 0;
+  virtual int getxattrs(const std::string &soid, std::map<std::string, ceph::bufferlist> &attrset) = 0;
+  virtual int setxattr(const std::string &soid, const char *name, ceph::bufferlist &bl) = 0;
+  virtual int rmxattr(const std::string &soid, const char *name) = 0;
+  virtual int trunc(const std::string &soid, uint64_t size) = 0;
+  virtual int remove(const std::string &soid) = 0;
+};
+
+//------------------------------------------------------------------------------
+//! Iterator over the objects of a pool, mirroring librados::NObjectIterator
+//------------------------------------------------------------------------------
+class XrdCephObjectList {
+public:
+  virtual ~XrdCephObjectList() {}
+  /// fills oid with the next object name, returns false at the end of the list
+  virtual bool next(std::string &oid) = 0;
+};
+
+/// one read of a compound read operation on a rados object,
+/// mirroring librados::ObjectReadOperation::read
+struct CephObjectRead {
+  CephObjectRead() : offset(0), length(0), rval(0) {}
+  uint64_t offset;
+  size_t length;
+  /// receives the data, possibly less than length at the end of the object
+  ceph::bufferlist bl;
+  /// result of this read
+  int rval;
+};
+
+//------------------------------------------------------------------------------
+//! Access to a given pool, mirroring librados::IoCtx
+//------------------------------------------------------------------------------
+class XrdCephIoCtx {
+public:
+  virtual ~XrdCephIoCtx() {}
+  /// creates a new object list, to be deleted by the caller
+  virtual XrdCephObjectList* list_objects() = 0;
+  /// extended attributes of a rados object
+  virtual int getxattrs(const std::string &oid, std::map<std::string, ceph::bufferlist> &attrset) = 0;
+  /// asynchronous compound read of a rados object, cb is called with arg
+  /// once all reads are done. rc is -ENOENT if the object does not exist.
+  /// reads must not be touched until then
+  virtual int aio_read_extents(const std::string &oid, std::vector<CephObjectRead> &reads,
+                               CephAioCB *cb, void *arg) = 0;
+  /// creates a new striper on top of this IoCtx, to be deleted by the caller
+  /// The IoCtx must outlive the striper
+  virtual int striper_create(XrdCephStriper **striper) = 0;
+};
+
+//------------------------------------------------------------------------------
+//! Connection to a cluster, mirroring librados::Rados
+//------------------------------------------------------------------------------
+class XrdCephCluster {
+public:
+  virtual ~XrdCephCluster() {}
+  virtual int init(const char *id) = 0;
+  virtual int conf_read_file(const char *path) = 0;
+  virtual int conf_parse_env(const char *env) = 0;
+  virtual int conf_set(const char *option, const char *value) = 0;
+  /// current value of a configuration option, as understood by ceph
+  virtual int conf_get(const char *option, std::string &value) = 0;
+  virtual int connect() = 0;
+  virtual void shutdown() = 0;
+  /// creates a new IoCtx for the given pool, to be deleted by the caller
+  virtual int ioctx_create(const char *pool, XrdCephIoCtx **ioctx) = 0;
+  virtual int cluster_stat(librados::cluster_stat_t &result) = 0;
+};
+
+//------------------------------------------------------------------------------
+//! Factory of cluster connections. XrdCephPosix creates all its
+//! connections through the backend set via ceph_posix_set_backend
+//------------------------------------------------------------------------------
+class XrdCephBackend {
+public:
+  virtual ~XrdCephBackend() {}
+  virtual const char* name() = 0;
+  /// creates a new, not yet initialized, cluster connection
+  virtual XrdCephCluster* newCluster() = 0;
+};
+
+/// the backend talking to a real ceph cluster via librados/libradosstriper
+XrdCephBackend* XrdCephGetRadosBackend();
+
+//------------------------------------------------------------------------------
+// Striping helpers, following the layout conventions of libradosstriper
+//------------------------------------------------------------------------------
+
+/// names of the xattrs holding layout and size on the first object of a striped file
+#define CEPH_XATTR_LAYOUT_STRIPE_UNIT "striper.layout.stripe_unit"
+#define CEPH_XATTR_LAYOUT_STRIPE_COUNT "striper.layout.stripe_count"
+#define CEPH_XATTR_LAYOUT_OBJECT_SIZE "striper.layout.object_size"
+#define CEPH_XATTR_SIZE "striper.size"
+
+/// piece of a striped file extent that falls into a single rados object
+struct CephObjectExtent {
+  unsigned long long objectNo;   // index of the object in the striped file
+  unsigned long long offset;     // offset within the object
+  size_t length;                 // length of the piece
+  size_t bufferOffset;           // offset of the piece within the file extent
+};
+
+/// name of the objectNo-th rados object of the striped file soid
+std::string ceph_object_name(const std::string &soid, unsigned long long objectNo);
+
+/// splits the file extent [off, off+len[ into object extents, in file order.
+/// Divisions become shifts and masks when the stripe unit, stripe count and
+/// stripes per object are all powers of two
+void ceph_file_to_extents(unsigned int nbStripes, unsigned long long stripeUnit,
+                          unsigned long long objectSize, uint64_t off, size_t len,
+                          std::vector<CephObjectExtent> &extents);
+
+#endif // _XRD_CEPH_BACKEND_H
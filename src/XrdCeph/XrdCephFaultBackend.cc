@@ -0,0 +1,499 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sstream>
+
+#include "XrdCeph/XrdCephFaultBackend.hh"
+
+/// upper bound of the injected delays, in nanoseconds
+static const double g_maxDelayNs = 60e9;
+
+static inline unsigned long long nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void sleepNs(unsigned long long ns) {
+  if (0 == ns) return;
+  struct timespec ts;
+  ts.tv_sec = ns / 1000000000ULL;
+  ts.tv_nsec = ns % 1000000000ULL;
+  while (nanosleep(&ts, &ts) && EINTR == errno);
+}
+
+/// per thread random generator, seeded on first use
+static thread_local std::mt19937_64 t_rng;
+static thread_local bool t_rngSeeded = false;
+
+//------------------------------------------------------------------------------
+// Configuration parsing
+//------------------------------------------------------------------------------
+
+/// splits s on the given separator
+static std::vector<std::string> split(const std::string &s, char sep) {
+  std::vector<std::string> res;
+  std::stringstream ss(s);
+  std::string item;
+  while (std::getline(ss, item, sep)) res.push_back(item);
+  return res;
+}
+
+/// converts s to a non negative double, returns false if invalid
+static bool toDouble(const std::string &s, double &value) {
+  if (s.empty()) return false;
+  char *end;
+  value = strtod(s.c_str(), &end);
+  return *end == 0 && value >= 0;
+}
+
+static bool toULL(const std::string &s, unsigned long long &value) {
+  if (s.empty() || s[0] == '-') return false;
+  char *end;
+  value = strtoull(s.c_str(), &end, 10);
+  return *end == 0;
+}
+
+bool XrdCephFaultDelay::parse(const std::string &spec) {
+  std::vector<std::string> parts = split(spec, ':');
+  if (parts.empty()) return false;
+  const std::string &kindName = parts[0];
+  unsigned int nbParams = 1;
+  if (kindName == "fixed") kind = FIXED;
+  else if (kindName == "exp") kind = EXP;
+  else if (kindName == "uniform") { kind = UNIFORM; nbParams = 2; }
+  else if (kindName == "lognormal") { kind = LOGNORMAL; nbParams = 2; }
+  else if (kindName == "pareto") { kind = PARETO; nbParams = 2; }
+  else return false;
+  if (parts.size() != nbParams + 1) return false;
+  if (!toDouble(parts[1], a)) return false;
+  b = 0;
+  if (nbParams > 1 && !toDouble(parts[2], b)) return false;
+  if (kind == UNIFORM && b < a) return false;
+  if ((kind == LOGNORMAL || kind == PARETO) && (a <= 0 || b <= 0)) return false;
+  return true;
+}
+
+unsigned long long XrdCephFaultDelay::draw(std::mt19937_64 &rng) const {
+  double us = 0;
+  switch (kind) {
+  case NONE:
+    return 0;
+  case FIXED:
+    us = a;
+    break;
+  case UNIFORM:
+    us = std::uniform_real_distribution<double>(a, b)(rng);
+    break;
+  case EXP:
+    if (a > 0) us = std::exponential_distribution<double>(1.0 / a)(rng);
+    break;
+  case LOGNORMAL:
+    us = std::lognormal_distribution<double>(log(a), b)(rng);
+    break;
+  case PARETO: {
+    // inverse transform sampling, u in ]0, 1]
+    double u = 1.0 - std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+    us = a / pow(u, 1.0 / b);
+    break;
+  }
+  }
+  double ns = us * 1000;
+  return (unsigned long long)(ns < g_maxDelayNs ? ns : g_maxDelayNs);
+}
+
+static bool parseErrorCode(const std::string &s, int &code) {
+  if (s == "ETIMEDOUT") code = -ETIMEDOUT;
+  else if (s == "EIO") code = -EIO;
+  else if (s == "EBLOCKLISTED") code = -EBLOCKLISTED;
+  else {
+    unsigned long long value;
+    if (!toULL(s, value) || 0 == value) return false;
+    code = -(int)value;
+  }
+  return true;
+}
+
+/// parses a <class>.<setting>=value entry
+static bool parseOpSetting(XrdCephFaultOpConfig &op, const std::string &setting, const std::string &value) {
+  if (setting == "latency") {
+    return op.latency.parse(value);
+  } else if (setting == "tail") {
+    size_t at = value.rfind('@');
+    if (at == std::string::npos) return false;
+    if (!toDouble(value.substr(at+1), op.tailProbability) || op.tailProbability > 1) return false;
+    return op.tail.parse(value.substr(0, at));
+  } else if (setting == "error") {
+    std::vector<std::string> parts = split(value, ':');
+    if (parts.size() != 2) return false;
+    if (!parseErrorCode(parts[0], op.error)) return false;
+    return toULL(parts[1], op.errorPeriod) && op.errorPeriod > 0;
+  }
+  return false;
+}
+
+bool XrdCephFaultConfig::parse(const std::string &spec, std::string &error) {
+  std::stringstream ss(spec);
+  std::string entry;
+  while (ss >> entry) {
+    size_t eq = entry.find('=');
+    if (eq == std::string::npos) {
+      error = "missing '=' in " + entry;
+      return false;
+    }
+    std::string key = entry.substr(0, eq);
+    std::string value = entry.substr(eq+1);
+    bool ok = false;
+    size_t dot = key.find('.');
+    std::string scope = key.substr(0, dot);
+    if (key == "seed") {
+      ok = toULL(value, seed);
+    } else if (key == "callback.delay") {
+      ok = callbackDelay.parse(value);
+    } else if (key == "callback.threads") {
+      unsigned long long n;
+      ok = toULL(value, n) && n > 0 && n <= 64;
+      if (ok) nbCallbackThreads = n;
+    } else if (scope == "pool" && dot != std::string::npos) {
+      size_t lastDot = key.rfind('.');
+      double factor;
+      ok = lastDot > dot + 1 && key.substr(lastDot+1) == "slowdown" &&
+        toDouble(value, factor) && factor >= 1;
+      if (ok) poolSlowdowns[key.substr(dot+1, lastDot-dot-1)] = factor;
+    } else if (dot != std::string::npos) {
+      std::string setting = key.substr(dot+1);
+      int first = -1, last = -1;
+      if (scope == "read") first = last = FAULT_READ;
+      else if (scope == "write") first = last = FAULT_WRITE;
+      else if (scope == "meta") first = last = FAULT_META;
+      else if (scope == "all") { first = 0; last = FAULT_NB_OP_CLASSES - 1; }
+      ok = first >= 0;
+      for (int i = first; ok && i <= last; i++) {
+        ok = parseOpSetting(ops[i], setting, value);
+      }
+    }
+    if (!ok) {
+      error = "invalid fault setting " + entry;
+      return false;
+    }
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Wrappers of the backend interfaces
+//------------------------------------------------------------------------------
+
+/// an asynchronous operation in flight
+struct XrdCephFaultAio {
+  XrdCephFaultBackend *backend;
+  CephAioCB *cb;
+  void *arg;
+  unsigned long long start;
+  unsigned long long latency;
+  double slowdown;
+  int rc;
+};
+
+class XrdCephFaultStriper : public XrdCephStriper {
+public:
+  XrdCephFaultStriper(XrdCephFaultBackend *backend, XrdCephStriper *inner, double slowdown) :
+    m_backend(backend), m_inner(inner), m_slowdown(slowdown) {}
+  ~XrdCephFaultStriper() { delete m_inner; }
+  int set_object_layout_stripe_count(unsigned int stripe_count) {
+    return m_inner->set_object_layout_stripe_count(stripe_count);
+  }
+  int set_object_layout_stripe_unit(unsigned int stripe_unit) {
+    return m_inner->set_object_layout_stripe_unit(stripe_unit);
+  }
+  int set_object_layout_object_size(unsigned int object_size) {
+    return m_inner->set_object_layout_object_size(object_size);
+  }
+  int stat(const std::string &soid, uint64_t *psize, time_t *pmtime) {
+    return m_backend->sync(FAULT_META, m_slowdown,
+                           [&]() { return m_inner->stat(soid, psize, pmtime); });
+  }
+  int read(const std::string &soid, ceph::bufferlist *pbl, size_t len, uint64_t off) {
+    return m_backend->sync(FAULT_READ, m_slowdown,
+                           [&]() { return m_inner->read(soid, pbl, len, off); });
+  }
+  int write(const std::string &soid, const ceph::bufferlist &bl, size_t len, uint64_t off) {
+    return m_backend->sync(FAULT_WRITE, m_slowdown,
+                           [&]() { return m_inner->write(soid, bl, len, off); });
+  }
+  int aio_read(const std::string &soid, ceph::bufferlist *pbl, size_t len, uint64_t off,
+               CephAioCB *cb, void *arg) {
+    return m_backend->aio(FAULT_READ, m_slowdown, cb, arg,
+                          [&](CephAioCB *innerCb, void *innerArg) {
+                            return m_inner->aio_read(soid, pbl, len, off, innerCb, innerArg);
+                          });
+  }
+  int aio_write(const std::string &soid, const ceph::bufferlist &bl, size_t len, uint64_t off,
+                CephAioCB *cb, void *arg) {
+    return m_backend->aio(FAULT_WRITE, m_slowdown, cb, arg,
+                          [&](CephAioCB *innerCb, void *innerArg) {
+                            return m_inner->aio_write(soid, bl, len, off, innerCb, innerArg);
+                          });
+  }
+  int getxattr(const std::string &soid, const char *name, ceph::bufferlist &bl) {
+    return m_backend->sync(FAULT_META, m_slowdown,
+                           [&]() { return m_inner->getxattr(soid, name, bl); });
+  }
+  int getxattrs(const std::string &soid, std::map<std::string, ceph::bufferlist> &attrset) {
+    return m_backend->sync(FAULT_META, m_slowdown,
+                           [&]() { return m_inner->getxattrs(soid, attrset); });
+  }
+  int setxattr(const std::string &soid, const char *name, ceph::bufferlist &bl) {
+    return m_backend->sync(FAULT_META, m_slowdown,
+                           [&]() { return m_inner->setxattr(soid, name, bl); });
+  }
+  int rmxattr(const std::string &soid, const char *name) {
+    return m_backend->sync(FAULT_META, m_slowdown,
+                           [&]() { return m_inner->rmxattr(soid, name); });
+  }
+  int trunc(const std::string &soid, uint64_t size) {
+    return m_backend->sync(FAULT_META, m_slowdown,
+                           [&]() { return m_inner->trunc(soid, size); });
+  }
+  int remove(const std::string &soid) {
+    return m_backend->sync(FAULT_META, m_slowdown,
+                           [&]() { return m_inner->remove(soid); });
+  }
+private:
+  XrdCephFaultBackend *m_backend;
+  XrdCephStriper *m_inner;
+  double m_slowdown;
+};
+
+class XrdCephFaultIoCtx : public XrdCephIoCtx {
+public:
+  XrdCephFaultIoCtx(XrdCephFaultBackend *backend, XrdCephIoCtx *inner, double slowdown) :
+    m_backend(backend), m_inner(inner), m_slowdown(slowdown) {}
+  ~XrdCephFaultIoCtx() { delete m_inner; }
+  XrdCephObjectList* list_objects() {
+    // listings cannot fail in the interface, only delay them
+    XrdCephObjectList *list = 0;
+    m_backend->sync(FAULT_META, m_slowdown, [&]() { list = m_inner->list_objects(); return 0; });
+    return list;
+  }
+  int getxattrs(const std::string &oid, std::map<std::string, ceph::bufferlist> &attrset) {
+    return m_backend->sync(FAULT_META, m_slowdown,
+                           [&]() { return m_inner->getxattrs(oid, attrset); });
+  }
+  int aio_read_extents(const std::string &oid, std::vector<CephObjectRead> &reads,
+                       CephAioCB *cb, void *arg) {
+    return m_backend->aio(FAULT_READ, m_slowdown, cb, arg,
+                          [&](CephAioCB *innerCb, void *innerArg) {
+                            return m_inner->aio_read_extents(oid, reads, innerCb, innerArg);
+                          });
+  }
+  int striper_create(XrdCephStriper **striper) {
+    XrdCephStriper *inner;
+    int rc = m_inner->striper_create(&inner);
+    if (rc) return rc;
+    *striper = new XrdCephFaultStriper(m_backend, inner, m_slowdown);
+    return 0;
+  }
+private:
+  XrdCephFaultBackend *m_backend;
+  XrdCephIoCtx *m_inner;
+  double m_slowdown;
+};
+
+class XrdCephFaultCluster : public XrdCephCluster {
+public:
+  XrdCephFaultCluster(XrdCephFaultBackend *backend, XrdCephCluster *inner) :
+    m_backend(backend), m_inner(inner) {}
+  ~XrdCephFaultCluster() { delete m_inner; }
+  int init(const char *id) { return m_inner->init(id); }
+  int conf_read_file(const char *path) { return m_inner->conf_read_file(path); }
+  int conf_parse_env(const char *env) { return m_inner->conf_parse_env(env); }
+  int conf_set(const char *option, const char *value) { return m_inner->conf_set(option, value); }
+  int conf_get(const char *option, std::string &value) { return m_inner->conf_get(option, value); }
+  int connect() { return m_inner->connect(); }
+  void shutdown() { m_inner->shutdown(); }
+  int ioctx_create(const char *pool, XrdCephIoCtx **ioctx) {
+    XrdCephIoCtx *inner;
+    int rc = m_inner->ioctx_create(pool, &inner);
+    if (rc) return rc;
+    *ioctx = new XrdCephFaultIoCtx(m_backend, inner, m_backend->slowdown(pool));
+    return 0;
+  }
+  int cluster_stat(librados::cluster_stat_t &result) {
+    return m_backend->sync(FAULT_META, 1.0, [&]() { return m_inner->cluster_stat(result); });
+  }
+private:
+  XrdCephFaultBackend *m_backend;
+  XrdCephCluster *m_inner;
+};
+
+//------------------------------------------------------------------------------
+// The backend itself
+//------------------------------------------------------------------------------
+
+XrdCephFaultBackend::XrdCephFaultBackend(XrdCephBackend *inner, const XrdCephFaultConfig &config) :
+  m_inner(inner), m_config(config), m_name(std::string("faulty ") + inner->name()),
+  m_nbThreads(0), m_pendingCond(0), m_stopping(false) {
+  for (unsigned int i = 0; i < FAULT_NB_OP_CLASSES; i++) m_nbOps[i] = 0;
+  for (unsigned int i = 0; i < m_config.nbCallbackThreads; i++) {
+    pthread_t tid;
+    if (0 == XrdSysThread::Run(&tid, XrdCephFaultBackend::callbackThread, this,
+                               XRDSYSTHREAD_HOLD, "ceph fault backend callbacks")) {
+      m_threads.push_back(tid);
+    }
+  }
+}
+
+XrdCephFaultBackend::~XrdCephFaultBackend() {
+  // pending completions are delivered right away
+  m_pendingCond.Lock();
+  m_stopping = true;
+  m_pendingCond.Broadcast();
+  m_pendingCond.UnLock();
+  for (std::vector<pthread_t>::const_iterator it = m_threads.begin(); it != m_threads.end(); it++) {
+    XrdSysThread::Join(*it, 0);
+  }
+}
+
+XrdCephCluster* XrdCephFaultBackend::newCluster() {
+  return new XrdCephFaultCluster(this, m_inner->newCluster());
+}
+
+double XrdCephFaultBackend::slowdown(const std::string &pool) const {
+  std::map<std::string, double>::const_iterator it = m_config.poolSlowdowns.find(pool);
+  return it == m_config.poolSlowdowns.end() ? 1.0 : it->second;
+}
+
+int XrdCephFaultBackend::nextError(XrdCephFaultOpClass opClass) {
+  const XrdCephFaultOpConfig &op = m_config.ops[opClass];
+  unsigned long long n = ++m_nbOps[opClass];
+  if (op.errorPeriod && 0 == n % op.errorPeriod) return op.error;
+  return 0;
+}
+
+std::mt19937_64& XrdCephFaultBackend::rng() {
+  if (!t_rngSeeded) {
+    t_rng.seed(m_config.seed * 1000003ULL + m_nbThreads++);
+    t_rngSeeded = true;
+  }
+  return t_rng;
+}
+
+unsigned long long XrdCephFaultBackend::drawLatency(XrdCephFaultOpClass opClass) {
+  const XrdCephFaultOpConfig &op = m_config.ops[opClass];
+  unsigned long long latency = op.latency.draw(rng());
+  if (op.tailProbability > 0 &&
+      std::uniform_real_distribution<double>(0.0, 1.0)(rng()) < op.tailProbability) {
+    latency += op.tail.draw(rng());
+  }
+  return latency;
+}
+
+template<typename F>
+int XrdCephFaultBackend::sync(XrdCephFaultOpClass opClass, double slowdown, F op) {
+  unsigned long long start = nowNs();
+  int rc = nextError(opClass);
+  if (0 == rc) rc = op();
+  // the slowdown stretches the real duration of the call as well
+  unsigned long long elapsed = nowNs() - start;
+  sleepNs(drawLatency(opClass) * slowdown + elapsed * (slowdown - 1));
+  return rc;
+}
+
+template<typename F>
+int XrdCephFaultBackend::aio(XrdCephFaultOpClass opClass, double slowdown,
+                             CephAioCB *cb, void *arg, F submit) {
+  XrdCephFaultAio *aio = new XrdCephFaultAio;
+  aio->backend = this;
+  aio->cb = cb;
+  aio->arg = arg;
+  aio->start = nowNs();
+  aio->latency = drawLatency(opClass) * slowdown;
+  aio->slowdown = slowdown;
+  int rc = nextError(opClass);
+  if (rc) {
+    // the error is reported asynchronously, as a real failure would be
+    schedule(aio, rc);
+    return 0;
+  }
+  rc = submit(XrdCephFaultBackend::innerAioComplete, aio);
+  if (rc < 0) delete aio;
+  return rc;
+}
+
+void XrdCephFaultBackend::innerAioComplete(void *arg, int rc) {
+  XrdCephFaultAio *aio = (XrdCephFaultAio*)arg;
+  aio->backend->schedule(aio, rc);
+}
+
+void XrdCephFaultBackend::schedule(XrdCephFaultAio *aio, int rc) {
+  unsigned long long now = nowNs();
+  unsigned long long due = now + aio->latency + (now - aio->start) * (aio->slowdown - 1);
+  aio->rc = rc;
+  XrdSysCondVarHelper lock(m_pendingCond);
+  m_pending.insert(std::make_pair(due, aio));
+  m_pendingCond.Signal();
+}
+
+void* XrdCephFaultBackend::callbackThread(void *arg) {
+  ((XrdCephFaultBackend*)arg)->deliverCallbacks();
+  return 0;
+}
+
+void XrdCephFaultBackend::deliverCallbacks() {
+  m_pendingCond.Lock();
+  while (true) {
+    if (m_pending.empty()) {
+      if (m_stopping) break;
+      m_pendingCond.Wait();
+      continue;
+    }
+    std::multimap<unsigned long long, XrdCephFaultAio*>::iterator it = m_pending.begin();
+    unsigned long long now = nowNs();
+    if (it->first > now && !m_stopping) {
+      unsigned long long remaining = it->first - now;
+      if (remaining >= 1000000) {
+        m_pendingCond.WaitMS(remaining / 1000000);
+      } else {
+        m_pendingCond.UnLock();
+        sleepNs(remaining);
+        m_pendingCond.Lock();
+      }
+      continue;
+    }
+    XrdCephFaultAio *aio = it->second;
+    m_pending.erase(it);
+    m_pendingCond.UnLock();
+    if (!m_stopping) {
+      sleepNs(m_config.callbackDelay.draw(rng()));
+    }
+    aio->cb(aio->arg, aio->rc);
+    delete aio;
+    m_pendingCond.Lock();
+  }
+  m_pendingCond.UnLock();
+}
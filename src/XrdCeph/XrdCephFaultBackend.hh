@@ -0,0 +1,166 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+#ifndef _XRD_CEPH_FAULT_BACKEND_H
+#define _XRD_CEPH_FAULT_BACKEND_H
+
+#include <errno.h>
+#include <atomic>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include "XrdSys/XrdSysPthread.hh"
+#include "XrdCeph/XrdCephBackend.hh"
+
+/// error returned by ceph to a client that was blocklisted by the monitors
+#ifndef EBLOCKLISTED
+#define EBLOCKLISTED ESHUTDOWN
+#endif
+
+/// classes of operations with their own fault settings
+enum XrdCephFaultOpClass {
+  FAULT_READ = 0,   // read, aio_read
+  FAULT_WRITE,      // write, aio_write
+  FAULT_META,       // stat, xattrs, trunc, remove, listing, cluster stat
+  FAULT_NB_OP_CLASSES
+};
+
+//------------------------------------------------------------------------------
+//! Random delay, in microseconds. Syntax is one of
+//!   fixed:<us>, uniform:<minUs>:<maxUs>, exp:<meanUs>,
+//!   lognormal:<medianUs>:<sigma>, pareto:<minUs>:<alpha>
+//! pareto with alpha close to 1 gives heavy tails.
+//! Drawn values are capped to one minute.
+//------------------------------------------------------------------------------
+struct XrdCephFaultDelay {
+  enum Kind { NONE, FIXED, UNIFORM, EXP, LOGNORMAL, PARETO };
+  XrdCephFaultDelay() : kind(NONE), a(0), b(0) {}
+  /// returns false if the syntax is invalid
+  bool parse(const std::string &spec);
+  /// draws a delay, in nanoseconds
+  unsigned long long draw(std::mt19937_64 &rng) const;
+  Kind kind;
+  double a;
+  double b;
+};
+
+/// fault settings of a class of operations
+struct XrdCephFaultOpConfig {
+  XrdCephFaultOpConfig() : tailProbability(0), error(0), errorPeriod(0) {}
+  /// latency added to every operation
+  XrdCephFaultDelay latency;
+  /// additional latency added with probability tailProbability
+  XrdCephFaultDelay tail;
+  double tailProbability;
+  /// error (negative errno) returned by every errorPeriod-th operation
+  int error;
+  unsigned long long errorPeriod;
+};
+
+//------------------------------------------------------------------------------
+//! Settings of the fault injection backend, given as a space separated list
+//! of key=value entries :
+//!   <class>.latency=<delay>         latency added to each operation
+//!   <class>.tail=<delay>@<prob>     extra latency with probability prob
+//!   <class>.error=<code>:<period>   every period-th operation fails with code,
+//!                                   one of ETIMEDOUT, EIO, EBLOCKLISTED or
+//!                                   an errno value
+//!   pool.<name>.slowdown=<factor>   operations on the pool take factor times
+//!                                   longer, injected latencies included
+//!   callback.delay=<delay>          delay before delivering each aio
+//!                                   completion, stalling the ones behind it
+//!   callback.threads=<n>            number of completion threads, default 1
+//!   seed=<n>                        seed of the random generators
+//! where class is one of read, write, meta or all.
+//! e.g. "read.latency=lognormal:500:0.5 read.tail=pareto:20000:1.2@0.01
+//!       all.error=ETIMEDOUT:10000 pool.slowpool.slowdown=5"
+//------------------------------------------------------------------------------
+struct XrdCephFaultConfig {
+  XrdCephFaultConfig() : nbCallbackThreads(1), seed(0) {}
+  /// parses the given settings, returns false and fills error in case of problem
+  bool parse(const std::string &spec, std::string &error);
+  XrdCephFaultOpConfig ops[FAULT_NB_OP_CLASSES];
+  std::map<std::string, double> poolSlowdowns;
+  XrdCephFaultDelay callbackDelay;
+  unsigned int nbCallbackThreads;
+  unsigned long long seed;
+};
+
+struct XrdCephFaultAio;
+
+//------------------------------------------------------------------------------
+//! Backend wrapping another one and injecting latencies and errors.
+//!
+//! Synchronous calls sleep in the calling thread. Asynchronous calls are
+//! forwarded right away and their completions are held back until their
+//! injected latency has elapsed, then delivered by dedicated completion
+//! threads, the way librados' finisher delivers them. A slow callback delivery
+//! thus delays all completions behind it, as a stalled finisher would.
+//! Injected errors never reach the wrapped backend.
+//------------------------------------------------------------------------------
+class XrdCephFaultBackend : public XrdCephBackend {
+public:
+  /// the wrapped backend is not owned
+  XrdCephFaultBackend(XrdCephBackend *inner, const XrdCephFaultConfig &config);
+  virtual ~XrdCephFaultBackend();
+  virtual const char* name() { return m_name.c_str(); }
+  virtual XrdCephCluster* newCluster();
+
+  /// slowdown factor of the given pool
+  double slowdown(const std::string &pool) const;
+  /// runs a synchronous operation with faults injected
+  template<typename F> int sync(XrdCephFaultOpClass opClass, double slowdown, F op);
+  /// runs an asynchronous operation with faults injected. submit is called
+  /// with the callback and argument to be given to the wrapped backend
+  template<typename F> int aio(XrdCephFaultOpClass opClass, double slowdown,
+                               CephAioCB *cb, void *arg, F submit);
+
+private:
+  /// returns the error to be injected in the next operation, 0 if none
+  int nextError(XrdCephFaultOpClass opClass);
+  /// random generator of the calling thread
+  std::mt19937_64& rng();
+  /// draws the injected latency of an operation, in nanoseconds
+  unsigned long long drawLatency(XrdCephFaultOpClass opClass);
+  /// completion of the wrapped asynchronous operations
+  static void innerAioComplete(void *arg, int rc);
+  /// queues a completion for delivery
+  void schedule(XrdCephFaultAio *aio, int rc);
+  static void* callbackThread(void *arg);
+  void deliverCallbacks();
+
+  XrdCephBackend *m_inner;
+  XrdCephFaultConfig m_config;
+  std::string m_name;
+  std::atomic<unsigned long long> m_nbOps[FAULT_NB_OP_CLASSES];
+  std::atomic<unsigned long long> m_nbThreads;
+  /// completions waiting for delivery, by due time
+  XrdSysCondVar m_pendingCond;
+  std::multimap<unsigned long long, XrdCephFaultAio*> m_pending;
+  bool m_stopping;
+  std::vector<pthread_t> m_threads;
+};
+
+#endif // _XRD_CEPH_FAULT_BACKEND_H
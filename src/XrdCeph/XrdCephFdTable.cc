@@ -0,0 +1,165 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+#include <errno.h>
+#include <new>
+
+#include "XrdCeph/XrdCephFdTable.hh"
+
+/// shard of the free lists used by the calling thread
+static unsigned int freeListShard() {
+  static std::atomic<unsigned int> nextShard(0);
+  static thread_local unsigned int shard = nextShard++ % CEPH_FD_NB_SHARDS;
+  return shard;
+}
+
+XrdCephFdTable::XrdCephFdTable() : m_next(0) {
+  for (unsigned int i = 0; i < CEPH_FD_NB_CHUNKS; i++) {
+    m_chunks[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+XrdCephFdTable::~XrdCephFdTable() {
+  for (unsigned int i = 0; i < CEPH_FD_NB_CHUNKS; i++) {
+    delete m_chunks[i].load(std::memory_order_relaxed);
+  }
+}
+
+int XrdCephFdTable::popFree(unsigned int shard) {
+  FreeList &freeList = m_freeLists[shard];
+  XrdSysMutexHelper lock(freeList.mutex);
+  if (freeList.fds.empty()) return -1;
+  int fd = freeList.fds.back();
+  freeList.fds.pop_back();
+  return fd;
+}
+
+bool XrdCephFdTable::ensureChunk(int fd) {
+  std::atomic<Chunk*> &chunk = m_chunks[fd >> CEPH_FD_CHUNK_BITS];
+  if (chunk.load(std::memory_order_acquire)) return true;
+  XrdSysMutexHelper lock(m_growMutex);
+  if (chunk.load(std::memory_order_relaxed)) return true;
+  Chunk *newChunk = new(std::nothrow) Chunk;
+  if (0 == newChunk) return false;
+  for (unsigned int i = 0; i < CEPH_FD_CHUNK_SIZE; i++) {
+    newChunk->slots[i].store(0, std::memory_order_relaxed);
+  }
+  chunk.store(newChunk, std::memory_order_release);
+  return true;
+}
+
+int XrdCephFdTable::insert(CephFileRef *fr) {
+  unsigned int shard = freeListShard();
+  int fd = popFree(shard);
+  // steal from the other threads before growing the table
+  for (unsigned int i = 1; fd < 0 && i < CEPH_FD_NB_SHARDS; i++) {
+    fd = popFree((shard + i) % CEPH_FD_NB_SHARDS);
+  }
+  if (fd < 0) {
+    unsigned int next = m_next.load(std::memory_order_relaxed);
+    do {
+      if (next >= CEPH_FD_MAX) return -EMFILE;
+    } while (!m_next.compare_exchange_weak(next, next + 1, std::memory_order_relaxed));
+    fd = next;
+    if (!ensureChunk(fd)) {
+      // give the descriptor back for a later attempt
+      FreeList &freeList = m_freeLists[shard];
+      XrdSysMutexHelper lock(freeList.mutex);
+      freeList.fds.push_back(fd);
+      return -ENOMEM;
+    }
+  }
+  m_chunks[fd >> CEPH_FD_CHUNK_BITS].load(std::memory_order_relaxed)
+    ->slots[fd & (CEPH_FD_CHUNK_SIZE - 1)].store(fr, std::memory_order_release);
+  return fd;
+}
+
+CephFileRef* XrdCephFdTable::remove(int fd) {
+  if (fd < 0 || fd >= CEPH_FD_MAX) return 0;
+  Chunk *chunk = m_chunks[fd >> CEPH_FD_CHUNK_BITS].load(std::memory_order_acquire);
+  if (0 == chunk) return 0;
+  CephFileRef *fr = chunk->slots[fd & (CEPH_FD_CHUNK_SIZE - 1)].exchange(0, std::memory_order_acq_rel);
+  if (fr) {
+    FreeList &freeList = m_freeLists[freeListShard()];
+    XrdSysMutexHelper lock(freeList.mutex);
+    freeList.fds.push_back(fd);
+  }
+  return fr;
+}
+
+void XrdCephNameSet::insert(const std::string &name) {
+  Shard &s = shard(name);
+  XrdSysMutexHelper lock(s.mutex);
+  Entry &entry = s.entries[name];
+  entry.writers++;
+  entry.generation++;
+}
+
+void XrdCephNameSet::erase(const std::string &name) {
+  Shard &s = shard(name);
+  XrdSysMutexHelper lock(s.mutex);
+  std::unordered_map<std::string, Entry>::iterator it = s.entries.find(name);
+  if (it == s.entries.end() || 0 == it->second.writers) return;
+  if (0 == --it->second.writers && 0 == it->second.watchers) {
+    s.entries.erase(it);
+  }
+}
+
+bool XrdCephNameSet::contains(const std::string &name) {
+  Shard &s = shard(name);
+  XrdSysMutexHelper lock(s.mutex);
+  std::unordered_map<std::string, Entry>::const_iterator it = s.entries.find(name);
+  return it != s.entries.end() && it->second.writers;
+}
+
+void XrdCephNameSet::written(const std::string &name) {
+  Shard &s = shard(name);
+  XrdSysMutexHelper lock(s.mutex);
+  std::unordered_map<std::string, Entry>::iterator it = s.entries.find(name);
+  if (it != s.entries.end()) it->second.generation++;
+}
+
+unsigned long long XrdCephNameSet::watch(const std::string &name) {
+  Shard &s = shard(name);
+  XrdSysMutexHelper lock(s.mutex);
+  Entry &entry = s.entries[name];
+  entry.watchers++;
+  return entry.generation;
+}
+
+void XrdCephNameSet::unwatch(const std::string &name) {
+  Shard &s = shard(name);
+  XrdSysMutexHelper lock(s.mutex);
+  std::unordered_map<std::string, Entry>::iterator it = s.entries.find(name);
+  if (it == s.entries.end() || 0 == it->second.watchers) return;
+  if (0 == --it->second.watchers && 0 == it->second.writers) {
+    s.entries.erase(it);
+  }
+}
+
+bool XrdCephNameSet::writtenSince(const std::string &name, unsigned long long generation) {
+  Shard &s = shard(name);
+  XrdSysMutexHelper lock(s.mutex);
+  std::unordered_map<std::string, Entry>::const_iterator it = s.entries.find(name);
+  return it == s.entries.end() || it->second.writers || it->second.generation != generation;
+}
@@ -0,0 +1,135 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+#ifndef _XRD_CEPH_FD_TABLE_H
+#define _XRD_CEPH_FD_TABLE_H
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "XrdSys/XrdSysPthread.hh"
+
+struct CephFileRef;
+
+/// file descriptors are allocated by chunks of CEPH_FD_CHUNK_SIZE slots
+#define CEPH_FD_CHUNK_BITS 10
+#define CEPH_FD_CHUNK_SIZE (1 << CEPH_FD_CHUNK_BITS)
+#define CEPH_FD_NB_CHUNKS 1024
+/// maximum number of files open at the same time
+#define CEPH_FD_MAX (CEPH_FD_CHUNK_SIZE * CEPH_FD_NB_CHUNKS)
+/// number of shards of the free lists and of the open for write set
+#define CEPH_FD_NB_SHARDS 16
+
+//------------------------------------------------------------------------------
+//! Table of the open files, indexed by file descriptor.
+//!
+//! Lookups are lock free : slots live in chunks that are allocated on demand
+//! and only freed with the table, so a slot address never changes.
+//! Released file descriptors are recycled, most recently released first, so
+//! the table stays dense. They are kept in per thread sharded free lists, a
+//! thread taking descriptors from the other shards before growing the table.
+//! As before, the table does not protect a CephFileRef from its deletion
+//! by a concurrent close.
+//------------------------------------------------------------------------------
+class XrdCephFdTable {
+public:
+  XrdCephFdTable();
+  ~XrdCephFdTable();
+
+  /// returns the file associated to fd, 0 if none
+  CephFileRef* get(int fd) const {
+    if (fd < 0 || fd >= CEPH_FD_MAX) return 0;
+    Chunk *chunk = m_chunks[fd >> CEPH_FD_CHUNK_BITS].load(std::memory_order_acquire);
+    if (0 == chunk) return 0;
+    return chunk->slots[fd & (CEPH_FD_CHUNK_SIZE - 1)].load(std::memory_order_acquire);
+  }
+  /// associates a file descriptor to the given file and returns it,
+  /// or -EMFILE if the table is full
+  int insert(CephFileRef *fr);
+  /// releases a file descriptor and returns the file it was associated to,
+  /// 0 if none. The file is not deleted
+  CephFileRef* remove(int fd);
+  /// number of file descriptors ever used, i.e. the highest one + 1
+  unsigned int size() const { return std::min(m_next.load(std::memory_order_relaxed), (unsigned int)CEPH_FD_MAX); }
+
+private:
+  struct Chunk {
+    std::atomic<CephFileRef*> slots[CEPH_FD_CHUNK_SIZE];
+  };
+  struct alignas(64) FreeList {
+    XrdSysMutex mutex;
+    std::vector<int> fds;
+  };
+  /// pops a released file descriptor from the given shard, -1 if none
+  int popFree(unsigned int shard);
+  /// makes sure the chunk holding fd exists, returns false on allocation failure
+  bool ensureChunk(int fd);
+
+  std::atomic<Chunk*> m_chunks[CEPH_FD_NB_CHUNKS];
+  /// next never used file descriptor
+  std::atomic<unsigned int> m_next;
+  XrdSysMutex m_growMutex;
+  FreeList m_freeLists[CEPH_FD_NB_SHARDS];
+};
+
+//------------------------------------------------------------------------------
+//! Multiset of names, sharded by hash of the name, used to remember the
+//! files currently open for write.
+//! Readers caching the size of a file watch its name, so that they notice
+//! writers coming and going : each write open or path based change of a
+//! watched name bumps its write generation
+//------------------------------------------------------------------------------
+class XrdCephNameSet {
+public:
+  void insert(const std::string &name);
+  /// removes one occurrence of name, if any
+  void erase(const std::string &name);
+  bool contains(const std::string &name);
+  /// bumps the write generation of name if it is watched
+  void written(const std::string &name);
+  /// starts watching name, returning its current write generation
+  unsigned long long watch(const std::string &name);
+  void unwatch(const std::string &name);
+  /// whether name is open for write or was written since its write
+  /// generation was the given one. Only valid while watching it
+  bool writtenSince(const std::string &name, unsigned long long generation);
+private:
+  struct Entry {
+    Entry() : writers(0), watchers(0), generation(0) {}
+    unsigned int writers;
+    unsigned int watchers;
+    unsigned long long generation;
+  };
+  struct alignas(64) Shard {
+    XrdSysMutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+  };
+  Shard& shard(const std::string &name) {
+    return m_shards[std::hash<std::string>()(name) % CEPH_FD_NB_SHARDS];
+  }
+  Shard m_shards[CEPH_FD_NB_SHARDS];
+};
+
+#endif // _XRD_CEPH_FD_TABLE_H
@@ -0,0 +1,571 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <set>
+#include <sstream>
+
+#include "XrdCeph/XrdCephMemBackend.hh"
+
+/// a rados object
+struct MemObject {
+  MemObject() : mtime(0) {}
+  std::string data;
+  std::map<std::string, ceph::bufferlist> xattrs;
+  time_t mtime;
+};
+
+typedef std::map<std::string, MemObject> MemObjectDict;
+
+/// part of a pool. All objects of a given striped file live in the same shard
+struct MemShard {
+  XrdSysRWLock lock;
+  MemObjectDict objects;
+};
+
+/// layout and size of a striped file, as found in its first object
+struct MemLayout {
+  unsigned int nbStripes;
+  unsigned long long stripeUnit;
+  unsigned long long objectSize;
+  uint64_t size;
+};
+
+/// length of the ".%016x" suffix of rados objects belonging to a striped file
+static const size_t g_objectSuffixLen = 17;
+
+class XrdCephMemPool {
+public:
+  static const unsigned int NbShards = 32;
+
+  /// shard holding the objects of the given striped file
+  MemShard& shardFor(const std::string &soid) {
+    return m_shards[std::hash<std::string>()(soid) % NbShards];
+  }
+
+  /// shard holding the given rados object
+  MemShard& shardForObject(const std::string &oid) {
+    if (oid.size() > g_objectSuffixLen && oid[oid.size()-g_objectSuffixLen] == '.') {
+      return shardFor(oid.substr(0, oid.size()-g_objectSuffixLen));
+    }
+    return shardFor(oid);
+  }
+
+  MemShard& shard(unsigned int n) { return m_shards[n]; }
+
+private:
+  MemShard m_shards[NbShards];
+};
+
+static std::string toString(unsigned long long value) {
+  std::ostringstream oss;
+  oss << value;
+  return oss.str();
+}
+
+static unsigned long long xattrValue(const MemObject &obj, const char *name) {
+  std::map<std::string, ceph::bufferlist>::const_iterator it = obj.xattrs.find(name);
+  if (it == obj.xattrs.end()) return 0;
+  return strtoull(it->second.to_str().c_str(), 0, 10);
+}
+
+/// reads the layout of a striped file. Shard must be locked
+static int getLayout(MemShard &shard, const std::string &soid, MemLayout &layout) {
+  MemObjectDict::iterator it = shard.objects.find(ceph_object_name(soid, 0));
+  if (it == shard.objects.end()) {
+    return -ENOENT;
+  }
+  layout.nbStripes = xattrValue(it->second, CEPH_XATTR_LAYOUT_STRIPE_COUNT);
+  layout.stripeUnit = xattrValue(it->second, CEPH_XATTR_LAYOUT_STRIPE_UNIT);
+  layout.objectSize = xattrValue(it->second, CEPH_XATTR_LAYOUT_OBJECT_SIZE);
+  layout.size = xattrValue(it->second, CEPH_XATTR_SIZE);
+  if (0 == layout.nbStripes || 0 == layout.stripeUnit || 0 == layout.objectSize) {
+    return -EINVAL;
+  }
+  return 0;
+}
+
+static void setSize(MemShard &shard, const std::string &soid, uint64_t size) {
+  ceph::bufferlist bl;
+  bl.append(toString(size));
+  MemObject &first = shard.objects[ceph_object_name(soid, 0)];
+  first.xattrs[CEPH_XATTR_SIZE] = bl;
+  first.mtime = time(NULL);
+}
+
+/// checks whether oid is one of the objects of soid
+static bool isObjectOf(const std::string &oid, const std::string &soid) {
+  if (oid.size() != soid.size() + g_objectSuffixLen) return false;
+  if (oid.compare(0, soid.size(), soid)) return false;
+  return oid[soid.size()] == '.';
+}
+
+class XrdCephMemStriper : public XrdCephStriper {
+public:
+  XrdCephMemStriper(XrdCephMemBackend *backend, XrdCephMemPool *pool) :
+    m_backend(backend), m_pool(pool), m_nbStripes(1),
+    m_stripeUnit(4*1024*1024), m_objectSize(4*1024*1024) {}
+
+  int set_object_layout_stripe_count(unsigned int stripe_count) {
+    if (0 == stripe_count) return -EINVAL;
+    m_nbStripes = stripe_count;
+    return 0;
+  }
+
+  int set_object_layout_stripe_unit(unsigned int stripe_unit) {
+    if (0 == stripe_unit) return -EINVAL;
+    m_stripeUnit = stripe_unit;
+    return 0;
+  }
+
+  int set_object_layout_object_size(unsigned int object_size) {
+    if (0 == object_size || object_size % m_stripeUnit) return -EINVAL;
+    m_objectSize = object_size;
+    return 0;
+  }
+
+  int stat(const std::string &soid, uint64_t *psize, time_t *pmtime) {
+    MemShard &shard = m_pool->shardFor(soid);
+    XrdSysRWLockHelper lock(shard.lock);
+    MemLayout layout;
+    int rc = getLayout(shard, soid, layout);
+    if (rc) return rc;
+    *psize = layout.size;
+    *pmtime = shard.objects.find(ceph_object_name(soid, 0))->second.mtime;
+    return 0;
+  }
+
+  int read(const std::string &soid, ceph::bufferlist *pbl, size_t len, uint64_t off) {
+    MemShard &shard = m_pool->shardFor(soid);
+    XrdSysRWLockHelper lock(shard.lock);
+    MemLayout layout;
+    int rc = getLayout(shard, soid, layout);
+    if (rc) return rc;
+    if (off >= layout.size) return 0;
+    if (len > layout.size - off) len = layout.size - off;
+    if (0 == len) return 0;
+    ceph::bufferptr bp = ceph::buffer::create(len);
+    char *dest = bp.c_str();
+    memset(dest, 0, len);
+    std::vector<CephObjectExtent> extents;
+    ceph_file_to_extents(layout.nbStripes, layout.stripeUnit, layout.objectSize, off, len, extents);
+    for (std::vector<CephObjectExtent>::const_iterator it = extents.begin(); it != extents.end(); it++) {
+      MemObjectDict::const_iterator obj = shard.objects.find(ceph_object_name(soid, it->objectNo));
+      if (obj == shard.objects.end() || obj->second.data.size() <= it->offset) continue;
+      size_t avail = std::min((size_t)(obj->second.data.size() - it->offset), it->length);
+      memcpy(dest + it->bufferOffset, obj->second.data.data() + it->offset, avail);
+    }
+    // like librados, the received data replaces any buffer given by the caller
+    pbl->clear();
+    pbl->append(bp);
+    return len;
+  }
+
+  int write(const std::string &soid, const ceph::bufferlist &bl, size_t len, uint64_t off) {
+    if (len > bl.length()) return -EINVAL;
+    MemShard &shard = m_pool->shardFor(soid);
+    XrdSysRWLockHelper lock(shard.lock, false);
+    MemLayout layout;
+    int rc = getLayout(shard, soid, layout);
+    if (-ENOENT == rc) {
+      createFile(shard, soid);
+      rc = getLayout(shard, soid, layout);
+    }
+    if (rc) return rc;
+    std::vector<CephObjectExtent> extents;
+    ceph_file_to_extents(layout.nbStripes, layout.stripeUnit, layout.objectSize, off, len, extents);
+    time_t now = time(NULL);
+    for (std::vector<CephObjectExtent>::const_iterator it = extents.begin(); it != extents.end(); it++) {
+      MemObject &obj = shard.objects[ceph_object_name(soid, it->objectNo)];
+      if (obj.data.size() < it->offset + it->length) {
+        obj.data.resize(it->offset + it->length, 0);
+      }
+      bl.copy(it->bufferOffset, it->length, &obj.data[it->offset]);
+      obj.mtime = now;
+    }
+    if (off + len > layout.size) {
+      setSize(shard, soid, off + len);
+    }
+    return 0;
+  }
+
+  int aio_read(const std::string &soid, ceph::bufferlist *pbl, size_t len, uint64_t off,
+               CephAioCB *cb, void *arg) {
+    m_backend->queue([this, soid, pbl, len, off, cb, arg]() {
+        cb(arg, read(soid, pbl, len, off));
+      });
+    return 0;
+  }
+
+  int aio_write(const std::string &soid, const ceph::bufferlist &bl, size_t len, uint64_t off,
+                CephAioCB *cb, void *arg) {
+    // the bufferlist shares the underlying buffers, as librados does
+    ceph::bufferlist data(bl);
+    m_backend->queue([this, soid, data, len, off, cb, arg]() {
+        cb(arg, write(soid, data, len, off));
+      });
+    return 0;
+  }
+
+  int getxattr(const std::string &soid, const char *name, ceph::bufferlist &bl) {
+    MemShard &shard = m_pool->shardFor(soid);
+    XrdSysRWLockHelper lock(shard.lock);
+    MemObjectDict::const_iterator obj = shard.objects.find(ceph_object_name(soid, 0));
+    if (obj == shard.objects.end()) return -ENOENT;
+    std::map<std::string, ceph::bufferlist>::const_iterator it = obj->second.xattrs.find(name);
+    if (it == obj->second.xattrs.end()) return -ENODATA;
+    bl.append(it->second);
+    return it->second.length();
+  }
+
+  int getxattrs(const std::string &soid, std::map<std::string, ceph::bufferlist> &attrset) {
+    MemShard &shard = m_pool->shardFor(soid);
+    XrdSysRWLockHelper lock(shard.lock);
+    MemObjectDict::const_iterator obj = shard.objects.find(ceph_object_name(soid, 0));
+    if (obj == shard.objects.end()) return -ENOENT;
+    for (std::map<std::string, ceph::bufferlist>::const_iterator it = obj->second.xattrs.begin();
+         it != obj->second.xattrs.end();
+         it++) {
+      // internal striper attributes are hidden, as in libradosstriper
+      if (it->first.compare(0, 8, "striper.")) {
+        attrset[it->first] = it->second;
+      }
+    }
+    return 0;
+  }
+
+  int setxattr(const std::string &soid, const char *name, ceph::bufferlist &bl) {
+    MemShard &shard = m_pool->shardFor(soid);
+    XrdSysRWLockHelper lock(shard.lock, false);
+    MemObjectDict::iterator obj = shard.objects.find(ceph_object_name(soid, 0));
+    if (obj == shard.objects.end()) return -ENOENT;
+    obj->second.xattrs[name] = bl;
+    return 0;
+  }
+
+  int rmxattr(const std::string &soid, const char *name) {
+    MemShard &shard = m_pool->shardFor(soid);
+    XrdSysRWLockHelper lock(shard.lock, false);
+    MemObjectDict::iterator obj = shard.objects.find(ceph_object_name(soid, 0));
+    if (obj == shard.objects.end()) return -ENOENT;
+    if (0 == obj->second.xattrs.erase(name)) return -ENODATA;
+    return 0;
+  }
+
+  int trunc(const std::string &soid, uint64_t size) {
+    MemShard &shard = m_pool->shardFor(soid);
+    XrdSysRWLockHelper lock(shard.lock, false);
+    MemLayout layout;
+    int rc = getLayout(shard, soid, layout);
+    if (rc) return rc;
+    if (size < layout.size) {
+      // compute how much of each object is still needed
+      std::vector<CephObjectExtent> extents;
+      ceph_file_to_extents(layout.nbStripes, layout.stripeUnit, layout.objectSize, 0, size, extents);
+      std::map<unsigned long long, unsigned long long> keep;
+      for (std::vector<CephObjectExtent>::const_iterator it = extents.begin(); it != extents.end(); it++) {
+        keep[it->objectNo] = std::max(keep[it->objectNo], it->offset + it->length);
+      }
+      std::string prefix = soid + '.';
+      MemObjectDict::iterator it = shard.objects.lower_bound(prefix);
+      while (it != shard.objects.end() && !it->first.compare(0, prefix.size(), prefix)) {
+        if (!isObjectOf(it->first, soid)) {
+          it++;
+          continue;
+        }
+        unsigned long long objectNo = strtoull(it->first.c_str() + prefix.size(), 0, 16);
+        std::map<unsigned long long, unsigned long long>::const_iterator k = keep.find(objectNo);
+        if (k != keep.end()) {
+          if (it->second.data.size() > k->second) it->second.data.resize(k->second);
+          it++;
+        } else if (0 == objectNo) {
+          it->second.data.clear();
+          it++;
+        } else {
+          shard.objects.erase(it++);
+        }
+      }
+    }
+    setSize(shard, soid, size);
+    return 0;
+  }
+
+  int remove(const std::string &soid) {
+    MemShard &shard = m_pool->shardFor(soid);
+    XrdSysRWLockHelper lock(shard.lock, false);
+    MemLayout layout;
+    int rc = getLayout(shard, soid, layout);
+    if (rc) return rc;
+    std::string prefix = soid + '.';
+    MemObjectDict::iterator it = shard.objects.lower_bound(prefix);
+    while (it != shard.objects.end() && !it->first.compare(0, prefix.size(), prefix)) {
+      if (isObjectOf(it->first, soid)) {
+        shard.objects.erase(it++);
+      } else {
+        it++;
+      }
+    }
+    return 0;
+  }
+
+private:
+
+  /// creates the first object of a striped file with the striper layout. Shard must be write locked
+  void createFile(MemShard &shard, const std::string &soid) {
+    MemObject &first = shard.objects[ceph_object_name(soid, 0)];
+    first.xattrs[CEPH_XATTR_LAYOUT_STRIPE_COUNT].append(toString(m_nbStripes));
+    first.xattrs[CEPH_XATTR_LAYOUT_STRIPE_UNIT].append(toString(m_stripeUnit));
+    first.xattrs[CEPH_XATTR_LAYOUT_OBJECT_SIZE].append(toString(m_objectSize));
+    first.xattrs[CEPH_XATTR_SIZE].append(toString(0));
+    first.mtime = time(NULL);
+  }
+
+  XrdCephMemBackend *m_backend;
+  XrdCephMemPool *m_pool;
+  unsigned int m_nbStripes;
+  unsigned long long m_stripeUnit;
+  unsigned long long m_objectSize;
+};
+
+class XrdCephMemObjectList : public XrdCephObjectList {
+public:
+  XrdCephMemObjectList(XrdCephMemPool *pool) {
+    // take a snapshot of the object names
+    for (unsigned int i = 0; i < XrdCephMemPool::NbShards; i++) {
+      MemShard &shard = pool->shard(i);
+      XrdSysRWLockHelper lock(shard.lock);
+      for (MemObjectDict::const_iterator it = shard.objects.begin(); it != shard.objects.end(); it++) {
+        m_oids.push_back(it->first);
+      }
+    }
+    std::sort(m_oids.begin(), m_oids.end());
+    m_current = m_oids.begin();
+  }
+  bool next(std::string &oid) {
+    if (m_current == m_oids.end()) return false;
+    oid = *m_current;
+    m_current++;
+    return true;
+  }
+private:
+  std::vector<std::string> m_oids;
+  std::vector<std::string>::const_iterator m_current;
+};
+
+class XrdCephMemIoCtx : public XrdCephIoCtx {
+public:
+  XrdCephMemIoCtx(XrdCephMemBackend *backend, XrdCephMemPool *pool) :
+    m_backend(backend), m_pool(pool) {}
+  XrdCephObjectList* list_objects() {
+    return new XrdCephMemObjectList(m_pool);
+  }
+  int getxattrs(const std::string &oid, std::map<std::string, ceph::bufferlist> &attrset) {
+    MemShard &shard = m_pool->shardForObject(oid);
+    XrdSysRWLockHelper lock(shard.lock);
+    MemObjectDict::const_iterator obj = shard.objects.find(oid);
+    if (obj == shard.objects.end()) return -ENOENT;
+    attrset = obj->second.xattrs;
+    return 0;
+  }
+  int aio_read_extents(const std::string &oid, std::vector<CephObjectRead> &reads,
+                       CephAioCB *cb, void *arg) {
+    std::vector<CephObjectRead> *preads = &reads;
+    XrdCephMemPool *pool = m_pool;
+    m_backend->queue([pool, oid, preads, cb, arg]() {
+        MemShard &shard = pool->shardForObject(oid);
+        int rc = 0;
+        {
+          XrdSysRWLockHelper lock(shard.lock);
+          MemObjectDict::const_iterator obj = shard.objects.find(oid);
+          if (obj == shard.objects.end()) {
+            rc = -ENOENT;
+          } else {
+            const std::string &data = obj->second.data;
+            for (std::vector<CephObjectRead>::iterator it = preads->begin(); it != preads->end(); it++) {
+              if (it->offset < data.size()) {
+                it->bl.append(data.data() + it->offset, std::min(it->length, (size_t)(data.size() - it->offset)));
+              }
+              it->rval = 0;
+            }
+          }
+        }
+        cb(arg, rc);
+      });
+    return 0;
+  }
+  int striper_create(XrdCephStriper **striper) {
+    *striper = new XrdCephMemStriper(m_backend, m_pool);
+    return 0;
+  }
+private:
+  XrdCephMemBackend *m_backend;
+  XrdCephMemPool *m_pool;
+};
+
+class XrdCephMemCluster : public XrdCephCluster {
+public:
+  XrdCephMemCluster(XrdCephMemBackend *backend) : m_backend(backend), m_connected(false) {}
+  int init(const char *id) { return 0; }
+  int conf_read_file(const char *path) { return 0; }
+  int conf_parse_env(const char *env) { return 0; }
+  int conf_set(const char *option, const char *value) {
+    if (0 == *option) return -ENOENT;
+    m_conf[option] = value;
+    return 0;
+  }
+  int conf_get(const char *option, std::string &value) {
+    std::map<std::string, std::string>::const_iterator it = m_conf.find(option);
+    if (it == m_conf.end()) return -ENOENT;
+    value = it->second;
+    return 0;
+  }
+  int connect() {
+    m_connected = true;
+    return 0;
+  }
+  void shutdown() {
+    m_connected = false;
+  }
+  int ioctx_create(const char *pool, XrdCephIoCtx **ioctx) {
+    if (!m_connected) return -ENOTCONN;
+    *ioctx = new XrdCephMemIoCtx(m_backend, m_backend->getPool(pool));
+    return 0;
+  }
+  int cluster_stat(librados::cluster_stat_t &result) {
+    if (!m_connected) return -ENOTCONN;
+    m_backend->stat(result);
+    return 0;
+  }
+private:
+  XrdCephMemBackend *m_backend;
+  bool m_connected;
+  /// options set, any name is accepted
+  std::map<std::string, std::string> m_conf;
+};
+
+XrdCephMemBackend::XrdCephMemBackend(unsigned int nbAioThreads, unsigned long long capacity) :
+  m_capacity(capacity), m_jobsCond(0), m_stopping(false) {
+  for (unsigned int i = 0; i < nbAioThreads; i++) {
+    pthread_t tid;
+    if (0 == XrdSysThread::Run(&tid, XrdCephMemBackend::aioThread, this,
+                               XRDSYSTHREAD_HOLD, "ceph memory backend aio")) {
+      m_threads.push_back(tid);
+    }
+  }
+}
+
+XrdCephMemBackend::~XrdCephMemBackend() {
+  m_jobsCond.Lock();
+  m_stopping = true;
+  m_jobsCond.Broadcast();
+  m_jobsCond.UnLock();
+  for (std::vector<pthread_t>::const_iterator it = m_threads.begin(); it != m_threads.end(); it++) {
+    XrdSysThread::Join(*it, 0);
+  }
+  clear();
+}
+
+XrdCephCluster* XrdCephMemBackend::newCluster() {
+  return new XrdCephMemCluster(this);
+}
+
+void XrdCephMemBackend::clear() {
+  XrdSysMutexHelper lock(m_poolsMutex);
+  for (std::map<std::string, XrdCephMemPool*>::iterator it = m_pools.begin(); it != m_pools.end(); it++) {
+    delete it->second;
+  }
+  m_pools.clear();
+}
+
+XrdCephMemPool* XrdCephMemBackend::getPool(const std::string &name) {
+  XrdSysMutexHelper lock(m_poolsMutex);
+  std::map<std::string, XrdCephMemPool*>::iterator it = m_pools.find(name);
+  if (it != m_pools.end()) {
+    return it->second;
+  }
+  XrdCephMemPool *pool = new XrdCephMemPool;
+  m_pools[name] = pool;
+  return pool;
+}
+
+void XrdCephMemBackend::stat(librados::cluster_stat_t &result) {
+  unsigned long long used = 0, nbObjects = 0;
+  XrdSysMutexHelper lock(m_poolsMutex);
+  for (std::map<std::string, XrdCephMemPool*>::iterator it = m_pools.begin(); it != m_pools.end(); it++) {
+    for (unsigned int i = 0; i < XrdCephMemPool::NbShards; i++) {
+      MemShard &shard = it->second->shard(i);
+      XrdSysRWLockHelper shardLock(shard.lock);
+      for (MemObjectDict::const_iterator obj = shard.objects.begin(); obj != shard.objects.end(); obj++) {
+        used += obj->second.data.size();
+        nbObjects++;
+      }
+    }
+  }
+  result.kb = m_capacity / 1024;
+  result.kb_used = used / 1024;
+  result.kb_avail = used < m_capacity ? (m_capacity - used) / 1024 : 0;
+  result.num_objects = nbObjects;
+}
+
+void XrdCephMemBackend::queue(const std::function<void()> &job) {
+  m_jobsCond.Lock();
+  if (m_threads.empty()) {
+    // no aio thread available, complete inline
+    m_jobsCond.UnLock();
+    job();
+    return;
+  }
+  m_jobs.push_back(job);
+  m_jobsCond.Signal();
+  m_jobsCond.UnLock();
+}
+
+void* XrdCephMemBackend::aioThread(void *arg) {
+  ((XrdCephMemBackend*)arg)->processJobs();
+  return 0;
+}
+
+void XrdCephMemBackend::processJobs() {
+  m_jobsCond.Lock();
+  while (true) {
+    while (m_jobs.empty() && !m_stopping) {
+      m_jobsCond.Wait();
+    }
+    if (m_jobs.empty()) break;
+    std::function<void()> job = m_jobs.front();
+    m_jobs.pop_front();
+    m_jobsCond.UnLock();
+    job();
+    m_jobsCond.Lock();
+  }
+  m_jobsCond.UnLock();
+}
+
+XrdCephBackend* XrdCephGetMemBackend() {
+  static XrdCephMemBackend backend;
+  return &backend;
+}
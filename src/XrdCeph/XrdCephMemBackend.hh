@@ -0,0 +1,83 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+#ifndef _XRD_CEPH_MEM_BACKEND_H
+#define _XRD_CEPH_MEM_BACKEND_H
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include "XrdSys/XrdSysPthread.hh"
+#include "XrdCeph/XrdCephBackend.hh"
+
+class XrdCephMemPool;
+
+//------------------------------------------------------------------------------
+//! In-process, in-memory stand-in for a ceph cluster.
+//!
+//! Striped files are stored the way libradosstriper stores them : data are
+//! split into rados objects named <file>.<16 hex digits object number> and the
+//! layout and size live in xattrs of the first object. Thus the object level
+//! view (e.g. directory listing) is consistent with the striper level one.
+//! Pools are created on first use and are shared by all cluster connections
+//! created from the same backend instance.
+//! Asynchronous calls are completed by a small pool of threads, as librados
+//! would do with its finisher threads.
+//------------------------------------------------------------------------------
+class XrdCephMemBackend : public XrdCephBackend {
+public:
+  XrdCephMemBackend(unsigned int nbAioThreads = 4,
+                    unsigned long long capacity = 1ULL << 40);
+  virtual ~XrdCephMemBackend();
+  virtual const char* name() { return "memory"; }
+  virtual XrdCephCluster* newCluster();
+
+  /// drops all pools and all objects
+  void clear();
+  /// returns the given pool, creating it if needed
+  XrdCephMemPool* getPool(const std::string &name);
+  /// fills the cluster statistics
+  void stat(librados::cluster_stat_t &result);
+  /// queues a job for the aio threads
+  void queue(const std::function<void()> &job);
+
+private:
+  static void* aioThread(void *arg);
+  void processJobs();
+
+  XrdSysMutex m_poolsMutex;
+  std::map<std::string, XrdCephMemPool*> m_pools;
+  unsigned long long m_capacity;
+  XrdSysCondVar m_jobsCond;
+  std::deque<std::function<void()> > m_jobs;
+  bool m_stopping;
+  std::vector<pthread_t> m_threads;
+};
+
+/// process wide instance of the memory backend, used by the ceph.backend directive
+XrdCephBackend* XrdCephGetMemBackend();
+
+#endif // _XRD_CEPH_MEM_BACKEND_H
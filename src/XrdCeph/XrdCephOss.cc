@@ -24,9 +24,16 @@
 
 #include <stdio.h>
 #include <string>
+#include <vector>
 #include <fcntl.h>
 
 #include "XrdCeph/XrdCephPosix.hh"
+#include "XrdCeph/XrdCephBackend.hh"
+#include "XrdCeph/XrdCephMemBackend.hh"
+#include "XrdCeph/XrdCephFaultBackend.hh"
+#include "XrdCeph/XrdCephTrace.hh"
+#include "XrdCeph/XrdCephRegistry.hh"
+#include "XrdCeph/XrdCephAffinity.hh"
 #include "XrdOuc/XrdOucEnv.hh"
 #include "XrdSys/XrdSysError.hh"
 #include "XrdOuc/XrdOucTrace.hh"
@@ -84,16 +91,46 @@ extern "C"
   }
 }
 
-XrdCephOss::XrdCephOss(const char *configfn, XrdSysError &Eroute) {
+XrdCephOss::XrdCephOss(const char *configfn, XrdSysError &Eroute) : m_faultBackend(0) {
   Configure(configfn, Eroute);
 }
 
 XrdCephOss::~XrdCephOss() {
+  ceph_posix_trace_stop();
   ceph_posix_disconnect_all();
+  if (m_faultBackend) {
+    ceph_posix_set_backend(XrdCephGetRadosBackend());
+    delete m_faultBackend;
+  }
 }
 
 // declared and used in XrdCephPosix.cc
 extern unsigned int g_maxCephPoolIdx;
+extern unsigned int g_maxCephStripers;
+extern unsigned int g_maxCephLayouts;
+extern XrdCephConnectionPolicy g_cephConnectionPolicy;
+extern XrdCephAffinityMode g_cephAffinityMode;
+extern unsigned int g_cephClassNbConnections[CEPH_NB_CONNECTION_CLASSES];
+extern unsigned long long g_cephReadSplitSize;
+extern unsigned long long g_cephWriteSplitSize;
+extern bool g_cephDirectRead;
+
+/// connection class of the given name, -1 if unknown
+static int connectionClass(const char *name) {
+  static const char *classNames[CEPH_NB_CONNECTION_CLASSES] = {"read", "write", "metadata", "bulk"};
+  for (unsigned int c = 0; c < CEPH_NB_CONNECTION_CLASSES; c++) {
+    if (!strcmp(name, classNames[c])) return c;
+  }
+  return -1;
+}
+
+/// a ceph.option entry of the configuration file
+struct CephOssOption {
+  int connClass;
+  std::string key;
+  std::string value;
+};
+
 int XrdCephOss::Configure(const char *configfn, XrdSysError &Eroute) {
    int NoGo = 0;
    XrdOucEnv myEnv;
@@ -107,6 +144,15 @@ int XrdCephOss::Configure(const char *configfn, XrdSysError &Eroute) {
        return 1;
      }
      Config.Attach(cfgFD);
+     // backend to be used and fault injection settings, applied at the end
+     XrdCephBackend *backend = XrdCephGetRadosBackend();
+     XrdCephFaultConfig faultConfig;
+     bool withFaults = false;
+     // connections made upfront, with the ioctxs and stripers of some pools
+     bool preconnect = false;
+     std::string preconnectPools;
+     // librados options, set once the backend is known
+     std::vector<CephOssOption> options;
      // Now start reading records until eof.
      char *var;
      while((var = Config.GetMyFirstWord())) {
@@ -125,6 +171,275 @@ int XrdCephOss::Configure(const char *configfn, XrdSysError &Eroute) {
            return 1;
          }
        }
+       if (!strncmp(var, "ceph.maxstripers", 16)) {
+         var = Config.GetWord();
+         if (var) {
+           char *end;
+           unsigned long value = strtoul(var, &end, 10);
+           if (*end == 0 and value <= 100000) {
+             g_maxCephStripers = value;
+           } else {
+             Eroute.Emsg("Config", "Invalid value for ceph.maxstripers in config file (must be between 0 and 100000)", configfn, var);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.maxstripers in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.maxlayouts", 15)) {
+         var = Config.GetWord();
+         if (var) {
+           char *end;
+           unsigned long value = strtoul(var, &end, 10);
+           if (*end == 0 and value <= 100000) {
+             g_maxCephLayouts = value;
+           } else {
+             Eroute.Emsg("Config", "Invalid value for ceph.maxlayouts in config file (must be between 0 and 100000)", configfn, var);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.maxlayouts in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.readsplit", 14)) {
+         var = Config.GetWord();
+         if (var) {
+           char *end;
+           unsigned long long value = strtoull(var, &end, 10);
+           if (*end == 0 and (value == 0 or value >= 65536)) {
+             g_cephReadSplitSize = value;
+           } else {
+             Eroute.Emsg("Config", "Invalid value for ceph.readsplit in config file (must be 0 or at least 65536)", configfn, var);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.readsplit in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.writesplit", 15)) {
+         var = Config.GetWord();
+         if (var) {
+           char *end;
+           unsigned long long value = strtoull(var, &end, 10);
+           if (*end == 0 and (value == 0 or value >= 65536)) {
+             g_cephWriteSplitSize = value;
+           } else {
+             Eroute.Emsg("Config", "Invalid value for ceph.writesplit in config file (must be 0 or at least 65536)", configfn, var);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.writesplit in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.connectionpolicy", 21)) {
+         var = Config.GetWord();
+         if (var) {
+           if (!strcmp(var, "roundrobin")) {
+             g_cephConnectionPolicy = CEPH_CONN_ROUND_ROBIN;
+           } else if (!strcmp(var, "leastoutstanding")) {
+             g_cephConnectionPolicy = CEPH_CONN_LEAST_OUTSTANDING;
+           } else if (!strcmp(var, "poweroftwo")) {
+             g_cephConnectionPolicy = CEPH_CONN_POWER_OF_TWO;
+           } else {
+             Eroute.Emsg("Config", "Invalid value for ceph.connectionpolicy in config file (must be roundrobin, leastoutstanding or poweroftwo)", configfn, var);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.connectionpolicy in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.connectionclass", 20)) {
+         var = Config.GetWord();
+         if (var) {
+           int connClass = connectionClass(var);
+           if (connClass < 0) {
+             Eroute.Emsg("Config", "Invalid class for ceph.connectionclass in config file (must be read, write, metadata or bulk)", configfn, var);
+             return 1;
+           }
+           var = Config.GetWord();
+           if (var) {
+             char *end;
+             unsigned long value = strtoul(var, &end, 10);
+             if (*end == 0 and value <= 100) {
+               g_cephClassNbConnections[connClass] = value;
+             } else {
+               Eroute.Emsg("Config", "Invalid number of connections for ceph.connectionclass in config file (must be between 0 and 100)", configfn, var);
+               return 1;
+             }
+           } else {
+             Eroute.Emsg("Config", "Missing number of connections for ceph.connectionclass in config file", configfn);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.connectionclass in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.affinity", 13)) {
+         var = Config.GetWord();
+         if (var) {
+           if (!strcmp(var, "none")) {
+             g_cephAffinityMode = CEPH_AFFINITY_NONE;
+           } else if (!strcmp(var, "numa")) {
+             g_cephAffinityMode = CEPH_AFFINITY_NUMA;
+           } else if (!strcmp(var, "cpu")) {
+             g_cephAffinityMode = CEPH_AFFINITY_CPU;
+           } else {
+             Eroute.Emsg("Config", "Invalid value for ceph.affinity in config file (must be none, numa or cpu)", configfn, var);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.affinity in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.directread", 15)) {
+         var = Config.GetWord();
+         if (var) {
+           if (!strcmp(var, "on")) {
+             g_cephDirectRead = true;
+           } else if (!strcmp(var, "off")) {
+             g_cephDirectRead = false;
+           } else {
+             Eroute.Emsg("Config", "Invalid value for ceph.directread in config file (must be on or off)", configfn, var);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.directread in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.backend", 12)) {
+         var = Config.GetWord();
+         if (var) {
+           if (!strcmp(var, "rados")) {
+             backend = XrdCephGetRadosBackend();
+           } else if (!strcmp(var, "memory")) {
+             Eroute.Say("Config : using in-memory ceph backend, data will not be persistent");
+             backend = XrdCephGetMemBackend();
+           } else {
+             Eroute.Emsg("Config", "Invalid value for ceph.backend in config file (must be rados or memory)", configfn, var);
+             return 1;
+           }
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.backend in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.faults", 11)) {
+         char faults[4096];
+         if (!Config.GetRest(faults, sizeof(faults)) || !faults[0]) {
+           Eroute.Emsg("Config", "Missing or too long value for ceph.faults in config file", configfn);
+           return 1;
+         }
+         std::string error;
+         if (!faultConfig.parse(faults, error)) {
+           Eroute.Emsg("Config", "Invalid value for ceph.faults in config file :", error.c_str());
+           return 1;
+         }
+         withFaults = true;
+       }
+       if (!strncmp(var, "ceph.trace", 10)) {
+         var = Config.GetWord();
+         if (var) {
+           int rc = ceph_posix_trace_start(var);
+           if (rc) {
+             Eroute.Emsg("Config", -rc, "open trace file", var);
+             return 1;
+           }
+           Eroute.Say("Config : tracing all ceph_posix calls to ", var);
+         } else {
+           Eroute.Emsg("Config", "Missing value for ceph.trace in config file", configfn);
+           return 1;
+         }
+       }
+       if (!strncmp(var, "ceph.preconnect", 15)) {
+         // optional list of pools whose ioctxs and stripers are created upfront
+         preconnect = true;
+         while ((var = Config.GetWord())) {
+           if (!preconnectPools.empty()) preconnectPools += " ";
+           preconnectPools += var;
+         }
+         continue;
+       }
+       if (!strncmp(var, "ceph.option", 11)) {
+         // ceph.option [class=<read|write|metadata|bulk>] <key> <value>
+         int connClass = -1;
+         var = Config.GetWord();
+         if (var && !strncmp(var, "class=", 6)) {
+           connClass = connectionClass(var + 6);
+           if (connClass < 0) {
+             Eroute.Emsg("Config", "Invalid class for ceph.option in config file (must be read, write, metadata or bulk)", configfn, var);
+             return 1;
+           }
+           var = Config.GetWord();
+         }
+         if (!var) {
+           Eroute.Emsg("Config", "Missing key for ceph.option in config file", configfn);
+           return 1;
+         }
+         CephOssOption option;
+         option.connClass = connClass;
+         option.key = var;
+         var = Config.GetWord();
+         if (!var) {
+           Eroute.Emsg("Config", "Missing value for ceph.option in config file", configfn, option.key.c_str());
+           return 1;
+         }
+         option.value = var;
+         options.push_back(option);
+         if (Config.GetWord()) {
+           Eroute.Emsg("Config", "Too many values for ceph.option in config file", configfn, option.key.c_str());
+           return 1;
+         }
+         continue;
+       }
+       if (!strncmp(var, "ceph.cluster", 12)) {
+         // ceph.cluster <name> conf=<path> [keyring=<path>] [nbconnections=<n>] pools=<pool1,pool2,...>
+         var = Config.GetWord();
+         if (!var) {
+           Eroute.Emsg("Config", "Missing name for ceph.cluster in config file", configfn);
+           return 1;
+         }
+         std::string clusterName = var;
+         std::string confFile, keyring, pools;
+         unsigned long nbConnections = 1;
+         while ((var = Config.GetWord())) {
+           if (!strncmp(var, "conf=", 5)) {
+             confFile = var + 5;
+           } else if (!strncmp(var, "keyring=", 8)) {
+             keyring = var + 8;
+           } else if (!strncmp(var, "pools=", 6)) {
+             pools = var + 6;
+           } else if (!strncmp(var, "nbconnections=", 14)) {
+             char *end;
+             nbConnections = strtoul(var + 14, &end, 10);
+             if (*end != 0 || var[14] == 0 || nbConnections < 1 || nbConnections > 100) {
+               Eroute.Emsg("Config", "Invalid nbconnections for ceph.cluster in config file (must be between 1 and 100)", configfn, var);
+               return 1;
+             }
+           } else {
+             Eroute.Emsg("Config", "Invalid parameter for ceph.cluster in config file", configfn, var);
+             return 1;
+           }
+         }
+         if (confFile.empty() || pools.empty()) {
+           Eroute.Emsg("Config", "ceph.cluster needs conf= and pools= in config file", configfn, clusterName.c_str());
+           return 1;
+         }
+         int rc = ceph_posix_add_cluster(clusterName.c_str(), confFile.c_str(), keyring.c_str(),
+                                         nbConnections, pools.c_str());
+         if (rc) {
+           Eroute.Emsg("Config", -rc, "declare ceph cluster", clusterName.c_str());
+           return 1;
+         }
+         continue;
+       }
        if (!strncmp(var, "ceph.namelib", 12)) {
          var = Config.GetWord();
          if (var) {
@@ -153,6 +468,25 @@ int XrdCephOss::Configure(const char *configfn, XrdSysError &Eroute) {
                           configfn);
      }
      Config.Close();
+     if (withFaults) {
+       Eroute.Say("Config : injecting faults into ceph backend ", backend->name());
+       m_faultBackend = new XrdCephFaultBackend(backend, faultConfig);
+       backend = m_faultBackend;
+     }
+     ceph_posix_set_backend(backend);
+     for (unsigned int i = 0; i < options.size(); i++) {
+       int rc = ceph_posix_add_option(options[i].key.c_str(), options[i].value.c_str(), options[i].connClass);
+       if (rc) {
+         NoGo = Eroute.Emsg("Config", -rc, "set ceph option", options[i].key.c_str());
+       }
+     }
+     if (preconnect) {
+       // failures are not fatal, connections being retried on first use
+       int rc = ceph_posix_preconnect(preconnectPools.c_str());
+       if (rc) {
+         Eroute.Emsg("Config", -rc, "preconnect to ceph, connecting on demand");
+       }
+     }
    }
    return NoGo;
 }
@@ -28,6 +28,8 @@
 #include <string>
 #include <XrdOss/XrdOss.hh>
 
+class XrdCephBackend;
+
 //------------------------------------------------------------------------------
 //! This class implements XrdOss interface for usage with a CEPH storage.
 //! It should be loaded via the ofs.osslib directive.
@@ -71,6 +73,11 @@ public:
   virtual XrdOssDF *newDir(const char *tident);
   virtual XrdOssDF *newFile(const char *tident);
 
+private:
+
+  /// fault injection backend created by the ceph.faults directive, if any
+  XrdCephBackend *m_faultBackend;
+
 };
 
 #endif /* __CEPH_OSS_HH__ */
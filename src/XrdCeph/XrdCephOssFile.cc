@@ -36,13 +36,14 @@
 
 extern XrdSysError XrdCephEroute;
 
-XrdCephOssFile::XrdCephOssFile(XrdCephOss *cephOss) : m_fd(-1), m_cephOss(cephOss) {}
+XrdCephOssFile::XrdCephOssFile(XrdCephOss *cephOss) : m_fd(-1), m_fh(0), m_cephOss(cephOss) {}
 
 int XrdCephOssFile::Open(const char *path, int flags, mode_t mode, XrdOucEnv &env) {
   try {
     int rc = ceph_posix_open(&env, path, flags, mode);
     if (rc < 0) return rc;
     m_fd = rc;
+    m_fh = ceph_posix_get_handle(rc);
     return XrdOssOK;
   } catch (std::exception &e) {
     XrdCephEroute.Say("open : invalid syntax in file parameters");
@@ -51,6 +52,7 @@ int XrdCephOssFile::Open(const char *path, int flags, mode_t mode, XrdOucEnv &en
 }
 
 int XrdCephOssFile::Close(long long *retsz) {
+  m_fh = 0;
   return ceph_posix_close(m_fd);
 }
 
@@ -59,7 +61,8 @@ ssize_t XrdCephOssFile::Read(off_t offset, size_t blen) {
 }
 
 ssize_t XrdCephOssFile::Read(void *buff, off_t offset, size_t blen) {
-  return ceph_posix_pread(m_fd, buff, blen, offset);
+  if (0 == m_fh) return -EBADF;
+  return ceph_posix_fh_pread(m_fh, buff, blen, offset);
 }
 
 static void aioReadCallback(XrdSfsAio *aiop, size_t rc) {
@@ -68,19 +71,27 @@ static void aioReadCallback(XrdSfsAio *aiop, size_t rc) {
 }
 
 int XrdCephOssFile::Read(XrdSfsAio *aiop) {
-  return ceph_aio_read(m_fd, aiop, aioReadCallback);
+  if (0 == m_fh) return -EBADF;
+  return ceph_aio_fh_read(m_fh, aiop, aioReadCallback);
 }
 
 ssize_t XrdCephOssFile::ReadRaw(void *buff, off_t offset, size_t blen) {
   return Read(buff, offset, blen);
 }
 
+ssize_t XrdCephOssFile::ReadV(XrdOucIOVec *readV, int rdvcnt) {
+  if (0 == m_fh) return -EBADF;
+  return ceph_posix_fh_readv(m_fh, readV, rdvcnt);
+}
+
 int XrdCephOssFile::Fstat(struct stat *buff) {
-  return ceph_posix_fstat(m_fd, buff);
+  if (0 == m_fh) return -EBADF;
+  return ceph_posix_fh_fstat(m_fh, buff);
 }
 
 ssize_t XrdCephOssFile::Write(const void *buff, off_t offset, size_t blen) {
-  return ceph_posix_pwrite(m_fd, buff, blen, offset);
+  if (0 == m_fh) return -EBADF;
+  return ceph_posix_fh_pwrite(m_fh, buff, blen, offset);
 }
 
 static void aioWriteCallback(XrdSfsAio *aiop, size_t rc) {
@@ -89,7 +100,13 @@ static void aioWriteCallback(XrdSfsAio *aiop, size_t rc) {
 }
 
 int XrdCephOssFile::Write(XrdSfsAio *aiop) {
-  return ceph_aio_write(m_fd, aiop, aioWriteCallback);
+  if (0 == m_fh) return -EBADF;
+  return ceph_aio_fh_write(m_fh, aiop, aioWriteCallback);
+}
+
+ssize_t XrdCephOssFile::WriteV(XrdOucIOVec *writeV, int wrvcnt) {
+  if (0 == m_fh) return -EBADF;
+  return ceph_posix_fh_writev(m_fh, writeV, wrvcnt);
 }
 
 int XrdCephOssFile::Fsync() {
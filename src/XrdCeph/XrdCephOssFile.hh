@@ -28,6 +28,8 @@
 #include "XrdOss/XrdOss.hh"
 #include "XrdCeph/XrdCephOss.hh"
 
+struct CephFileRef;
+
 //------------------------------------------------------------------------------
 //! This class implements XrdOssDF interface for usage with a CEPH storage.
 //!
@@ -61,15 +63,19 @@ public:
   virtual ssize_t Read(void *buff, off_t offset, size_t blen);
   virtual int     Read(XrdSfsAio *aiop);
   virtual ssize_t ReadRaw(void *, off_t, size_t);
+  virtual ssize_t ReadV(XrdOucIOVec *readV, int rdvcnt);
   virtual int Fstat(struct stat *buff);
   virtual ssize_t Write(const void *buff, off_t offset, size_t blen);
   virtual int Write(XrdSfsAio *aiop);
+  virtual ssize_t WriteV(XrdOucIOVec *writeV, int wrvcnt);
   virtual int Fsync(void);
   virtual int Ftruncate(unsigned long long);
 
 private:
 
   int m_fd;
+  /// handle on the open file, sparing the file descriptor lookup on the data path
+  CephFileRef *m_fh;
   XrdCephOss *m_cephOss;
 
 };
@@ -33,22 +33,31 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <algorithm>
 #include <memory>
-#include <radosstriper/libradosstriper.hpp>
+#include <new>
 #include <map>
 #include <stdexcept>
 #include <string>
-#include <sstream>
 #include <sys/xattr.h>
 #include <time.h>
 #include <limits>
+#include <atomic>
 #include <pthread.h>
+#include <sstream>
+#include <vector>
 #include "XrdSfs/XrdSfsAio.hh"
 #include "XrdSys/XrdSysPthread.hh"
 #include "XrdOuc/XrdOucName2Name.hh"
+#include "XrdOuc/XrdOucIOVec.hh"
 #include "XrdSys/XrdSysPlatform.hh"
 
 #include "XrdCeph/XrdCephPosix.hh"
+#include "XrdCeph/XrdCephBackend.hh"
+#include "XrdCeph/XrdCephTrace.hh"
+#include "XrdCeph/XrdCephFdTable.hh"
+#include "XrdCeph/XrdCephRegistry.hh"
+#include "XrdCeph/XrdCephAffinity.hh"
 
 /// small structs to store file metadata
 struct CephFile {
@@ -58,148 +67,434 @@ struct CephFile {
   unsigned int nbStripes;
   unsigned long long stripeUnit;
   unsigned long long objectSize;
+  /// cluster serving the pool, 0 for the default one, i for g_cephClusters[i-1]
+  unsigned int cluster;
+};
+
+/// layout and size of a striped file, as recorded by libradosstriper
+/// in the xattrs of its first object
+struct CephStripedLayout {
+  unsigned int nbStripes;
+  unsigned long long stripeUnit;
+  unsigned long long objectSize;
+  unsigned long long size;
 };
 
-struct CephFileRef : CephFile {
+/// an open file. Fields are grouped by who writes them, each group starting
+/// a cache line, so that the threads submitting operations, the ones
+/// completing them and the read-mostly identity do not false-share.
+/// The statistics are updated without lock. Each one is exact but they are
+/// not consistent with each other while operations are in flight
+struct alignas(64) CephFileRef : CephFile {
+  // identity and handles, set at open time and read by every operation
+  /// file descriptor of this file
+  int fd;
+  /// ceph handles resolved at open time, pinned until close together
+  /// with the session of the connection they belong to
+  XrdCephLayoutSlot *slot;
+  XrdCephSession *session;
+  XrdCephStriper *striper;
+  XrdCephIoCtx *ioctx;
+  XrdCephCluster *cluster;
+  /// connection of the handles, on which the operations are accounted
+  unsigned int connIdx;
+  /// generation of the session of the handles, so that its errors are
+  /// ignored once a recovery replaced it
+  unsigned long long connGeneration;
+  /// class of the connections of the file, a XrdCephConnectionClass
+  int connClass;
   int flags;
   mode_t mode;
+  /// whether reads go straight to the rados objects, using the layout
+  /// and size read at open time (See ceph_direct_read). Cleared for good
+  /// once the file gets written here, as the size may then be stale
+  std::atomic<bool> directRead;
+  CephStripedLayout layout;
+  /// whether the name is watched for writers, and its write generation
+  /// when the layout was read (See XrdCephNameSet)
+  bool watchesWrites;
+  unsigned long long writeGeneration;
+
+  // written by the threads submitting operations
+  /// references held by the table of file descriptors and by the asynchronous
+  /// operations in flight. The last one released deletes the file, so that
+  /// completions never see it deleted by a close (See releaseFileRef)
+  alignas(64) std::atomic<unsigned int> nbRefs;
   uint64_t offset;
-  // This mutex protects against parallel updates of the stats.
-  XrdSysMutex statsMutex;
-  uint64_t maxOffsetWritten;
-  uint64_t bytesAsyncWritePending;
-  uint64_t bytesWritten;
-  unsigned rdcount;
-  unsigned wrcount;
-  unsigned asyncRdStartCount;
-  unsigned asyncRdCompletionCount;
-  unsigned asyncWrStartCount;
-  unsigned asyncWrCompletionCount;
-  ::timeval lastAsyncSubmission;
-  double longestAsyncWriteTime;
-  double longestCallbackInvocation;
+  std::atomic<unsigned> rdcount;
+  std::atomic<unsigned> wrcount;
+  std::atomic<unsigned> asyncRdStartCount;
+  std::atomic<unsigned> asyncWrStartCount;
+  /// time in ns, taken from the monotonic clock. 0 for no submission yet
+  std::atomic<uint64_t> lastAsyncSubmission;
+
+  // written when data is read or written back, mostly by completion threads
+  alignas(64) std::atomic<unsigned> asyncRdCompletionCount;
+  std::atomic<unsigned> asyncWrCompletionCount;
+  std::atomic<uint64_t> bytesAsyncWritePending;
+  std::atomic<uint64_t> bytesWritten;
+  std::atomic<uint64_t> maxOffsetWritten;
+
+  // diagnostics logged at close, only written when a new maximum is reached
+  /// times in ns, taken from the monotonic clock
+  alignas(64) std::atomic<uint64_t> longestAsyncWriteTime;
+  std::atomic<uint64_t> longestCallbackInvocation;
+
+  /// the alignment is not honoured by the global new before C++17
+  static void* operator new(size_t size) {
+    void *p;
+    if (posix_memalign(&p, 64, size)) throw std::bad_alloc();
+    return p;
+  }
+  static void operator delete(void *p) { free(p); }
+};
+
+/// monotonic time in ns
+static inline uint64_t nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/// copies the rc bytes read into bl to buf. libradosstriper always returns
+/// the data in buffers of its own, whatever bl held beforehand
+static inline void completeRead(ceph::bufferlist &bl, void *buf, int rc) {
+  if (rc > 0) bl.begin().copy(rc, (char*)buf);
+}
+
+/// wraps the count bytes of buf to be written into bl, without copying them.
+/// buf has to stay untouched until the write completes, which xrootd
+/// guarantees for aio as the buffer is only released in doneWrite
+static inline void prepareWrite(ceph::bufferlist &bl, const void *buf, size_t count) {
+  bl.push_back(ceph::buffer::create_static(count, (char*)buf));
+}
+
+/// raises a statistic to the given value if it is lower
+static inline void atomicMax(std::atomic<uint64_t> &stat, uint64_t value) {
+  uint64_t current = stat.load(std::memory_order_relaxed);
+  while (current < value &&
+         !stat.compare_exchange_weak(current, value, std::memory_order_relaxed));
+}
+
+/// global registry holding stripers/ioCtxs/cluster objects
+/// Note that we have a pool of them to circumvent the limitation
+/// of having a single objecter/messenger per IoCtx
+XrdCephRegistry g_cephRegistry;
+
+/// ceph handles of a file, pinned until the destruction of the object
+/// (See XrdCephRegistry.hh)
+struct CephHandles {
+  CephHandles() : slot(0), session(0), striper(0), ioctx(0), cluster(0), idx(0),
+                  generation(0), counted(false) {}
+  ~CephHandles() {
+    if (slot) slot->release();
+    if (session) g_cephRegistry.releaseSession(session);
+    if (counted) g_cephRegistry.opDone(idx, 0);
+  }
+  /// hands the pins over to the caller
+  void detach(XrdCephLayoutSlot *&s, XrdCephSession *&sess) {
+    s = slot;
+    sess = session;
+    slot = 0;
+    session = 0;
+  }
+  XrdCephLayoutSlot *slot;
+  XrdCephSession *session;
+  XrdCephStriper *striper;
+  XrdCephIoCtx *ioctx;
+  XrdCephCluster *cluster;
+  /// connection used, accounted as busy with one operation while the handles live
+  unsigned int idx;
+  /// generation of the session the handles belong to
+  unsigned long long generation;
+  bool counted;
 };
 
-/// small struct for directory listing
+/// small struct for directory listing, pinning the ioctx used by the
+/// listing and its session until closedir
 struct DirIterator {
-  librados::NObjectIterator m_iterator;
-  librados::IoCtx *m_ioctx;
+  XrdCephObjectList *m_list;
+  XrdCephLayoutSlot *m_slot;
+  XrdCephSession *m_session;
 };
 
-/// small struct for aio API callbacks
+/// small struct for aio API callbacks, holding a reference
+/// on the file until the completion is done with it
 struct AioArgs {
-  AioArgs(XrdSfsAio* a, AioCB *b, size_t n, int _fd, ceph::bufferlist *_bl=0) :
-    aiop(a), callback(b), nbBytes(n), fd(_fd), bl(_bl) { ::gettimeofday(&startTime, nullptr); }
+  AioArgs(XrdSfsAio* a, AioCB *b, size_t n, CephFileRef *_fr) :
+    aiop(a), callback(b), nbBytes(n), fr(_fr), startTime(nowNs()), traced(false) {
+    fr->nbRefs.fetch_add(1, std::memory_order_relaxed);
+  }
+  ~AioArgs();
   XrdSfsAio* aiop;
   AioCB *callback;
   size_t nbBytes;
-  int fd;
-  ::timeval startTime;
-  ceph::bufferlist *bl;
+  /// the file, whose connection the operation is accounted on
+  CephFileRef *fr;
+  /// submission time, in ns from the monotonic clock
+  uint64_t startTime;
+  /// data of reads, copied to the xrootd buffer on completion
+  ceph::bufferlist bl;
+  /// trace record of the call, completed and written when the operation completes
+  bool traced;
+  XrdCephTraceRecord traceRecord;
 };
 
-/// global variables holding stripers/ioCtxs/cluster objects
-/// Note that we have a pool of them to circumvent the limitation
-/// of having a single objecter/messenger per IoCtx
-typedef std::map<std::string, libradosstriper::RadosStriper*> StriperDict;
-std::vector<StriperDict> g_radosStripers;
-typedef std::map<std::string, librados::IoCtx*> IOCtxDict;
-std::vector<IOCtxDict> g_ioCtx;
-std::vector<librados::Rados*> g_cluster;
-/// mutex protecting the striper and ioctx maps
+/// traces the completion of an asynchronous operation
+static void traceAioCompletion(AioArgs *awa, long long result) {
+  if (awa->traced) {
+    awa->traceRecord.latency = ceph_trace_now() - awa->traceRecord.timestamp;
+    awa->traceRecord.result = result;
+    ceph_trace_record(awa->traceRecord);
+  }
+}
+
+/// gathers the completions of a group of asynchronous operations
+/// issued by a synchronous call
+struct CephAioGroup {
+  CephAioGroup() : cond(0), pending(0) {}
+  /// to be called before submitting each operation
+  void started() {
+    XrdSysCondVarHelper lock(cond);
+    pending++;
+  }
+  /// to be called by each completion, and for each failed submission
+  void done() {
+    XrdSysCondVarHelper lock(cond);
+    if (0 == --pending) cond.Signal();
+  }
+  /// waits for all operations started to be done
+  void wait() {
+    XrdSysCondVarHelper lock(cond);
+    while (pending) cond.Wait();
+  }
+  XrdSysCondVar cond;
+  unsigned int pending;
+};
+
+/// backend used to create the cluster connections, defaults to librados
+/// may be overwritten in the configuration file (See XrdCephOss::configure)
+XrdCephBackend *g_cephBackend = XrdCephGetRadosBackend();
+/// mutex serializing the creation of connections, stripers and ioctxs
+/// lookups do not take it (See XrdCephRegistry)
 XrdSysMutex g_striper_mutex;
-/// index of current Striper/IoCtx to be used
-unsigned int g_cephPoolIdx = 0;
+/// policy choosing the connection of new files and path based calls
+/// may be overwritten in the configuration file (See XrdCephOss::configure)
+XrdCephConnectionPolicy g_cephConnectionPolicy = CEPH_CONN_POWER_OF_TWO;
+/// binding of the connections to the cpus, none by default
+/// may be overwritten in the configuration file (See XrdCephOss::configure)
+XrdCephAffinityMode g_cephAffinityMode = CEPH_AFFINITY_NONE;
+/// groups of cpus of the connections (See XrdCephAffinity.hh)
+XrdCephAffinity g_cephAffinity;
+/// number of dedicated connections of each class of operations, 0 meaning
+/// that the class uses the shared ones. May be overwritten in the
+/// configuration file (See XrdCephOss::configure)
+unsigned int g_cephClassNbConnections[CEPH_NB_CONNECTION_CLASSES] = {0, 0, 0, 0};
+/// connections of each class, computed when the registry is sized
+XrdCephConnectionRange g_cephClassRanges[CEPH_NB_CONNECTION_CLASSES];
+/// mutex serializing the sizing of the registry
+XrdSysMutex g_cephSizingMutex;
+/// number of consecutive session errors (timeouts, lost connections) after
+/// which a connection is recovered. Blocklisting triggers it right away
+unsigned int g_cephMaxConnectionErrors = 5;
+/// user of each cluster connection, reused when reconnecting.
+/// Protected by g_striper_mutex
+std::string g_cephConnectionUsers[CEPH_MAX_CONNECTIONS];
+/// background recoveries : number running, and generation of the registry,
+/// bumped by ceph_posix_disconnect_all so that they give up
+XrdSysCondVar g_cephRecoveryCond(0);
+unsigned int g_cephNbRecoveries = 0;
+std::atomic<unsigned long long> g_cephGeneration(0);
+/// maximum number of stripers per connection, least recently used unused
+/// ones being evicted beyond. 0 means no limit. May be overwritten in the
+/// configuration file (See XrdCephOss::configure)
+unsigned int g_maxCephStripers = 256;
+/// maximum number of layouts in the registry, least recently used unused
+/// ones being evicted beyond, with their stripers. 0 means no limit. May be
+/// overwritten in the configuration file (See XrdCephOss::configure)
+unsigned int g_maxCephLayouts = 1024;
 /// size of the Striper/IoCtx pool, defaults to 1
 /// may be overwritten in the configuration file
 /// (See XrdCephOss::configure)
 unsigned int g_maxCephPoolIdx = 1;
+/// size above which reads are split into pieces read in parallel, each on
+/// its own connection, 0 meaning never. May be overwritten in the
+/// configuration file (See XrdCephOss::configure)
+unsigned long long g_cephReadSplitSize = 0;
+/// whether files opened for read only are read straight from their rados
+/// objects, bypassing the striper (See ceph_direct_read). May be overwritten
+/// in the configuration file (See XrdCephOss::configure)
+bool g_cephDirectRead = false;
+/// size above which writes are split in the same way, 0 meaning never.
+/// May be overwritten in the configuration file (See XrdCephOss::configure)
+unsigned long long g_cephWriteSplitSize = 0;
 /// pointer to library providing Name2Name interface. 0 be default
 /// populated in case of ceph.namelib entry in the config file in XrdCephOss
 XrdOucName2Name *g_namelib = 0;
 
+/// an additional ceph cluster, serving some pools with its own connections
+struct CephClusterConfig {
+  std::string name;
+  /// ceph configuration file and keyring, ceph defaults if empty
+  std::string confFile;
+  std::string keyring;
+  unsigned int nbConnections;
+  /// connections of the cluster, computed when the registry is sized
+  XrdCephConnectionRange range;
+};
+/// additional clusters, declared in the configuration file (See XrdCephOss::configure)
+std::vector<CephClusterConfig> g_cephClusters;
+/// cluster of each pool not served by the default cluster, as index in g_cephClusters + 1
+std::map<std::string, unsigned int> g_cephPoolClusters;
+
+/// a librados option, set on the connections before they connect
+struct CephClusterOption {
+  std::string key;
+  std::string value;
+  /// class of the connections concerned, -1 for all of them
+  int connClass;
+};
+/// librados options given in the configuration file (See XrdCephOss::configure)
+std::vector<CephClusterOption> g_cephOptions;
+
 /// global variable holding a list of files currently opened for write
-std::multiset<std::string> g_filesOpenForWrite;
-/// global variable holding a map of file descriptor to file reference
-std::map<unsigned int, CephFileRef> g_fds;
-/// global variable remembering the next available file descriptor
-unsigned int g_nextCephFd = 0;
-/// mutex protecting the map of file descriptors and the openForWrite multiset
-XrdSysMutex g_fd_mutex;
-/// mutex protecting initialization of ceph clusters
-XrdSysMutex g_init_mutex;
-
-/// Accessor to next ceph pool index
-/// Note that this is not thread safe, but we do not care
-/// as we only want a rough load balancing
-unsigned int getCephPoolIdxAndIncrease() {
-  if (g_radosStripers.size() == 0) {
-    // make sure we do not have a race condition here
-    XrdSysMutexHelper lock(g_init_mutex);
-    // double check now that we have the lock
-    if (g_radosStripers.size() == 0) {
-      // initialization phase : allocate corresponding places in the vectors
-      for (unsigned int i = 0; i < g_maxCephPoolIdx; i++) {
-        g_radosStripers.push_back(StriperDict());
-        g_ioCtx.push_back(IOCtxDict());
-        g_cluster.push_back(0);
+XrdCephNameSet g_filesOpenForWrite;
+/// global table of file descriptors to file references
+XrdCephFdTable g_fds;
+/// global variable for the log function
+static void (*g_logfunc) (char *, va_list argp) = 0;
+
+static void logwrapper(char* format, ...) {
+  if (0 == g_logfunc) return;
+  va_list arg;
+  va_start(arg, format);
+  (*g_logfunc)(format, arg);
+  va_end(arg);
+}
+
+/// sizes the pool of connections, unless already done. The shared
+/// connections of the default cluster come first, followed by the dedicated
+/// ones of each class having some, then by the ones of each additional cluster
+static void initCephPool() {
+  if (0 == g_cephRegistry.nbConnections()) {
+    XrdSysMutexHelper lock(g_cephSizingMutex);
+    if (0 == g_cephRegistry.nbConnections()) {
+      // ranges and affinity first, so that they are complete for whoever sees the registry sized
+      unsigned int nbShared = std::max(1u, std::min(g_maxCephPoolIdx, (unsigned int)CEPH_MAX_CONNECTIONS));
+      unsigned int nbConnections = nbShared;
+      for (unsigned int c = 0; c < CEPH_NB_CONNECTION_CLASSES; c++) {
+        unsigned int n = std::min(g_cephClassNbConnections[c], CEPH_MAX_CONNECTIONS - nbConnections);
+        if (n > 0) {
+          g_cephClassRanges[c].first = nbConnections;
+          g_cephClassRanges[c].count = n;
+          nbConnections += n;
+        } else {
+          g_cephClassRanges[c].first = 0;
+          g_cephClassRanges[c].count = nbShared;
+        }
+      }
+      for (std::vector<CephClusterConfig>::iterator it = g_cephClusters.begin(); it != g_cephClusters.end(); it++) {
+        it->range.first = nbConnections;
+        it->range.count = std::min(it->nbConnections, CEPH_MAX_CONNECTIONS - nbConnections);
+        if (0 == it->range.count) {
+          logwrapper((char*)"initCephPool : no connection left for cluster %s, %d connections in use",
+                     it->name.c_str(), nbConnections);
+        }
+        nbConnections += it->range.count;
       }
+      g_cephAffinity.init(g_cephAffinityMode, nbConnections);
+      g_cephRegistry.init(nbConnections);
     }
   }
-  unsigned int res = g_cephPoolIdx;
-  unsigned nextValue = g_cephPoolIdx+1;
-  if (nextValue >= g_maxCephPoolIdx) {
-    nextValue = 0;
+}
+
+/// cluster of the given connection, as in CephFile::cluster
+static unsigned int getConnectionCluster(unsigned int cephPoolIdx) {
+  for (unsigned int i = 0; i < g_cephClusters.size(); i++) {
+    const XrdCephConnectionRange &range = g_cephClusters[i].range;
+    if (cephPoolIdx >= range.first && cephPoolIdx < range.first + range.count) return i + 1;
   }
-  g_cephPoolIdx = nextValue;
-  return res;
+  return 0;
 }
 
+/// Accessor to the ceph pool index to be used for the given class of
+/// operations on the given cluster, sizing the pool on first use.
+/// The choice depends on g_cephConnectionPolicy, on the operations in
+/// flight on each connection and, with cpu affinity, on the calling thread
+/// Additional clusters do not have classes, all their connections are shared
+unsigned int getCephPoolIdx(XrdCephConnectionClass connClass, unsigned int cluster = 0) {
+  initCephPool();
+  const XrdCephConnectionRange &range =
+    (cluster && g_cephClusters[cluster-1].range.count) ? g_cephClusters[cluster-1].range : g_cephClassRanges[connClass];
+  return g_cephRegistry.pickConnection(g_cephConnectionPolicy, range.first, range.count,
+                                       g_cephAffinity.localGroup(), g_cephAffinity.nbGroups());
+}
+
+/// accounts an operation on a connection for the duration of a scope
+struct CephInflightOp {
+  CephInflightOp(unsigned int idx, unsigned long long bytes) : m_idx(idx), m_bytes(bytes) {
+    g_cephRegistry.opStarted(m_idx, m_bytes);
+  }
+  ~CephInflightOp() { g_cephRegistry.opDone(m_idx, m_bytes); }
+  unsigned int m_idx;
+  unsigned long long m_bytes;
+};
+
 /// check whether a file is open for write
 bool isOpenForWrite(std::string& name) {
-  XrdSysMutexHelper lock(g_fd_mutex);
-  return g_filesOpenForWrite.find(name) != g_filesOpenForWrite.end();
+  return g_filesOpenForWrite.contains(name);
 }
 
 /// look for a FileRef from its file descriptor
 CephFileRef* getFileRef(int fd) {
-  XrdSysMutexHelper lock(g_fd_mutex);
-  std::map<unsigned int, CephFileRef>::iterator it = g_fds.find(fd);
-  if (it != g_fds.end()) {
-    // We will release the lock upon exiting this function.
-    // The structure here is not protected from deletion, but we trust xrootd to
-    // ensure close (which does the deletion) will not be called before all previous
-    // calls are complete (including the async ones).
-    return &(it->second);
-  } else {
-    return 0;
-  }
+  // The structure here is not protected from deletion by a close of the file
+  // descriptor, but we trust xrootd to ensure close will not be called before
+  // all previous synchronous calls are complete. The async ones hold their own
+  // reference (See AioArgs)
+  return g_fds.get(fd);
 }
 
-/// deletes a FileRef from the global table of file descriptors
-void deleteFileRef(int fd, const CephFileRef &fr) {
-  XrdSysMutexHelper lock(g_fd_mutex);
-  if (fr.flags & (O_WRONLY|O_RDWR)) {
-    g_filesOpenForWrite.erase(g_filesOpenForWrite.find(fr.name));
-  }
-  std::map<unsigned int, CephFileRef>::iterator it = g_fds.find(fd);
-  if (it != g_fds.end()) {
-    g_fds.erase(it);
+/// drops a reference to a FileRef, deleting it with the last one
+static void releaseFileRef(CephFileRef *fr) {
+  if (1 == fr->nbRefs.fetch_sub(1, std::memory_order_acq_rel)) {
+    if (fr->flags & (O_WRONLY|O_RDWR)) {
+      g_filesOpenForWrite.erase(fr->name);
+    }
+    if (fr->watchesWrites) g_filesOpenForWrite.unwatch(fr->name);
+    if (fr->slot) fr->slot->release();
+    if (fr->session) g_cephRegistry.releaseSession(fr->session);
+    delete fr;
   }
 }
 
+AioArgs::~AioArgs() {
+  releaseFileRef(fr);
+}
+
+/// removes a FileRef from the global table of file descriptors, it is
+/// deleted once the asynchronous operations in flight are complete
+void deleteFileRef(int fd) {
+  CephFileRef *fr = g_fds.remove(fd);
+  if (fr) releaseFileRef(fr);
+}
+
 /**
  * inserts a new FileRef into the global table of file descriptors
- * and return the associated file descriptor
+ * and return the associated file descriptor, or a negative error.
+ * The table takes ownership of the FileRef, which is deleted on failure
  */
-int insertFileRef(CephFileRef &fr) {
-  XrdSysMutexHelper lock(g_fd_mutex);
-  g_fds[g_nextCephFd] = fr;
-  g_nextCephFd++;
-  if (fr.flags & (O_WRONLY|O_RDWR)) {
-    g_filesOpenForWrite.insert(fr.name);
+int insertFileRef(CephFileRef *fr) {
+  if (fr->flags & (O_WRONLY|O_RDWR)) {
+    g_filesOpenForWrite.insert(fr->name);
+  }
+  // the descriptor is unknown to other threads until returned, so it can be set afterwards
+  int fd = g_fds.insert(fr);
+  if (fd >= 0) {
+    fr->fd = fd;
+  } else {
+    releaseFileRef(fr);
   }
-  return g_nextCephFd-1;
+  return fd;
 }
 
 /// global variable containing defaults for CephFiles
@@ -208,22 +503,12 @@ CephFile g_defaultParams = { "",
                              "admin",          // default user
                              1,                // default nbStripes
                              4 * 1024 * 1024,  // default stripeUnit : 4 MB
-                             4 * 1024 * 1024}; // default objectSize : 4 MB
+                             4 * 1024 * 1024,  // default objectSize : 4 MB
+                             0};               // default cluster
 
 std::string g_defaultUserId = "admin";
 std::string g_defaultPool = "default";
 
-/// global variable for the log function
-static void (*g_logfunc) (char *, va_list argp) = 0;
-
-static void logwrapper(char* format, ...) {
-  if (0 == g_logfunc) return;
-  va_list arg;
-  va_start(arg, format);
-  (*g_logfunc)(format, arg);
-  va_end(arg);
-}
-
 /// simple integer parsing, to be replaced by std::stoll when C++11 can be used
 static unsigned long long int stoull(const std::string &s) {
   char* end;
@@ -375,6 +660,8 @@ void fillCephFileParams(const std::string &params, XrdOucEnv *env, CephFile &fil
   // parse the params one by one
   unsigned int afterUser = fillCephUserId(params, env, file);
   unsigned int afterPool = fillCephPool(params, afterUser, env, file);
+  std::map<std::string, unsigned int>::const_iterator cluster = g_cephPoolClusters.find(file.pool);
+  file.cluster = (cluster == g_cephPoolClusters.end()) ? 0 : cluster->second;
   unsigned int afterNbStripes = fillCephNbStripes(params, afterPool, env, file);
   unsigned int afterStripeUnit = fillCephStripeUnit(params, afterNbStripes, env, file);
   fillCephObjectSize(params, afterStripeUnit, env, file);
@@ -435,210 +722,635 @@ static CephFile getCephFile(const char *path, XrdOucEnv *env) {
   return file;
 }
 
-static CephFileRef getCephFileRef(const char *path, XrdOucEnv *env, int flags,
-                                  mode_t mode, unsigned long long offset) {
-  CephFileRef fr;
-  fillCephFile(path, env, fr);
-  fr.flags = flags;
-  fr.mode = mode;
-  fr.offset = 0;
-  fr.maxOffsetWritten = 0;
-  fr.bytesAsyncWritePending = 0;
-  fr.bytesWritten = 0;
-  fr.rdcount = 0;
-  fr.wrcount = 0;
-  fr.asyncRdStartCount = 0;
-  fr.asyncRdCompletionCount = 0;
-  fr.asyncWrStartCount = 0;
-  fr.asyncWrCompletionCount = 0;
-  fr.lastAsyncSubmission.tv_sec = 0;
-  fr.lastAsyncSubmission.tv_usec = 0;
-  fr.longestAsyncWriteTime = 0.0l;
-  fr.longestCallbackInvocation = 0.0l;
+/// allocates a new FileRef, with a single reference
+static CephFileRef* newCephFileRef(const char *path, XrdOucEnv *env, int flags,
+                                   mode_t mode, unsigned long long offset) {
+  CephFile file;
+  fillCephFile(path, env, file);
+  CephFileRef *fr = new CephFileRef;
+  static_cast<CephFile&>(*fr) = file;
+  fr->fd = -1;
+  fr->slot = 0;
+  fr->session = 0;
+  fr->striper = 0;
+  fr->ioctx = 0;
+  fr->cluster = 0;
+  fr->connIdx = 0;
+  fr->connGeneration = 0;
+  fr->connClass = CEPH_CLASS_READ;
+  fr->flags = flags;
+  fr->mode = mode;
+  fr->directRead.store(false, std::memory_order_relaxed);
+  fr->watchesWrites = false;
+  fr->writeGeneration = 0;
+  fr->offset = 0;
+  fr->nbRefs.store(1, std::memory_order_relaxed);
+  fr->maxOffsetWritten.store(0, std::memory_order_relaxed);
+  fr->bytesAsyncWritePending.store(0, std::memory_order_relaxed);
+  fr->bytesWritten.store(0, std::memory_order_relaxed);
+  fr->rdcount.store(0, std::memory_order_relaxed);
+  fr->wrcount.store(0, std::memory_order_relaxed);
+  fr->asyncRdStartCount.store(0, std::memory_order_relaxed);
+  fr->asyncRdCompletionCount.store(0, std::memory_order_relaxed);
+  fr->asyncWrStartCount.store(0, std::memory_order_relaxed);
+  fr->asyncWrCompletionCount.store(0, std::memory_order_relaxed);
+  fr->lastAsyncSubmission.store(0, std::memory_order_relaxed);
+  fr->longestAsyncWriteTime.store(0, std::memory_order_relaxed);
+  fr->longestCallbackInvocation.store(0, std::memory_order_relaxed);
   return fr;
 }
 
-inline librados::Rados* checkAndCreateCluster(unsigned int cephPoolIdx,
-                                              std::string userId = g_defaultParams.userId) {
-  if (0 == g_cluster[cephPoolIdx]) {
-    // create connection to cluster
-    librados::Rados *cluster = new librados::Rados;
-    if (0 == cluster) {
-      return 0;
-    }
-    int rc = cluster->init(userId.c_str());
-    if (rc) {
-      logwrapper((char*)"checkAndCreateCluster : cluster init failed");
-      delete cluster;
-      return 0;
+/// sets the options of g_cephOptions concerning the given connection, the
+/// ones scoped to a class after the others so that they take precedence.
+/// Class scoped options only concern the connections of the default cluster
+/// serving that class, which are the shared ones if it has no dedicated ones
+static int applyOptions(XrdCephCluster *cluster, unsigned int cephPoolIdx) {
+  bool defaultCluster = (0 == getConnectionCluster(cephPoolIdx));
+  for (unsigned int pass = 0; pass < 2; pass++) {
+    for (std::vector<CephClusterOption>::const_iterator it = g_cephOptions.begin(); it != g_cephOptions.end(); it++) {
+      if (0 == pass) {
+        if (it->connClass >= 0) continue;
+      } else {
+        if (it->connClass < 0 || !defaultCluster) continue;
+        const XrdCephConnectionRange &range = g_cephClassRanges[it->connClass];
+        if (cephPoolIdx < range.first || cephPoolIdx >= range.first + range.count) continue;
+      }
+      int rc = cluster->conf_set(it->key.c_str(), it->value.c_str());
+      if (rc) {
+        logwrapper((char*)"applyOptions : failed to set option %s to %s on connection %d, rc = %d",
+                   it->key.c_str(), it->value.c_str(), cephPoolIdx, rc);
+        return rc;
+      }
     }
-    rc = cluster->conf_read_file(NULL);
+  }
+  return 0;
+}
+
+/// connects a new cluster object for the connection of the given index
+/// Does not touch the registry, so that it can be called without lock
+static XrdCephCluster* connectCluster(unsigned int cephPoolIdx, const std::string &userId) {
+  // the threads of the connection inherit the cpus of its group, if any
+  XrdCephAffinityScope affinity(g_cephAffinity, cephPoolIdx);
+  if (affinity.pinned()) {
+    logwrapper((char*)"connectCluster : connection %d bound to group %d of %s",
+               cephPoolIdx, cephPoolIdx % g_cephAffinity.nbGroups(), g_cephAffinity.describe().c_str());
+  }
+  // create connection to cluster
+  XrdCephCluster *cluster = g_cephBackend->newCluster();
+  if (0 == cluster) {
+    return 0;
+  }
+  int rc = cluster->init(userId.c_str());
+  if (rc) {
+    logwrapper((char*)"connectCluster : cluster init failed");
+    delete cluster;
+    return 0;
+  }
+  // additional clusters have their own configuration file and keyring
+  unsigned int clusterIdx = getConnectionCluster(cephPoolIdx);
+  const CephClusterConfig *config = clusterIdx ? &g_cephClusters[clusterIdx-1] : 0;
+  rc = cluster->conf_read_file((config && !config->confFile.empty()) ? config->confFile.c_str() : NULL);
+  if (rc) {
+    logwrapper((char*)"connectCluster : cluster read config failed, rc = %d", rc);
+    cluster->shutdown();
+    delete cluster;
+    return 0;
+  }
+  cluster->conf_parse_env(NULL);
+  rc = applyOptions(cluster, cephPoolIdx);
+  if (rc) {
+    cluster->shutdown();
+    delete cluster;
+    return 0;
+  }
+  if (config && !config->keyring.empty()) {
+    rc = cluster->conf_set("keyring", config->keyring.c_str());
     if (rc) {
-      logwrapper((char*)"checkAndCreateCluster : cluster read config failed, rc = %d", rc);
+      logwrapper((char*)"connectCluster : invalid keyring %s for cluster %s, rc = %d",
+                 config->keyring.c_str(), config->name.c_str(), rc);
       cluster->shutdown();
       delete cluster;
       return 0;
     }
-    cluster->conf_parse_env(NULL);
-    rc = cluster->connect();
-    if (rc) {
-      logwrapper((char*)"checkAndCreateCluster : cluster connect failed, rc = %d", rc);
-      cluster->shutdown();
-      delete cluster;
+  }
+  rc = cluster->connect();
+  if (rc) {
+    logwrapper((char*)"connectCluster : cluster connect failed, rc = %d", rc);
+    cluster->shutdown();
+    delete cluster;
+    return 0;
+  }
+  return cluster;
+}
+
+/// creates the cluster connection of the given index if needed
+/// to be called with g_striper_mutex held
+static XrdCephCluster* checkAndCreateCluster(unsigned int cephPoolIdx,
+                                             std::string userId = g_defaultParams.userId) {
+  if (0 == g_cephRegistry.cluster(cephPoolIdx)) {
+    XrdCephCluster *cluster = connectCluster(cephPoolIdx, userId);
+    if (0 == cluster) {
+      logwrapper((char*)"checkAndCreateCluster : connection %d failed", cephPoolIdx);
       return 0;
     }
-    g_cluster[cephPoolIdx] = cluster;
+    g_cephRegistry.setCluster(cephPoolIdx, cluster);
+    g_cephConnectionUsers[cephPoolIdx] = userId;
+  }
+  return g_cephRegistry.cluster(cephPoolIdx);
+}
+
+/// returns the cluster connection of the given index, connecting if needed
+static XrdCephCluster* getCluster(unsigned int cephPoolIdx) {
+  XrdCephCluster *cluster = g_cephRegistry.cluster(cephPoolIdx);
+  if (cluster) return cluster;
+  XrdSysMutexHelper lock(g_striper_mutex);
+  return checkAndCreateCluster(cephPoolIdx);
+}
+
+/// arguments of a recovery thread
+struct RecoveryArgs {
+  unsigned int idx;
+  unsigned long long generation;
+};
+
+/**
+ * replaces the cluster connection of the given index by a new one, retrying
+ * with an exponential backoff until it succeeds or the registry is cleared.
+ * Connecting does not hold g_striper_mutex, so that other connections are
+ * not blocked. Ioctxs and stripers get recreated on first use
+ */
+static void* recoverConnection(void *arg) {
+  RecoveryArgs *args = (RecoveryArgs*)arg;
+  unsigned int delayMs = 1000;
+  while (args->generation == g_cephGeneration.load()) {
+    std::string userId;
+    {
+      XrdSysMutexHelper lock(g_striper_mutex);
+      userId = g_cephConnectionUsers[args->idx];
+    }
+    XrdCephCluster *cluster = connectCluster(args->idx, userId.empty() ? g_defaultParams.userId : userId);
+    if (cluster) {
+      XrdSysMutexHelper lock(g_striper_mutex);
+      if (args->generation == g_cephGeneration.load()) {
+        g_cephRegistry.retireConnection(args->idx);
+        g_cephRegistry.setCluster(args->idx, cluster);
+        g_cephRegistry.setHealthy(args->idx);
+        logwrapper((char*)"recoverConnection : connection %d recovered", args->idx);
+        cluster = 0;
+      }
+      lock.UnLock();
+      if (cluster) {
+        cluster->shutdown();
+        delete cluster;
+      }
+      break;
+    }
+    logwrapper((char*)"recoverConnection : reconnection %d failed, retrying in %d ms", args->idx, delayMs);
+    XrdSysCondVarHelper lock(g_cephRecoveryCond);
+    if (args->generation == g_cephGeneration.load()) g_cephRecoveryCond.WaitMS(delayMs);
+    delayMs = std::min(2 * delayMs, 60000u);
+  }
+  XrdSysCondVarHelper lock(g_cephRecoveryCond);
+  g_cephNbRecoveries--;
+  g_cephRecoveryCond.Broadcast();
+  delete args;
+  return 0;
+}
+
+/**
+ * records the result of an operation made on the session of the given
+ * generation of a connection and starts its recovery in the background when
+ * the session went bad. New operations avoid the connection in the meantime.
+ * Results of sessions already replaced are ignored. Returns the given result
+ */
+static int checkConnection(unsigned int cephPoolIdx, unsigned long long generation, int rc) {
+  if (g_cephRegistry.opResult(cephPoolIdx, generation, rc, g_cephMaxConnectionErrors)) {
+    logwrapper((char*)"checkConnection : connection %d went bad, rc = %d, reconnecting", cephPoolIdx, rc);
+    RecoveryArgs *args = new RecoveryArgs;
+    args->idx = cephPoolIdx;
+    args->generation = g_cephGeneration.load();
+    XrdSysCondVarHelper lock(g_cephRecoveryCond);
+    g_cephNbRecoveries++;
+    pthread_t tid;
+    if (XrdSysThread::Run(&tid, recoverConnection, args, 0, "ceph reconnect")) {
+      logwrapper((char*)"checkConnection : cannot start the recovery of connection %d", cephPoolIdx);
+      g_cephNbRecoveries--;
+      delete args;
+      g_cephRegistry.setHealthy(cephPoolIdx);
+    }
   }
-  return g_cluster[cephPoolIdx];
+  return rc;
 }
 
-int checkAndCreateStriper(unsigned int cephPoolIdx, std::string &userAtPool, const CephFile& file) {
-  StriperDict &sDict = g_radosStripers[cephPoolIdx];
-  StriperDict::iterator it = sDict.find(userAtPool);
-  if (it == sDict.end()) {
-    // we need to create a new radosStriper
+/**
+ * creates the striper of a layout for the given connection if needed, together
+ * with the ioctx of its pool. To be called with g_striper_mutex held
+ * Returns 0 in case of failure
+ * Note that the connection is kept on failure, as other layouts may use it
+ */
+static int checkAndCreateStriper(unsigned int cephPoolIdx, XrdCephLayout *layout, const CephFile& file) {
+  if (layout->m_slots[cephPoolIdx].m_striper.load(std::memory_order_relaxed)) {
+    return 1;
+  }
+  // create IoCtx for our pool if needed, it is shared by all layouts of the pool
+  XrdCephPoolEntry *pool = layout->m_pool;
+  XrdCephIoCtx *ioctx = pool->m_ioctxs[cephPoolIdx].load(std::memory_order_relaxed);
+  if (0 == ioctx) {
     // Get a cluster
-    librados::Rados* cluster = checkAndCreateCluster(cephPoolIdx, file.userId);
+    XrdCephCluster* cluster = checkAndCreateCluster(cephPoolIdx, file.userId);
     if (0 == cluster) {
       logwrapper((char*)"checkAndCreateStriper : checkAndCreateCluster failed");
       return 0;
     }
-    // create IoCtx for our pool
-    librados::IoCtx *ioctx = new librados::IoCtx;
-    if (0 == ioctx) {
-      logwrapper((char*)"checkAndCreateStriper : IoCtx instantiation failed");
-      cluster->shutdown();
-      delete cluster;
-      g_cluster[cephPoolIdx] = 0;
-      return 0;
-    }
-    int rc = g_cluster[cephPoolIdx]->ioctx_create(file.pool.c_str(), *ioctx);
+    int rc = cluster->ioctx_create(file.pool.c_str(), &ioctx);
     if (rc != 0) {
       logwrapper((char*)"checkAndCreateStriper : ioctx_create failed, rc = %d", rc);
-      cluster->shutdown();
-      delete cluster;
-      g_cluster[cephPoolIdx] = 0;
-      delete ioctx;
       return 0;
     }
-    // create RadosStriper connection
-    libradosstriper::RadosStriper *striper = new libradosstriper::RadosStriper;
-    if (0 == striper) {
-      logwrapper((char*)"checkAndCreateStriper : RadosStriper instantiation failed");
-      delete ioctx;
-      cluster->shutdown();
-      delete cluster;
-      g_cluster[cephPoolIdx] = 0;
-      return 0;
+    g_cephRegistry.setIoCtx(pool, cephPoolIdx, ioctx);
+  }
+  // create RadosStriper connection
+  XrdCephStriper *striper = 0;
+  int rc = ioctx->striper_create(&striper);
+  if (rc != 0) {
+    logwrapper((char*)"checkAndCreateStriper : striper_create failed, rc = %d", rc);
+    return 0;
+  }
+  // setup layout
+  rc = striper->set_object_layout_stripe_count(file.nbStripes);
+  if (rc != 0) {
+    logwrapper((char*)"checkAndCreateStriper : invalid nbStripes %d", file.nbStripes);
+    delete striper;
+    return 0;
+  }
+  rc = striper->set_object_layout_stripe_unit(file.stripeUnit);
+  if (rc != 0) {
+    logwrapper((char*)"checkAndCreateStriper : invalid stripeUnit %d (must be non 0, multiple of 64K)", file.stripeUnit);
+    delete striper;
+    return 0;
+  }
+  rc = striper->set_object_layout_object_size(file.objectSize);
+  if (rc != 0) {
+    logwrapper((char*)"checkAndCreateStriper : invalid objectSize %d (must be non 0, multiple of stripe_unit)", file.objectSize);
+    delete striper;
+    return 0;
+  }
+  XrdCephRegistryStats before;
+  g_cephRegistry.stats(before);
+  g_cephRegistry.setStriper(layout, cephPoolIdx, striper, g_maxCephStripers);
+  XrdCephRegistryStats after;
+  g_cephRegistry.stats(after);
+  if (after.nbStripersEvicted != before.nbStripersEvicted) {
+    logwrapper((char*)"checkAndCreateStriper : evicted %llu striper(s) from connection %d, "
+               "%d stripers for %d layouts, %llu evictions so far",
+               after.nbStripersEvicted - before.nbStripersEvicted, cephPoolIdx,
+               after.nbStripers, after.nbLayouts, after.nbStripersEvicted);
+  } else if (after.nbEvictionsFailed != before.nbEvictionsFailed) {
+    logwrapper((char*)"checkAndCreateStriper : all %d stripers of connection %d are in use, "
+               "going over the limit of %d", after.nbStripers, cephPoolIdx, g_maxCephStripers);
+  }
+  return 1;
+}
+
+/**
+ * resolves and pins the striper, ioctx and cluster connection to be used for
+ * the given file, together with the session they belong to. Returns 0 in
+ * case of failure
+ * Lookups of known layouts do not take any lock
+ */
+static int getCephHandles(const CephFile& file, CephHandles &handles,
+                          XrdCephConnectionClass connClass) {
+  unsigned int cephPoolIdx = getCephPoolIdx(connClass, file.cluster);
+  // the session is pinned first and checked last, so that the handles found
+  // in between belong to it unless the connection got recovered meanwhile
+  XrdCephSession *session = g_cephRegistry.acquireSession(cephPoolIdx);
+  XrdCephStriper *striper = 0;
+  XrdCephLayout *layout = g_cephRegistry.findAndAcquire(file.userId, file.pool, file.nbStripes,
+                                                        file.stripeUnit, file.objectSize,
+                                                        cephPoolIdx, striper);
+  XrdCephIoCtx *ioctx = 0;
+  XrdCephCluster *cluster = 0;
+  if (striper) {
+    ioctx = layout->m_pool->m_ioctxs[cephPoolIdx].load(std::memory_order_acquire);
+    cluster = g_cephRegistry.cluster(cephPoolIdx);
+    if (!g_cephRegistry.isCurrent(cephPoolIdx, session)) {
+      layout->m_slots[cephPoolIdx].release();
+      striper = 0;
     }
-    rc = libradosstriper::RadosStriper::striper_create(*ioctx, striper);
-    if (rc != 0) {
-      logwrapper((char*)"checkAndCreateStriper : striper_create failed, rc = %d", rc);
-      delete striper;
-      delete ioctx;
-      cluster->shutdown();
-      delete cluster;
-      g_cluster[cephPoolIdx] = 0;
-      return 0;
+  }
+  if (0 == striper) {
+    g_cephRegistry.releaseSession(session);
+    // recoveries take the lock too, everything found here belongs to the current session
+    XrdSysMutexHelper lock(g_striper_mutex);
+    while (0 == striper) {
+      layout = g_cephRegistry.findOrInsert(file.userId, file.pool, file.nbStripes,
+                                           file.stripeUnit, file.objectSize, g_maxCephLayouts);
+      if (checkAndCreateStriper(cephPoolIdx, layout, file) == 0) {
+        logwrapper((char*)"getCephHandles : checkAndCreateStriper failed");
+        return 0;
+      }
+      // pinned under the lock, so that neither the striper nor the layout
+      // can be evicted in the meantime
+      striper = layout->m_slots[cephPoolIdx].acquire();
     }
-    // setup layout
-    rc = striper->set_object_layout_stripe_count(file.nbStripes);
-    if (rc != 0) {
-      logwrapper((char*)"checkAndCreateStriper : invalid nbStripes %d", file.nbStripes);
-      delete striper;
-      delete ioctx;
-      cluster->shutdown();
-      delete cluster;
-      g_cluster[cephPoolIdx] = 0;
-      return 0;
+    session = g_cephRegistry.acquireSession(cephPoolIdx);
+    ioctx = layout->m_pool->m_ioctxs[cephPoolIdx].load(std::memory_order_acquire);
+    cluster = g_cephRegistry.cluster(cephPoolIdx);
+  }
+  handles.slot = &layout->m_slots[cephPoolIdx];
+  handles.session = session;
+  handles.striper = striper;
+  handles.ioctx = ioctx;
+  handles.cluster = cluster;
+  handles.idx = cephPoolIdx;
+  handles.generation = session->m_generation;
+  handles.counted = true;
+  g_cephRegistry.opStarted(cephPoolIdx, 0);
+  return 1;
+}
+
+/// striper for a path based call, from the metadata connections
+static XrdCephStriper* getRadosStriper(const CephFile& file, CephHandles &handles) {
+  getCephHandles(file, handles, CEPH_CLASS_METADATA);
+  return handles.striper;
+}
+
+/// ioctx for a path based call, from the metadata connections
+static XrdCephIoCtx* getIoCtx(const CephFile& file, CephHandles &handles) {
+  getCephHandles(file, handles, CEPH_CLASS_METADATA);
+  return handles.ioctx;
+}
+
+void ceph_posix_get_registry_stats(XrdCephRegistryStats *stats) {
+  g_cephRegistry.stats(*stats);
+}
+
+int ceph_posix_add_cluster(const char *name, const char *confFile, const char *keyring,
+                           unsigned int nbConnections, const char *pools) {
+  XrdSysMutexHelper lock(g_cephSizingMutex);
+  if (g_cephRegistry.nbConnections()) {
+    logwrapper((char*)"ceph_posix_add_cluster : cluster %s declared after the first connection", name);
+    return -EBUSY;
+  }
+  if (0 == name || 0 == *name || 0 == nbConnections || nbConnections > 100) {
+    return -EINVAL;
+  }
+  for (std::vector<CephClusterConfig>::const_iterator it = g_cephClusters.begin(); it != g_cephClusters.end(); it++) {
+    if (it->name == name) {
+      logwrapper((char*)"ceph_posix_add_cluster : cluster %s declared twice", name);
+      return -EEXIST;
     }
-    rc = striper->set_object_layout_stripe_unit(file.stripeUnit);
-    if (rc != 0) {
-      logwrapper((char*)"checkAndCreateStriper : invalid stripeUnit %d (must be non 0, multiple of 64K)", file.stripeUnit);
-      delete striper;
-      delete ioctx;
-      cluster->shutdown();
-      delete cluster;
-      g_cluster[cephPoolIdx] = 0;
-      return 0;
+  }
+  // pools are comma separated
+  std::vector<std::string> poolNames;
+  std::istringstream poolList(pools ? pools : "");
+  std::string pool;
+  while (std::getline(poolList, pool, ',')) {
+    if (pool.empty()) continue;
+    if (g_cephPoolClusters.count(pool)) {
+      logwrapper((char*)"ceph_posix_add_cluster : pool %s already served by another cluster", pool.c_str());
+      return -EEXIST;
     }
-    rc = striper->set_object_layout_object_size(file.objectSize);
-    if (rc != 0) {
-      logwrapper((char*)"checkAndCreateStriper : invalid objectSize %d (must be non 0, multiple of stripe_unit)", file.objectSize);
-      delete striper;
-      delete ioctx;
-      cluster->shutdown();
-      delete cluster;
-      g_cluster[cephPoolIdx] = 0;
+    poolNames.push_back(pool);
+  }
+  if (poolNames.empty()) {
+    logwrapper((char*)"ceph_posix_add_cluster : no pool given for cluster %s", name);
+    return -EINVAL;
+  }
+  CephClusterConfig config;
+  config.name = name;
+  config.confFile = confFile ? confFile : "";
+  config.keyring = keyring ? keyring : "";
+  config.nbConnections = nbConnections;
+  config.range.first = 0;
+  config.range.count = 0;
+  g_cephClusters.push_back(config);
+  for (std::vector<std::string>::const_iterator it = poolNames.begin(); it != poolNames.end(); it++) {
+    g_cephPoolClusters[*it] = g_cephClusters.size();
+  }
+  return 0;
+}
+
+int ceph_posix_add_option(const char *key, const char *value, int connClass) {
+  if (0 == key || 0 == *key || 0 == value || 0 == *value ||
+      connClass < -1 || connClass >= CEPH_NB_CONNECTION_CLASSES) {
+    return -EINVAL;
+  }
+  XrdSysMutexHelper lock(g_cephSizingMutex);
+  if (g_cephRegistry.nbConnections()) {
+    logwrapper((char*)"ceph_posix_add_option : option %s given after the first connection", key);
+    return -EBUSY;
+  }
+  // checked on a scratch connection, which also tells the value ceph understood
+  XrdCephCluster *cluster = g_cephBackend->newCluster();
+  if (0 == cluster) return -ENOMEM;
+  std::string effective;
+  int rc = cluster->init(g_defaultParams.userId.c_str());
+  if (0 == rc) rc = cluster->conf_set(key, value);
+  if (0 == rc) rc = cluster->conf_get(key, effective);
+  cluster->shutdown();
+  delete cluster;
+  if (rc) {
+    logwrapper((char*)"ceph_posix_add_option : invalid option %s %s, rc = %d", key, value, rc);
+    return rc;
+  }
+  static const char *classNames[CEPH_NB_CONNECTION_CLASSES] = {"read", "write", "metadata", "bulk"};
+  logwrapper((char*)"ceph_posix_add_option : option %s set to %s for %s connections",
+             key, effective.c_str(), connClass < 0 ? "all" : classNames[connClass]);
+  // a repeated option replaces the previous value
+  for (std::vector<CephClusterOption>::iterator it = g_cephOptions.begin(); it != g_cephOptions.end(); it++) {
+    if (it->key == key && it->connClass == connClass) {
+      it->value = value;
       return 0;
     }
-    IOCtxDict & ioDict = g_ioCtx[cephPoolIdx];
-    ioDict.insert(std::pair<std::string, librados::IoCtx*>(userAtPool, ioctx));
-    sDict.insert(std::pair<std::string, libradosstriper::RadosStriper*>
-                 (userAtPool, striper)).first;
   }
-  return 1;
-} 
+  CephClusterOption option;
+  option.key = key;
+  option.value = value;
+  option.connClass = connClass;
+  g_cephOptions.push_back(option);
+  return 0;
+}
 
-static libradosstriper::RadosStriper* getRadosStriper(const CephFile& file) {
-  XrdSysMutexHelper lock(g_striper_mutex);
-  std::stringstream ss;
-  ss << file.userId << '@' << file.pool << ',' << file.nbStripes << ','
-     << file.stripeUnit << ',' << file.objectSize;
-  std::string userAtPool = ss.str();
-  unsigned int cephPoolIdx = getCephPoolIdxAndIncrease();
-  if (checkAndCreateStriper(cephPoolIdx, userAtPool, file) == 0) {
-    logwrapper((char*)"getRadosStriper : checkAndCreateStriper failed");
-    return 0;
-  }
-  return g_radosStripers[cephPoolIdx][userAtPool];
+int ceph_posix_get_connection_option(unsigned int idx, const char *key, char *value, size_t size) {
+  if (idx >= g_cephRegistry.nbConnections()) return -EINVAL;
+  XrdCephCluster *cluster = g_cephRegistry.cluster(idx);
+  if (0 == cluster) return -ENOTCONN;
+  std::string effective;
+  int rc = cluster->conf_get(key, effective);
+  if (rc) return rc;
+  if (effective.size() >= size) return -ERANGE;
+  strcpy(value, effective.c_str());
+  return 0;
 }
 
-static librados::IoCtx* getIoCtx(const CephFile& file) {
-  XrdSysMutexHelper lock(g_striper_mutex);
-  std::stringstream ss;
-  ss << file.userId << '@' << file.pool << ',' << file.nbStripes << ','
-     << file.stripeUnit << ',' << file.objectSize;
-  std::string userAtPool = ss.str();
-  unsigned int cephPoolIdx = getCephPoolIdxAndIncrease();
-  if (checkAndCreateStriper(cephPoolIdx, userAtPool, file) == 0) {
-    return 0;
-  }
-  return g_ioCtx[cephPoolIdx][userAtPool];
+void ceph_posix_clear_options() {
+  XrdSysMutexHelper lock(g_cephSizingMutex);
+  g_cephOptions.clear();
+}
+
+void ceph_posix_clear_clusters() {
+  XrdSysMutexHelper lock(g_cephSizingMutex);
+  g_cephClusters.clear();
+  g_cephPoolClusters.clear();
 }
 
 void ceph_posix_disconnect_all() {
+  {
+    // stop the recoveries, waiting for the ones still connecting
+    XrdSysCondVarHelper lock(g_cephRecoveryCond);
+    g_cephGeneration++;
+    g_cephRecoveryCond.Broadcast();
+    while (g_cephNbRecoveries) g_cephRecoveryCond.Wait();
+  }
   XrdSysMutexHelper lock(g_striper_mutex);
-  for (unsigned int i= 0; i < g_maxCephPoolIdx; i++) {
-    for (StriperDict::iterator it2 = g_radosStripers[i].begin();
-         it2 != g_radosStripers[i].end();
-         it2++) {
-      delete it2->second;
+  // the pool may be recreated with a different size
+  g_cephRegistry.clear();
+}
+
+int ceph_posix_get_connection_stats(unsigned int idx, XrdCephConnectionStats *stats) {
+  if (idx >= g_cephRegistry.nbConnections()) return -EINVAL;
+  const XrdCephConnectionLoad &load = g_cephRegistry.load(idx);
+  stats->inflightOps = load.inflightOps.load(std::memory_order_relaxed);
+  stats->inflightBytes = load.inflightBytes.load(std::memory_order_relaxed);
+  stats->totalOps = load.totalOps.load(std::memory_order_relaxed);
+  stats->totalBytes = load.totalBytes.load(std::memory_order_relaxed);
+  stats->nbRecoveries = load.nbRecoveries.load(std::memory_order_relaxed);
+  stats->healthy = load.healthy();
+  return 0;
+}
+
+/// arguments of a preconnection thread
+struct PreconnectArgs {
+  unsigned int idx;
+  const std::vector<CephFile> *pools;
+  int rc;
+};
+
+/// connects one cluster and creates the ioctxs and stripers of the given pools
+static void* preconnectThread(void *arg) {
+  PreconnectArgs *args = (PreconnectArgs*)arg;
+  // connect without holding the mutex so that connections progress in parallel
+  if (0 == g_cephRegistry.cluster(args->idx)) {
+    XrdCephCluster *cluster = connectCluster(args->idx, g_defaultParams.userId);
+    if (0 == cluster) {
+      args->rc = -ECONNREFUSED;
+      return 0;
+    }
+    XrdSysMutexHelper lock(g_striper_mutex);
+    if (0 == g_cephRegistry.cluster(args->idx)) {
+      g_cephRegistry.setCluster(args->idx, cluster);
+      g_cephConnectionUsers[args->idx] = g_defaultParams.userId;
+    } else {
+      lock.UnLock();
+      cluster->shutdown();
+      delete cluster;
+    }
+  }
+  for (std::vector<CephFile>::const_iterator it = args->pools->begin(); it != args->pools->end(); it++) {
+    // only the connections of the cluster serving the pool
+    if (it->cluster != getConnectionCluster(args->idx)) continue;
+    XrdSysMutexHelper lock(g_striper_mutex);
+    XrdCephLayout *layout = g_cephRegistry.findOrInsert(it->userId, it->pool, it->nbStripes,
+                                                        it->stripeUnit, it->objectSize,
+                                                        g_maxCephLayouts);
+    if (0 == checkAndCreateStriper(args->idx, layout, *it)) {
+      logwrapper((char*)"ceph_posix_preconnect : no striper for pool %s on connection %d",
+                 it->pool.c_str(), args->idx);
+      args->rc = -EINVAL;
     }
-    for (IOCtxDict::iterator it2 = g_ioCtx[i].begin();
-         it2 != g_ioCtx[i].end();
-         it2++) {
-      delete it2->second;
+  }
+  return 0;
+}
+
+int ceph_posix_preconnect(const char *pools) {
+  // parse the pools first, they use the same syntax as the defaults
+  std::vector<CephFile> files;
+  std::istringstream specs(pools ? pools : "");
+  std::string spec;
+  while (specs >> spec) {
+    CephFile file;
+    try {
+      fillCephFileParams(spec, NULL, file);
+    } catch (std::exception &e) {
+      logwrapper((char*)"ceph_posix_preconnect : invalid pool %s", spec.c_str());
+      return -EINVAL;
+    }
+    files.push_back(file);
+  }
+  initCephPool();
+  uint64_t start = nowNs();
+  // one thread per connection, the calling thread doing the ones that could
+  // not be started
+  unsigned int nbConnections = g_cephRegistry.nbConnections();
+  std::vector<PreconnectArgs> args(nbConnections);
+  std::vector<pthread_t> tids(nbConnections);
+  std::vector<bool> started(nbConnections, false);
+  for (unsigned int i = 0; i < nbConnections; i++) {
+    args[i].idx = i;
+    args[i].pools = &files;
+    args[i].rc = 0;
+    started[i] = (0 == XrdSysThread::Run(&tids[i], preconnectThread, &args[i],
+                                         XRDSYSTHREAD_HOLD, "ceph preconnect"));
+  }
+  int rc = 0;
+  unsigned int nbFailed = 0;
+  for (unsigned int i = 0; i < nbConnections; i++) {
+    if (started[i]) {
+      XrdSysThread::Join(tids[i], 0);
+    } else {
+      preconnectThread(&args[i]);
+    }
+    if (args[i].rc) {
+      rc = args[i].rc;
+      nbFailed++;
     }
-    delete g_cluster[i];
   }
-  g_radosStripers.clear();
-  g_ioCtx.clear();
-  g_cluster.clear();
+  logwrapper((char*)"ceph_posix_preconnect : %d connections, %d failed, %d pools in %d ms",
+             nbConnections, nbFailed, (int)files.size(), (int)((nowNs() - start) / 1000000));
+  return rc;
 }
 
 void ceph_posix_set_logfunc(void (*logfunc) (char *, va_list argp)) {
   g_logfunc = logfunc;
 };
 
-static int ceph_posix_internal_truncate(const CephFile &file, unsigned long long size);
+void ceph_posix_set_backend(XrdCephBackend *backend) {
+  g_cephBackend = backend;
+}
 
-/**
- * * brief ceph_posix_open function opens a file for read or write
- * * details This function either:
- * *    Opens a file for reading. If the file doesn't exist, this is an error.
- * *    Opens a file for writing. If the file already exists, check whether overwrite has been requested. If overwrite
- * *    hasn't been requested for an existing file, this is an error.
+static int ceph_posix_internal_truncate(XrdCephStriper *striper, const CephFile &file, unsigned long long size);
+
+/// decimal value of one of the xattrs of the striper, 0 if missing
+static unsigned long long striperXattrValue(const std::map<std::string, ceph::bufferlist> &attrset,
+                                            const char *name) {
+  std::map<std::string, ceph::bufferlist>::const_iterator it = attrset.find(name);
+  if (it == attrset.end()) return 0;
+  return strtoull(it->second.to_str().c_str(), 0, 10);
+}
+
+/// reads the layout and size of a striped file from its first object
+static int getStripedLayout(CephFileRef *fr, CephStripedLayout &layout) {
+  std::map<std::string, ceph::bufferlist> attrset;
+  int rc = checkConnection(fr->connIdx, fr->connGeneration, fr->ioctx->getxattrs(ceph_object_name(fr->name, 0), attrset));
+  if (rc < 0) return rc;
+  layout.nbStripes = striperXattrValue(attrset, CEPH_XATTR_LAYOUT_STRIPE_COUNT);
+  layout.stripeUnit = striperXattrValue(attrset, CEPH_XATTR_LAYOUT_STRIPE_UNIT);
+  layout.objectSize = striperXattrValue(attrset, CEPH_XATTR_LAYOUT_OBJECT_SIZE);
+  layout.size = striperXattrValue(attrset, CEPH_XATTR_SIZE);
+  if (0 == layout.nbStripes || 0 == layout.stripeUnit || 0 == layout.objectSize ||
+      layout.objectSize % layout.stripeUnit) {
+    return -EINVAL;
+  }
+  return 0;
+}
+
+/**
+ * * brief ceph_posix_open function opens a file for read or write
+ * * details This function either:
+ * *    Opens a file for reading. If the file doesn't exist, this is an error.
+ * *    Opens a file for writing. If the file already exists, check whether overwrite has been requested. If overwrite
+ * *    hasn't been requested for an existing file, this is an error.
  * * param env XrdOucEnv* Unused
  * * param pathname const char* Specify the file to open.
  * * param flags int Indicates whether reading or writing, and whether to overwrite an existing file.
@@ -648,18 +1360,32 @@ static int ceph_posix_internal_truncate(const CephFile &file, unsigned long long
  * */
 
 int ceph_posix_open(XrdOucEnv* env, const char *pathname, int flags, mode_t mode){
+  XrdCephTraceScope trace(CEPH_TRACE_OPEN, -1, pathname, flags);
 
-  CephFileRef fr = getCephFileRef(pathname, env, flags, mode, 0);
+  CephFileRef *fr = newCephFileRef(pathname, env, flags, mode, 0);
 
   struct stat buf;
-  libradosstriper::RadosStriper *striper = getRadosStriper(fr); //Get a handle to the RADOS striper API
- 
-  if (NULL == striper) {
+  //Get a handle to the RADOS striper API, kept for the lifetime of the file
+  // third party copies have their own connections when configured, other files
+  // are bound to the read or write ones
+  XrdCephConnectionClass connClass = (flags & O_ACCMODE) == O_RDONLY ? CEPH_CLASS_READ : CEPH_CLASS_WRITE;
+  if (env && g_cephClassNbConnections[CEPH_CLASS_BULK] && (env->Get("tpc.key") || env->Get("tpc.src"))) {
+    connClass = CEPH_CLASS_BULK;
+  }
+  CephHandles handles;
+  if (!getCephHandles(*fr, handles, connClass)) {
     logwrapper((char*)"Cannot create striper");  
-    return -EINVAL;
+    delete fr;
+    return trace.doneOpen(-EINVAL);
   }
  
-  int rc = striper->stat(fr.name, (uint64_t*)&(buf.st_size), &(buf.st_atime)); //Get details about a file
+  fr->striper = handles.striper;
+  fr->ioctx = handles.ioctx;
+  fr->cluster = handles.cluster;
+  fr->connIdx = handles.idx;
+  fr->connGeneration = handles.generation;
+  fr->connClass = connClass;
+  int rc = checkConnection(handles.idx, handles.generation, fr->striper->stat(fr->name, (uint64_t*)&(buf.st_size), &(buf.st_atime))); //Get details about a file
   
  
   bool fileExists = (rc != -ENOENT); //Make clear what condition we are testing
@@ -667,11 +1393,30 @@ int ceph_posix_open(XrdOucEnv* env, const char *pathname, int flags, mode_t mode
   if ((flags&O_ACCMODE) == O_RDONLY) {  // Access mode is READ
 
     if (fileExists) {
+      // layout and size are read once for all for direct reads, unless the
+      // file is being written, in which case reads go through the striper.
+      // The name is watched first, so that writers coming afterwards are noticed
+      if (g_cephDirectRead && fr->ioctx) {
+        fr->writeGeneration = g_filesOpenForWrite.watch(fr->name);
+        fr->watchesWrites = true;
+        if (!g_filesOpenForWrite.writtenSince(fr->name, fr->writeGeneration)) {
+          int lrc = getStripedLayout(fr, fr->layout);
+          if (0 == lrc) {
+            fr->directRead.store(true, std::memory_order_relaxed);
+          } else {
+            logwrapper((char*)"ceph_open: cannot read the layout of %s, rc = %d, reading through the striper",
+                       pathname, lrc);
+          }
+        }
+      }
+      handles.detach(fr->slot, fr->session);
       int fd = insertFileRef(fr);
+      if (fd < 0) return trace.doneOpen(fd);
       logwrapper((char*)"File descriptor %d associated to file %s opened in read mode", fd, pathname);
-      return fd;
+      return trace.doneOpen(fd);
     } else {
-      return -ENOENT;
+      delete fr;
+      return trace.doneOpen(-ENOENT);
     }
 
   } else {                              // Access mode is WRITE
@@ -679,45 +1424,54 @@ int ceph_posix_open(XrdOucEnv* env, const char *pathname, int flags, mode_t mode
       if (flags & O_TRUNC) {
         int rc = ceph_posix_unlink(env, pathname);
         if (rc < 0 && rc != -ENOENT) {
-          return rc;
+          delete fr;
+          return trace.doneOpen(rc);
         }
       } else {
-        return -EEXIST;
+        delete fr;
+        return trace.doneOpen(-EEXIST);
       }
     }
     // At this point, we know either the target file didn't exist, or the ceph_posix_unlink above removed it
+    handles.detach(fr->slot, fr->session);
     int fd = insertFileRef(fr);
+    if (fd < 0) return trace.doneOpen(fd);
     logwrapper((char*)"File descriptor %d associated to file %s opened in write mode", fd, pathname);
-    return fd;
+    return trace.doneOpen(fd);
     
   }
     
 }
 
+CephFileRef* ceph_posix_get_handle(int fd) {
+  return getFileRef(fd);
+}
+
 int ceph_posix_close(int fd) {
+  XrdCephTraceScope trace(CEPH_TRACE_CLOSE, fd);
   CephFileRef* fr = getFileRef(fd);
   if (fr) {
-    ::timeval now;
-    ::gettimeofday(&now, nullptr);
-    XrdSysMutexHelper lock(fr->statsMutex);
     double lastAsyncAge = 0.0;
     // Only compute an age if the starting point was set.
-    if (fr->lastAsyncSubmission.tv_sec && fr->lastAsyncSubmission.tv_usec) {
-      lastAsyncAge = 1.0 * (now.tv_sec - fr->lastAsyncSubmission.tv_sec) 
-              + 0.000001 * (now.tv_usec - fr->lastAsyncSubmission.tv_usec);
+    uint64_t lastAsyncSubmission = fr->lastAsyncSubmission.load(std::memory_order_relaxed);
+    if (lastAsyncSubmission) {
+      lastAsyncAge = 0.000000001 * (nowNs() - lastAsyncSubmission);
     }
     logwrapper((char*)"ceph_close: closed fd %d for file %s, read ops count %d, write ops count %d, "
                "async write ops %d/%d, async pending write bytes %ld, "
                "async read ops %d/%d, bytes written/max offset %ld/%ld, "
                "longest async write %f, longest callback invocation %f, last async op age %f", 
-               fd, fr->name.c_str(), fr->rdcount, fr->wrcount, 
-               fr->asyncWrCompletionCount, fr->asyncWrStartCount, fr->bytesAsyncWritePending,
-               fr->asyncRdCompletionCount, fr->asyncRdStartCount, fr->bytesWritten,  fr->maxOffsetWritten,
-               fr->longestAsyncWriteTime, fr->longestCallbackInvocation, (lastAsyncAge));
-    deleteFileRef(fd, *fr);
-    return 0;
+               fd, fr->name.c_str(), fr->rdcount.load(std::memory_order_relaxed), fr->wrcount.load(std::memory_order_relaxed),
+               fr->asyncWrCompletionCount.load(std::memory_order_relaxed), fr->asyncWrStartCount.load(std::memory_order_relaxed),
+               fr->bytesAsyncWritePending.load(std::memory_order_relaxed),
+               fr->asyncRdCompletionCount.load(std::memory_order_relaxed), fr->asyncRdStartCount.load(std::memory_order_relaxed),
+               fr->bytesWritten.load(std::memory_order_relaxed), fr->maxOffsetWritten.load(std::memory_order_relaxed),
+               0.000000001 * fr->longestAsyncWriteTime.load(std::memory_order_relaxed),
+               0.000000001 * fr->longestCallbackInvocation.load(std::memory_order_relaxed), (lastAsyncAge));
+    deleteFileRef(fd);
+    return trace.done(0);
   } else {
-    return -EBADF;
+    return trace.done(-EBADF);
   }
 }
 
@@ -736,299 +1490,923 @@ static off64_t lseek_compute_offset(CephFileRef &fr, off64_t offset, int whence)
 }
 
 off_t ceph_posix_lseek(int fd, off_t offset, int whence) {
+  XrdCephTraceScope trace(CEPH_TRACE_LSEEK, fd, 0, offset);
   CephFileRef* fr = getFileRef(fd);
   if (fr) {
     logwrapper((char*)"ceph_lseek: for fd %d, offset=%lld, whence=%d", fd, offset, whence);
-    return (off_t)lseek_compute_offset(*fr, offset, whence);
+    return trace.done((off_t)lseek_compute_offset(*fr, offset, whence));
   } else {
-    return -EBADF;
+    return trace.done(-EBADF);
   }
 }
 
 off64_t ceph_posix_lseek64(int fd, off64_t offset, int whence) {
+  XrdCephTraceScope trace(CEPH_TRACE_LSEEK, fd, 0, offset);
   CephFileRef* fr = getFileRef(fd);
   if (fr) {
     logwrapper((char*)"ceph_lseek64: for fd %d, offset=%lld, whence=%d", fd, offset, whence);
-    return lseek_compute_offset(*fr, offset, whence);
+    return trace.done(lseek_compute_offset(*fr, offset, whence));
   } else {
-    return -EBADF;
+    return trace.done(-EBADF);
+  }
+}
+
+struct CephSplitOp;
+
+/// piece of a read or write split over several connections
+struct CephSplitPiece {
+  CephSplitOp *op;
+  /// handles of the connection carrying the piece, pinned until it is done
+  CephHandles handles;
+  uint64_t offset;
+  size_t length;
+  char *buf;
+  ceph::bufferlist bl;
+  int rc;
+};
+
+/// read or write split into contiguous pieces sent in parallel, each on the
+/// connection picked for it by the connection policy. cb is called with arg
+/// once all pieces are done, with the length read, 0 for writes, or the
+/// first error
+struct CephSplitOp {
+  CephSplitOp(size_t n, bool _write, CephAioCB *_cb, void *_arg) :
+    pieces(n), pending(n + 1), write(_write), cb(_cb), arg(_arg) {}
+  std::vector<CephSplitPiece> pieces;
+  /// pieces not done yet, plus one reference held during the submission
+  std::atomic<unsigned int> pending;
+  bool write;
+  CephAioCB *cb;
+  void *arg;
+};
+
+/// size of the pieces of split operations : the split size rounded up to
+/// whole stripes of the layout, so that pieces are cut at stripe and object
+/// boundaries and cover whole stripe units of as few objects as possible
+static unsigned long long splitPieceSize(const CephFile &file, unsigned long long splitSize) {
+  unsigned long long stripe = file.stripeUnit * file.nbStripes;
+  return (splitSize + stripe - 1) / stripe * stripe;
+}
+
+/// whether a read of count bytes is to be split
+static bool isSplitRead(size_t count) {
+  return g_cephReadSplitSize && count > g_cephReadSplitSize;
+}
+
+/// whether a write of count bytes is to be split
+static bool isSplitWrite(size_t count) {
+  return g_cephWriteSplitSize && count > g_cephWriteSplitSize;
+}
+
+/// drops a reference to a split operation, completing it with the last one
+static void releaseSplitOp(CephSplitOp *op) {
+  if (1 != op->pending.fetch_sub(1, std::memory_order_acq_rel)) return;
+  // a read ends with the first short piece, the end of the file
+  int total = 0;
+  int rc = 0;
+  bool eof = false;
+  for (std::vector<CephSplitPiece>::const_iterator it = op->pieces.begin(); it != op->pieces.end(); it++) {
+    if (it->rc < 0) {
+      rc = it->rc;
+      break;
+    }
+    if (!eof) total += it->rc;
+    if ((size_t)it->rc < it->length) eof = true;
+  }
+  CephAioCB *cb = op->cb;
+  void *arg = op->arg;
+  bool write = op->write;
+  delete op;
+  cb(arg, rc < 0 ? rc : (write ? 0 : total));
+}
+
+static void ceph_split_complete(void *arg, int rc) {
+  CephSplitPiece *piece = reinterpret_cast<CephSplitPiece*>(arg);
+  g_cephRegistry.opDone(piece->handles.idx, piece->length);
+  piece->rc = checkConnection(piece->handles.idx, piece->handles.generation, rc);
+  if (!piece->op->write) completeRead(piece->bl, piece->buf, rc);
+  releaseSplitOp(piece->op);
+}
+
+/**
+ * reads or writes count bytes at offset from/to buf, in pieces cut at
+ * multiples of the piece size and sent in parallel. Each piece goes through
+ * the striper of the connection picked for it, so that a large operation is
+ * spread over several connections. Buffers are used in place.
+ * cb is called with arg once all pieces are done, unless an error is returned
+ */
+static int ceph_split_io(CephFileRef *fr, bool write, char *buf, size_t count, uint64_t offset,
+                         CephAioCB *cb, void *arg) {
+  unsigned long long pieceSize =
+    splitPieceSize(*fr, write ? g_cephWriteSplitSize : g_cephReadSplitSize);
+  uint64_t end = offset + count;
+  size_t n = (end - 1) / pieceSize - offset / pieceSize + 1;
+  CephSplitOp *op = new CephSplitOp(n, write, cb, arg);
+  uint64_t cur = offset;
+  for (size_t i = 0; i < n; i++) {
+    CephSplitPiece &piece = op->pieces[i];
+    uint64_t pieceEnd = std::min(end, (uint64_t)((cur / pieceSize + 1) * pieceSize));
+    piece.op = op;
+    piece.offset = cur;
+    piece.length = pieceEnd - cur;
+    piece.buf = buf + (cur - offset);
+    piece.rc = 0;
+    cur = pieceEnd;
+  }
+  for (size_t i = 0; i < n; i++) {
+    CephSplitPiece &piece = op->pieces[i];
+    int rc = -EINVAL;
+    if (getCephHandles(*fr, piece.handles, (XrdCephConnectionClass)fr->connClass)) {
+      XrdCephStriper *striper = piece.handles.striper;
+      g_cephRegistry.opStarted(piece.handles.idx, piece.length);
+      if (write) {
+        prepareWrite(piece.bl, piece.buf, piece.length);
+        rc = striper->aio_write(fr->name, piece.bl, piece.length, piece.offset, ceph_split_complete, &piece);
+      } else {
+        rc = striper->aio_read(fr->name, &piece.bl, piece.length, piece.offset, ceph_split_complete, &piece);
+      }
+      rc = checkConnection(piece.handles.idx, piece.handles.generation, rc);
+      if (rc < 0) g_cephRegistry.opDone(piece.handles.idx, piece.length);
+    }
+    if (rc < 0) {
+      if (0 == i) {
+        // nothing in flight, the failure is reported right away
+        delete op;
+        return rc;
+      }
+      // the pieces not submitted fail, the ones in flight complete the operation
+      for (size_t j = i; j < n; j++) op->pieces[j].rc = rc;
+      op->pending.fetch_sub(n - i, std::memory_order_acq_rel);
+      break;
+    }
   }
+  releaseSplitOp(op);
+  return 0;
+}
+
+/// result of a split operation waited for by a synchronous call
+struct CephSplitWait {
+  CephAioGroup group;
+  int rc;
+};
+
+static void ceph_split_wait_complete(void *arg, int rc) {
+  CephSplitWait *wait = reinterpret_cast<CephSplitWait*>(arg);
+  wait->rc = rc;
+  wait->group.done();
+}
+
+/// synchronous split read or write
+static int ceph_split_io_wait(CephFileRef *fr, bool write, char *buf, size_t count, uint64_t offset) {
+  CephSplitWait wait;
+  wait.group.started();
+  int rc = ceph_split_io(fr, write, buf, count, offset, ceph_split_wait_complete, &wait);
+  if (rc < 0) return rc;
+  wait.group.wait();
+  return wait.rc;
 }
 
 ssize_t ceph_posix_write(int fd, const void *buf, size_t count) {
+  XrdCephTraceScope trace(CEPH_TRACE_WRITE, fd, 0, 0, count);
   CephFileRef* fr = getFileRef(fd);
   if (fr) {
     logwrapper((char*)"ceph_write: for fd %d, count=%d", fd, count);
     if ((fr->flags & (O_WRONLY|O_RDWR)) == 0) {
-      return -EBADF;
-    }
-    libradosstriper::RadosStriper *striper = getRadosStriper(*fr);
-    if (0 == striper) {
-      return -EINVAL;
+      return trace.done(-EBADF);
     }
     ceph::bufferlist bl;
-    bl.append((const char*)buf, count);
-    int rc = striper->write(fr->name, bl, count, fr->offset);
-    if (rc) return rc;
+    prepareWrite(bl, buf, count);
+    CephInflightOp inflight(fr->connIdx, count);
+    int rc = checkConnection(fr->connIdx, fr->connGeneration, fr->striper->write(fr->name, bl, count, fr->offset));
+    if (rc) return trace.done(rc);
     fr->offset += count;
-    XrdSysMutexHelper lock(fr->statsMutex);
-    fr->wrcount++;
-    fr->bytesWritten+=count;
-    if (fr->offset) fr->maxOffsetWritten = std::max(fr->offset - 1, fr->maxOffsetWritten);
-    return count;
+    fr->wrcount.fetch_add(1, std::memory_order_relaxed);
+    fr->bytesWritten.fetch_add(count, std::memory_order_relaxed);
+    if (fr->offset) atomicMax(fr->maxOffsetWritten, fr->offset - 1);
+    return trace.done(count);
   } else {
+    return trace.done(-EBADF);
+  }
+}
+
+static ssize_t ceph_posix_internal_pwrite(CephFileRef *fr, const void *buf, size_t count, off64_t offset) {
+  // TODO implement proper logging level for this plugin - this should be only debug
+  //logwrapper((char*)"ceph_write: for fd %d, count=%d", fr->fd, count);
+  if ((fr->flags & (O_WRONLY|O_RDWR)) == 0) {
     return -EBADF;
   }
+  int rc;
+  if (isSplitWrite(count)) {
+    rc = ceph_split_io_wait(fr, true, (char*)buf, count, offset);
+  } else {
+    ceph::bufferlist bl;
+    prepareWrite(bl, buf, count);
+    CephInflightOp inflight(fr->connIdx, count);
+    rc = checkConnection(fr->connIdx, fr->connGeneration, fr->striper->write(fr->name, bl, count, offset));
+  }
+  if (rc) return rc;
+  fr->wrcount.fetch_add(1, std::memory_order_relaxed);
+  fr->bytesWritten.fetch_add(count, std::memory_order_relaxed);
+  if (offset + count) atomicMax(fr->maxOffsetWritten, offset + count - 1);
+  return count;
 }
 
 ssize_t ceph_posix_pwrite(int fd, const void *buf, size_t count, off64_t offset) {
+  XrdCephTraceScope trace(CEPH_TRACE_PWRITE, fd, 0, offset, count);
   CephFileRef* fr = getFileRef(fd);
   if (fr) {
-    // TODO implement proper logging level for this plugin - this should be only debug
-    //logwrapper((char*)"ceph_write: for fd %d, count=%d", fd, count);
-    if ((fr->flags & (O_WRONLY|O_RDWR)) == 0) {
-      return -EBADF;
-    }
-    libradosstriper::RadosStriper *striper = getRadosStriper(*fr);
-    if (0 == striper) {
-      return -EINVAL;
-    }
-    ceph::bufferlist bl;
-    bl.append((const char*)buf, count);
-    int rc = striper->write(fr->name, bl, count, offset);
-    if (rc) return rc;
-    XrdSysMutexHelper lock(fr->statsMutex);
-    fr->wrcount++;
-    fr->bytesWritten+=count;
-    if (offset + count) fr->maxOffsetWritten = std::max(uint64_t(offset + count - 1), fr->maxOffsetWritten);
-    return count;
+    return trace.done(ceph_posix_internal_pwrite(fr, buf, count, offset));
   } else {
-    return -EBADF;
+    return trace.done(-EBADF);
   }
 }
 
-static void ceph_aio_write_complete(rados_completion_t c, void *arg) {
-  AioArgs *awa = reinterpret_cast<AioArgs*>(arg);
-  size_t rc = rados_aio_get_return_value(c);
-  // Compute statistics before reportng to xrootd, so that a close cannot happen
-  // in the meantime.
-  CephFileRef* fr = getFileRef(awa->fd);
-  if (fr) {
-    XrdSysMutexHelper lock(fr->statsMutex);
-    fr->asyncWrCompletionCount++;
-    fr->bytesAsyncWritePending -= awa->nbBytes;
-    fr->bytesWritten += awa->nbBytes;
-    if (awa->aiop->sfsAio.aio_nbytes)
-      fr->maxOffsetWritten = std::max(fr->maxOffsetWritten, uint64_t(awa->aiop->sfsAio.aio_offset + awa->aiop->sfsAio.aio_nbytes - 1));
-    ::timeval now;
-    ::gettimeofday(&now, nullptr);
-    double writeTime = 0.000001 * (now.tv_usec - awa->startTime.tv_usec) + 1.0 * (now.tv_sec - awa->startTime.tv_sec);
-    fr->longestAsyncWriteTime = std::max(fr->longestAsyncWriteTime, writeTime);
-  }
-  ::timeval before, after;
-  if (fr) ::gettimeofday(&before, nullptr);
+ssize_t ceph_posix_fh_pwrite(CephFileRef *fr, const void *buf, size_t count, off64_t offset) {
+  XrdCephTraceScope trace(CEPH_TRACE_PWRITE, fr->fd, 0, offset, count);
+  return trace.done(ceph_posix_internal_pwrite(fr, buf, count, offset));
+}
+
+/// completion of asynchronous writes, once all their data is written
+static void ceph_aio_write_done(AioArgs *awa, int rc) {
+  CephFileRef *fr = awa->fr;
+  // the file is referenced by awa, so it can be updated after the callback
+  // even if the file got closed in the meantime
+  uint64_t before = nowNs();
+  fr->asyncWrCompletionCount.fetch_add(1, std::memory_order_relaxed);
+  fr->bytesAsyncWritePending.fetch_sub(awa->nbBytes, std::memory_order_relaxed);
+  fr->bytesWritten.fetch_add(awa->nbBytes, std::memory_order_relaxed);
+  if (awa->aiop->sfsAio.aio_nbytes)
+    atomicMax(fr->maxOffsetWritten, awa->aiop->sfsAio.aio_offset + awa->aiop->sfsAio.aio_nbytes - 1);
+  atomicMax(fr->longestAsyncWriteTime, before - awa->startTime);
+  traceAioCompletion(awa, rc == 0 ? awa->nbBytes : rc);
   awa->callback(awa->aiop, rc == 0 ? awa->nbBytes : rc);
-  if (fr) {
-    ::gettimeofday(&after, nullptr);
-    double callbackInvocationTime = 0.000001 * (after.tv_usec - before.tv_usec) + 1.0 * (after.tv_sec - before.tv_sec);
-    XrdSysMutexHelper lock(fr->statsMutex);
-    fr->longestCallbackInvocation = std::max(fr->longestCallbackInvocation, callbackInvocationTime);
-  }
+  atomicMax(fr->longestCallbackInvocation, nowNs() - before);
   delete(awa);
 }
 
+static void ceph_aio_write_complete(void *arg, int rc) {
+  AioArgs *awa = reinterpret_cast<AioArgs*>(arg);
+  g_cephRegistry.opDone(awa->fr->connIdx, awa->nbBytes);
+  checkConnection(awa->fr->connIdx, awa->fr->connGeneration, rc);
+  ceph_aio_write_done(awa, rc);
+}
+
+/// completion of split asynchronous writes, accounted piece by piece
+static void ceph_aio_split_write_complete(void *arg, int rc) {
+  ceph_aio_write_done(reinterpret_cast<AioArgs*>(arg), rc);
+}
+
+static ssize_t ceph_aio_internal_write(CephFileRef *fr, XrdSfsAio *aiop, AioCB *cb,
+                                       XrdCephTraceScope &trace) {
+  // get the parameters from the Xroot aio object
+  size_t count = aiop->sfsAio.aio_nbytes;
+  const char *buf = (const char*)aiop->sfsAio.aio_buf;
+  size_t offset = aiop->sfsAio.aio_offset;
+  // TODO implement proper logging level for this plugin - this should be only debug
+  //logwrapper((char*)"ceph_aio_write: for fd %d, count=%d", fr->fd, count);
+  if ((fr->flags & (O_WRONLY|O_RDWR)) == 0) {
+    return -EBADF;
+  }
+  // prepare the callback arguments and do async call
+  AioArgs *args = new AioArgs(aiop, cb, count, fr);
+  args->traced = trace.defer(args->traceRecord);
+  // accounted before submission, as the completion may come right away
+  fr->asyncWrStartCount.fetch_add(1, std::memory_order_relaxed);
+  fr->lastAsyncSubmission.store(args->startTime, std::memory_order_relaxed);
+  fr->bytesAsyncWritePending.fetch_add(count, std::memory_order_relaxed);
+  int rc;
+  if (isSplitWrite(count)) {
+    // a single completion once all pieces are written
+    rc = ceph_split_io(fr, true, (char*)buf, count, offset, ceph_aio_split_write_complete, args);
+  } else {
+    // prepare a bufferlist around the given buffer
+    ceph::bufferlist bl;
+    prepareWrite(bl, buf, count);
+    // do the write, accounted on the connection until its completion
+    g_cephRegistry.opStarted(fr->connIdx, count);
+    rc = checkConnection(fr->connIdx, fr->connGeneration, fr->striper->aio_write(fr->name, bl, count, offset, ceph_aio_write_complete, args));
+    if (rc) g_cephRegistry.opDone(fr->connIdx, count);
+  }
+  if (0 == rc) {
+    trace.deferred();
+  } else {
+    // the completion will not be called
+    fr->asyncWrStartCount.fetch_sub(1, std::memory_order_relaxed);
+    fr->bytesAsyncWritePending.fetch_sub(count, std::memory_order_relaxed);
+    delete args;
+  }
+  return rc;
+}
+
 ssize_t ceph_aio_write(int fd, XrdSfsAio *aiop, AioCB *cb) {
+  XrdCephTraceScope trace(CEPH_TRACE_AIO_WRITE, fd, 0, aiop->sfsAio.aio_offset, aiop->sfsAio.aio_nbytes);
   CephFileRef* fr = getFileRef(fd);
   if (fr) {
-    // get the parameters from the Xroot aio object
-    size_t count = aiop->sfsAio.aio_nbytes;
-    const char *buf = (const char*)aiop->sfsAio.aio_buf;
-    size_t offset = aiop->sfsAio.aio_offset;
-    // TODO implement proper logging level for this plugin - this should be only debug
-    //logwrapper((char*)"ceph_aio_write: for fd %d, count=%d", fd, count);
-    if ((fr->flags & (O_WRONLY|O_RDWR)) == 0) {
-      return -EBADF;
+    return trace.done(ceph_aio_internal_write(fr, aiop, cb, trace));
+  } else {
+    return trace.done(-EBADF);
+  }
+}
+
+ssize_t ceph_aio_fh_write(CephFileRef *fr, XrdSfsAio *aiop, AioCB *cb) {
+  XrdCephTraceScope trace(CEPH_TRACE_AIO_WRITE, fr->fd, 0, aiop->sfsAio.aio_offset, aiop->sfsAio.aio_nbytes);
+  return trace.done(ceph_aio_internal_write(fr, aiop, cb, trace));
+}
+
+/// holes smaller than this between two pieces of a direct read falling
+/// into the same object are read along, merging the pieces into one read
+static const unsigned long long g_readVMergeGap = 64 * 1024;
+
+/// piece of a direct read falling into a single rados object
+struct CephReadPiece {
+  unsigned long long offset;   // offset within the object
+  size_t length;
+  char *dest;
+  /// read of the object operation covering the piece
+  size_t read;
+};
+
+struct CephDirectRead;
+
+/// reads of a direct read targeting one rados object, sent as one operation
+struct CephReadObject {
+  CephDirectRead *op;
+  std::vector<CephReadPiece> pieces;
+  std::vector<CephObjectRead> reads;
+  int rc;
+};
+
+/// read of segments of a striped file straight from its rados objects.
+/// cb is called with arg once all objects are read, with 0 or the first error
+struct CephDirectRead {
+  CephDirectRead(CephFileRef *_fr, unsigned long long _bytes, CephAioCB *_cb, void *_arg) :
+    fr(_fr), bytes(_bytes), pending(1), cb(_cb), arg(_arg) {}
+  /// the file, kept alive by the caller until the completion
+  CephFileRef *fr;
+  unsigned long long bytes;
+  std::map<unsigned long long, CephReadObject> objects;
+  /// objects not read yet, plus one reference held during the submission
+  std::atomic<unsigned int> pending;
+  CephAioCB *cb;
+  void *arg;
+};
+
+/// sorts the pieces of an object by offset and merges the close ones into reads
+static void mergeReadPieces(CephReadObject &object) {
+  std::sort(object.pieces.begin(), object.pieces.end(),
+            [](const CephReadPiece &a, const CephReadPiece &b) { return a.offset < b.offset; });
+  for (std::vector<CephReadPiece>::iterator it = object.pieces.begin(); it != object.pieces.end(); it++) {
+    if (!object.reads.empty()) {
+      CephObjectRead &last = object.reads.back();
+      unsigned long long end = last.offset + last.length;
+      if (it->offset <= end + g_readVMergeGap) {
+        if (it->offset + it->length > end) last.length = it->offset + it->length - last.offset;
+        it->read = object.reads.size() - 1;
+        continue;
+      }
     }
-    // get the striper object
-    libradosstriper::RadosStriper *striper = getRadosStriper(*fr);
-    if (0 == striper) {
-      return -EINVAL;
+    object.reads.push_back(CephObjectRead());
+    object.reads.back().offset = it->offset;
+    object.reads.back().length = it->length;
+    it->read = object.reads.size() - 1;
+  }
+}
+
+
+/// copies the data read in place. Missing objects and data are holes of the
+/// file, except for the first object which only goes with the file itself
+static int gatherDirectRead(CephDirectRead *op) {
+  std::map<unsigned long long, CephReadObject>::const_iterator it;
+  for (it = op->objects.begin(); it != op->objects.end(); it++) {
+    const CephReadObject &object = it->second;
+    if (object.rc == -ENOENT && 0 == it->first) return -ENOENT;
+    if (object.rc < 0 && object.rc != -ENOENT) return object.rc;
+    for (std::vector<CephReadPiece>::const_iterator p = object.pieces.begin(); p != object.pieces.end(); p++) {
+      const CephObjectRead &read = object.reads[p->read];
+      if (object.rc == 0 && read.rval < 0) return read.rval;
+      size_t pos = p->offset - read.offset;
+      size_t avail = 0;
+      if (object.rc == 0 && read.bl.length() > pos) avail = std::min(p->length, read.bl.length() - pos);
+      if (avail) read.bl.copy(pos, avail, p->dest);
+      if (avail < p->length) memset(p->dest + avail, 0, p->length - avail);
     }
-    // prepare a bufferlist around the given buffer
-    ceph::bufferlist bl;
-    bl.append(buf, count);
-    // get the poolIdx to use
-    int cephPoolIdx = getCephPoolIdxAndIncrease();
-    // Get the cluster to use
-    librados::Rados* cluster = checkAndCreateCluster(cephPoolIdx);
-    if (0 == cluster) {
-      return -EINVAL;
+  }
+  return 0;
+}
+
+/// drops a reference to a direct read, completing it with the last one
+static void releaseDirectRead(CephDirectRead *op) {
+  if (1 != op->pending.fetch_sub(1, std::memory_order_acq_rel)) return;
+  int rc = gatherDirectRead(op);
+  g_cephRegistry.opDone(op->fr->connIdx, op->bytes);
+  checkConnection(op->fr->connIdx, op->fr->connGeneration, rc);
+  CephAioCB *cb = op->cb;
+  void *arg = op->arg;
+  delete op;
+  cb(arg, rc);
+}
+
+static void ceph_direct_read_complete(void *arg, int rc) {
+  CephReadObject *object = reinterpret_cast<CephReadObject*>(arg);
+  object->rc = rc;
+  releaseDirectRead(object->op);
+}
+
+/// total length of the segments of a vectored call
+static unsigned long long ioVecLength(const XrdOucIOVec *ioV, int n) {
+  unsigned long long length = 0;
+  for (int i = 0; i < n; i++) length += ioV[i].size;
+  return length;
+}
+
+/**
+ * reads the n segments into their buffers straight from the rados objects of
+ * the file, mapped with the given layout, bypassing the striper. Segments
+ * must be within the file. The pieces falling into the same object are
+ * merged when close and sent as a single compound read, all objects being
+ * read in parallel through the ioctx of the file. The data is copied out of
+ * the buffers returned by librados, as merged reads do not map one to one
+ * onto the segments. cb is called with arg once all is done, unless an
+ * error is returned
+ */
+static int ceph_direct_read(CephFileRef *fr, const CephStripedLayout &layout,
+                            const XrdOucIOVec *segs, int n, CephAioCB *cb, void *arg) {
+  unsigned long long total = ioVecLength(segs, n);
+  CephDirectRead *op = new CephDirectRead(fr, total, cb, arg);
+  std::vector<CephObjectExtent> extents;
+  for (int i = 0; i < n; i++) {
+    extents.clear();
+    ceph_file_to_extents(layout.nbStripes, layout.stripeUnit, layout.objectSize,
+                         segs[i].offset, segs[i].size, extents);
+    for (std::vector<CephObjectExtent>::const_iterator it = extents.begin(); it != extents.end(); it++) {
+      CephReadPiece piece = {it->offset, it->length, segs[i].data + it->bufferOffset, 0};
+      CephReadObject &object = op->objects[it->objectNo];
+      object.op = op;
+      object.pieces.push_back(piece);
     }
-    // prepare a ceph AioCompletion object and do async call
-    AioArgs *args = new AioArgs(aiop, cb, count, fd);
-    librados::AioCompletion *completion =
-      cluster->aio_create_completion(args, ceph_aio_write_complete, NULL);
-    // do the write
-    int rc = striper->aio_write(fr->name, completion, bl, count, offset);
-    completion->release();
-    XrdSysMutexHelper lock(fr->statsMutex);
-    fr->asyncWrStartCount++;
-    ::gettimeofday(&fr->lastAsyncSubmission, nullptr);
-    fr->bytesAsyncWritePending+=count;
-    return rc;
-  } else {
+  }
+  op->pending.fetch_add(op->objects.size(), std::memory_order_relaxed);
+  // accounted on the connection of the file until the completion
+  g_cephRegistry.opStarted(fr->connIdx, total);
+  std::map<unsigned long long, CephReadObject>::iterator it;
+  for (it = op->objects.begin(); it != op->objects.end(); it++) {
+    mergeReadPieces(it->second);
+    it->second.rc = 0;
+    int rc = fr->ioctx->aio_read_extents(ceph_object_name(fr->name, it->first), it->second.reads,
+                                         ceph_direct_read_complete, &it->second);
+    if (rc < 0) {
+      if (it == op->objects.begin()) {
+        // nothing in flight, the failure is reported right away
+        g_cephRegistry.opDone(fr->connIdx, total);
+        delete op;
+        return checkConnection(fr->connIdx, fr->connGeneration, rc);
+      }
+      // the objects not submitted fail, the ones in flight complete the read
+      for (; it != op->objects.end(); it++) {
+        it->second.rc = rc;
+        op->pending.fetch_sub(1, std::memory_order_relaxed);
+      }
+      break;
+    }
+  }
+  releaseDirectRead(op);
+  return 0;
+}
+
+/// whether the reads of a file can go straight to its objects, i.e. it was
+/// opened with direct reads and nobody here has written it since
+static bool useDirectRead(CephFileRef *fr) {
+  if (!fr->directRead.load(std::memory_order_relaxed)) return false;
+  if (g_filesOpenForWrite.writtenSince(fr->name, fr->writeGeneration)) {
+    fr->directRead.store(false, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+/// length of a read of count bytes at offset of a file with direct reads,
+/// stopping at the end of the file. Reads of more than INT_MAX bytes are
+/// short, as they are through the striper, whose result is an int
+static size_t directReadLength(CephFileRef *fr, size_t count, uint64_t offset) {
+  if (offset >= fr->layout.size) return 0;
+  unsigned long long length = std::min((unsigned long long)count, fr->layout.size - offset);
+  return std::min(length, (unsigned long long)std::numeric_limits<int>::max());
+}
+
+static ssize_t ceph_posix_internal_pread(CephFileRef *fr, void *buf, size_t count, off64_t offset) {
+  // TODO implement proper logging level for this plugin - this should be only debug
+  //logwrapper((char*)"ceph_read: for fd %d, count=%d", fr->fd, count);
+  if ((fr->flags & O_WRONLY) != 0) {
     return -EBADF;
   }
+  if (useDirectRead(fr)) {
+    size_t length = directReadLength(fr, count, offset);
+    if (length) {
+      XrdOucIOVec seg = {(long long)offset, (int)length, 0, (char*)buf};
+      CephSplitWait wait;
+      wait.group.started();
+      int rc = ceph_direct_read(fr, fr->layout, &seg, 1, ceph_split_wait_complete, &wait);
+      if (rc < 0) return rc;
+      wait.group.wait();
+      if (wait.rc < 0) return wait.rc;
+    }
+    fr->rdcount.fetch_add(1, std::memory_order_relaxed);
+    return length;
+  }
+  if (isSplitRead(count)) {
+    int rc = ceph_split_io_wait(fr, false, (char*)buf, count, offset);
+    if (rc >= 0) fr->rdcount.fetch_add(1, std::memory_order_relaxed);
+    return rc;
+  }
+  ceph::bufferlist bl;
+  CephInflightOp inflight(fr->connIdx, count);
+  int rc = checkConnection(fr->connIdx, fr->connGeneration, fr->striper->read(fr->name, &bl, count, offset));
+  if (rc < 0) return rc;
+  completeRead(bl, buf, rc);
+  fr->rdcount.fetch_add(1, std::memory_order_relaxed);
+  return rc;
 }
 
 ssize_t ceph_posix_read(int fd, void *buf, size_t count) {
+  XrdCephTraceScope trace(CEPH_TRACE_READ, fd, 0, 0, count);
   CephFileRef* fr = getFileRef(fd);
   if (fr) {
-    // TODO implement proper logging level for this plugin - this should be only debug
-    //logwrapper((char*)"ceph_read: for fd %d, count=%d", fd, count);
-    if ((fr->flags & O_WRONLY) != 0) {
-      return -EBADF;
-    }
-    libradosstriper::RadosStriper *striper = getRadosStriper(*fr);
-    if (0 == striper) {
-      return -EINVAL;
-    }
-    ceph::bufferlist bl;
-    int rc = striper->read(fr->name, &bl, count, fr->offset);
-    if (rc < 0) return rc;
-    bl.begin().copy(rc, (char*)buf);
-    XrdSysMutexHelper lock(fr->statsMutex);
-    fr->offset += rc;
-    fr->rdcount++;
-    return rc;
+    // same paths as pread, at the current offset
+    ssize_t rc = ceph_posix_internal_pread(fr, buf, count, fr->offset);
+    if (rc > 0) fr->offset += rc;
+    return trace.done(rc);
   } else {
-    return -EBADF;
+    return trace.done(-EBADF);
   }
 }
 
 ssize_t ceph_posix_pread(int fd, void *buf, size_t count, off64_t offset) {
+  XrdCephTraceScope trace(CEPH_TRACE_PREAD, fd, 0, offset, count);
   CephFileRef* fr = getFileRef(fd);
   if (fr) {
-    // TODO implement proper logging level for this plugin - this should be only debug
-    //logwrapper((char*)"ceph_read: for fd %d, count=%d", fd, count);
-    if ((fr->flags & O_WRONLY) != 0) {
-      return -EBADF;
-    }
-    libradosstriper::RadosStriper *striper = getRadosStriper(*fr);
-    if (0 == striper) {
-      return -EINVAL;
-    }
-    ceph::bufferlist bl;
-    int rc = striper->read(fr->name, &bl, count, offset);
-    if (rc < 0) return rc;
-    bl.begin().copy(rc, (char*)buf);
-    XrdSysMutexHelper lock(fr->statsMutex);
-    fr->rdcount++;
-    return rc;
+    return trace.done(ceph_posix_internal_pread(fr, buf, count, offset));
   } else {
-    return -EBADF;
+    return trace.done(-EBADF);
   }
 }
 
-static void ceph_aio_read_complete(rados_completion_t c, void *arg) {
+ssize_t ceph_posix_fh_pread(CephFileRef *fr, void *buf, size_t count, off64_t offset) {
+  XrdCephTraceScope trace(CEPH_TRACE_PREAD, fr->fd, 0, offset, count);
+  return trace.done(ceph_posix_internal_pread(fr, buf, count, offset));
+}
+
+/// completion of asynchronous reads, once the data is in the xrootd buffer
+static void ceph_aio_read_done(AioArgs *awa, int rc) {
+  awa->fr->asyncRdCompletionCount.fetch_add(1, std::memory_order_relaxed);
+  traceAioCompletion(awa, rc);
+  awa->callback(awa->aiop, rc );
+  delete(awa);
+}
+
+static void ceph_aio_read_complete(void *arg, int rc) {
   AioArgs *awa = reinterpret_cast<AioArgs*>(arg);
-  size_t rc = rados_aio_get_return_value(c);
-  if (awa->bl) {
-    if (rc > 0) {
-      awa->bl->begin().copy(rc, (char*)awa->aiop->sfsAio.aio_buf);
+  g_cephRegistry.opDone(awa->fr->connIdx, awa->nbBytes);
+  checkConnection(awa->fr->connIdx, awa->fr->connGeneration, rc);
+  completeRead(awa->bl, (void*)awa->aiop->sfsAio.aio_buf, rc);
+  ceph_aio_read_done(awa, rc);
+}
+
+/// completion of split asynchronous reads, accounted piece by piece
+static void ceph_aio_split_read_complete(void *arg, int rc) {
+  ceph_aio_read_done(reinterpret_cast<AioArgs*>(arg), rc);
+}
+
+/// completion of direct asynchronous reads, for the length of the read
+static void ceph_aio_direct_read_complete(void *arg, int rc) {
+  AioArgs *awa = reinterpret_cast<AioArgs*>(arg);
+  ceph_aio_read_done(awa, rc < 0 ? rc : awa->nbBytes);
+}
+
+static ssize_t ceph_aio_internal_read(CephFileRef *fr, XrdSfsAio *aiop, AioCB *cb,
+                                      XrdCephTraceScope &trace) {
+  // get the parameters from the Xroot aio object
+  size_t count = aiop->sfsAio.aio_nbytes;
+  size_t offset = aiop->sfsAio.aio_offset;
+  // TODO implement proper logging level for this plugin - this should be only debug
+  //logwrapper((char*)"ceph_aio_read: for fd %d, count=%d", fr->fd, count);
+  if ((fr->flags & O_WRONLY) != 0) {
+    return -EBADF;
+  }
+  // prepare the callback arguments, with a bufferlist receiving the data
+  // in the xrootd buffer, and do async call
+  AioArgs *args = new AioArgs(aiop, cb, count, fr);
+  args->traced = trace.defer(args->traceRecord);
+  fr->asyncRdStartCount.fetch_add(1, std::memory_order_relaxed);
+  int rc = 0;
+  if (useDirectRead(fr)) {
+    size_t length = directReadLength(fr, count, offset);
+    args->nbBytes = length;
+    if (length) {
+      XrdOucIOVec seg = {(long long)offset, (int)length, 0, (char*)aiop->sfsAio.aio_buf};
+      rc = ceph_direct_read(fr, fr->layout, &seg, 1, ceph_aio_direct_read_complete, args);
+    } else {
+      // at or past the end of the file read at open time, as for pread
+      ceph_aio_direct_read_complete(args, 0);
     }
-    delete awa->bl;
-    awa->bl = 0;
+  } else if (isSplitRead(count)) {
+    rc = ceph_split_io(fr, false, (char*)aiop->sfsAio.aio_buf, count, offset, ceph_aio_split_read_complete, args);
+  } else {
+    // do the read, accounted on the connection until its completion
+    g_cephRegistry.opStarted(fr->connIdx, count);
+    rc = checkConnection(fr->connIdx, fr->connGeneration, fr->striper->aio_read(fr->name, &args->bl, count, offset, ceph_aio_read_complete, args));
+    if (rc) g_cephRegistry.opDone(fr->connIdx, count);
   }
-  // Compute statistics before reportng to xrootd, so that a close cannot happen
-  // in the meantime.
-  CephFileRef* fr = getFileRef(awa->fd);
-  if (fr) {
-    XrdSysMutexHelper lock(fr->statsMutex);
-    fr->asyncRdCompletionCount++;
+  if (0 == rc) {
+    trace.deferred();
+  } else {
+    // the completion will not be called
+    fr->asyncRdStartCount.fetch_sub(1, std::memory_order_relaxed);
+    delete args;
   }
-  awa->callback(awa->aiop, rc );
-  delete(awa);
+  return rc;
 }
 
 ssize_t ceph_aio_read(int fd, XrdSfsAio *aiop, AioCB *cb) {
+  XrdCephTraceScope trace(CEPH_TRACE_AIO_READ, fd, 0, aiop->sfsAio.aio_offset, aiop->sfsAio.aio_nbytes);
   CephFileRef* fr = getFileRef(fd);
   if (fr) {
-    // get the parameters from the Xroot aio object
-    size_t count = aiop->sfsAio.aio_nbytes;
-    size_t offset = aiop->sfsAio.aio_offset;
-    // TODO implement proper logging level for this plugin - this should be only debug
-    //logwrapper((char*)"ceph_aio_read: for fd %d, count=%d", fd, count);
-    if ((fr->flags & O_WRONLY) != 0) {
-      return -EBADF;
+    return trace.done(ceph_aio_internal_read(fr, aiop, cb, trace));
+  } else {
+    return trace.done(-EBADF);
+  }
+}
+
+ssize_t ceph_aio_fh_read(CephFileRef *fr, XrdSfsAio *aiop, AioCB *cb) {
+  XrdCephTraceScope trace(CEPH_TRACE_AIO_READ, fr->fd, 0, aiop->sfsAio.aio_offset, aiop->sfsAio.aio_nbytes);
+  return trace.done(ceph_aio_internal_read(fr, aiop, cb, trace));
+}
+
+/// segments of a vectored read close to each other in the file, read in one go
+struct CephReadVRun {
+  CephAioGroup *group;
+  unsigned long long offset;
+  size_t length;
+  ceph::bufferlist bl;
+  int rc;
+};
+
+static void ceph_readv_complete(void *arg, int rc) {
+  CephReadVRun *run = reinterpret_cast<CephReadVRun*>(arg);
+  run->rc = rc;
+  run->group->done();
+}
+
+/**
+ * vectored read through the striper. The segments are sorted and the ones
+ * close in the file are gathered into a single read, holes smaller than
+ * g_readVMergeGap being read along. All reads are in flight together and the
+ * segments are copied out of them once they all completed
+ */
+static ssize_t ceph_posix_striper_readv(CephFileRef *fr, XrdOucIOVec *readV, int n) {
+  std::vector<int> order;
+  order.reserve(n);
+  for (int i = 0; i < n; i++) {
+    if (readV[i].size < 0) return -EINVAL;
+    if (readV[i].offset < 0) return -ESPIPE;
+    if (readV[i].size > 0) order.push_back(i);
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [readV](int a, int b) { return readV[a].offset < readV[b].offset; });
+  // gather the close segments into runs, remembering the run of each segment
+  std::vector<CephReadVRun> runs;
+  runs.reserve(order.size());
+  std::vector<size_t> segRuns(n, 0);
+  unsigned long long total = 0;
+  for (std::vector<int>::const_iterator it = order.begin(); it != order.end(); it++) {
+    const XrdOucIOVec &seg = readV[*it];
+    unsigned long long end = seg.offset + seg.size;
+    total += seg.size;
+    if (!runs.empty()) {
+      // runs stay within the int returned by the striper
+      CephReadVRun &last = runs.back();
+      unsigned long long runEnd = std::max(end, last.offset + last.length);
+      if ((unsigned long long)seg.offset <= last.offset + last.length + g_readVMergeGap &&
+          runEnd - last.offset <= (unsigned long long)std::numeric_limits<int>::max()) {
+        last.length = runEnd - last.offset;
+        segRuns[*it] = runs.size() - 1;
+        continue;
+      }
     }
-    // get the striper object
-    libradosstriper::RadosStriper *striper = getRadosStriper(*fr);
-    if (0 == striper) {
-      return -EINVAL;
+    runs.push_back(CephReadVRun());
+    runs.back().offset = seg.offset;
+    runs.back().length = seg.size;
+    segRuns[*it] = runs.size() - 1;
+  }
+  // all runs in flight together, accounted on the connection until done
+  CephInflightOp inflight(fr->connIdx, total);
+  CephAioGroup group;
+  int rc = 0;
+  for (std::vector<CephReadVRun>::iterator it = runs.begin(); it != runs.end(); it++) {
+    it->group = &group;
+    it->rc = 0;
+    group.started();
+    rc = fr->striper->aio_read(fr->name, &it->bl, it->length, it->offset, ceph_readv_complete, &*it);
+    if (rc < 0) {
+      // the completion will not be called
+      group.done();
+      break;
     }
-    // prepare a bufferlist to receive data
-    ceph::bufferlist *bl = new ceph::bufferlist();
-    // get the poolIdx to use
-    int cephPoolIdx = getCephPoolIdxAndIncrease();
-    // Get the cluster to use
-    librados::Rados* cluster = checkAndCreateCluster(cephPoolIdx);
-    if (0 == cluster) {
-      return -EINVAL;
+  }
+  group.wait();
+  for (std::vector<CephReadVRun>::const_iterator it = runs.begin(); it != runs.end() && rc >= 0; it++) {
+    rc = it->rc;
+  }
+  if (rc < 0) return checkConnection(fr->connIdx, fr->connGeneration, rc);
+  for (std::vector<int>::const_iterator it = order.begin(); it != order.end(); it++) {
+    const XrdOucIOVec &seg = readV[*it];
+    const CephReadVRun &run = runs[segRuns[*it]];
+    size_t pos = seg.offset - run.offset;
+    // runs stop at the end of the file
+    if ((size_t)run.rc < pos + seg.size) return -ESPIPE;
+    run.bl.copy(pos, seg.size, seg.data);
+  }
+  fr->rdcount.fetch_add(1, std::memory_order_relaxed);
+  return total;
+}
+
+/**
+ * Vectored read. Files with direct reads get their segments straight from
+ * their rados objects (See ceph_direct_read), using the layout and size read
+ * at open time. Other files go through the striper, see
+ * ceph_posix_striper_readv.
+ * As for XrdOssDF::ReadV, -ESPIPE is returned if a segment is beyond the end
+ * of the file
+ */
+static ssize_t ceph_posix_internal_readv(CephFileRef *fr, XrdOucIOVec *readV, int n) {
+  if ((fr->flags & O_WRONLY) != 0) {
+    return -EBADF;
+  }
+  if (!useDirectRead(fr)) {
+    return ceph_posix_striper_readv(fr, readV, n);
+  }
+  for (int i = 0; i < n; i++) {
+    if (readV[i].size < 0) return -EINVAL;
+    if (readV[i].offset < 0 || (unsigned long long)readV[i].offset + readV[i].size > fr->layout.size) {
+      return -ESPIPE;
     }
-    // prepare a ceph AioCompletion object and do async call
-    AioArgs *args = new AioArgs(aiop, cb, count, fd, bl);
-    librados::AioCompletion *completion =
-      cluster->aio_create_completion(args, ceph_aio_read_complete, NULL);
-    // do the read
-    int rc = striper->aio_read(fr->name, completion, bl, count, offset);
-    completion->release();
-    XrdSysMutexHelper lock(fr->statsMutex);
-    fr->asyncRdStartCount++;
-    return rc;
-  } else {
+  }
+  CephSplitWait wait;
+  wait.group.started();
+  int rc = ceph_direct_read(fr, fr->layout, readV, n, ceph_split_wait_complete, &wait);
+  if (rc < 0) return rc;
+  wait.group.wait();
+  if (wait.rc < 0) return wait.rc;
+  fr->rdcount.fetch_add(1, std::memory_order_relaxed);
+  return ioVecLength(readV, n);
+}
+
+ssize_t ceph_posix_fh_readv(CephFileRef *fr, XrdOucIOVec *readV, int n) {
+  // traced with the offset of the first segment and the total length
+  XrdCephTraceScope trace(CEPH_TRACE_READV, fr->fd, 0, n > 0 ? readV[0].offset : 0, ioVecLength(readV, n));
+  return trace.done(ceph_posix_internal_readv(fr, readV, n));
+}
+
+/// segments of a vectored write contiguous in the file, written in one go
+struct CephWriteVRun {
+  CephAioGroup *group;
+  unsigned long long offset;
+  ceph::bufferlist bl;
+  int rc;
+};
+
+static void ceph_writev_complete(void *arg, int rc) {
+  CephWriteVRun *run = reinterpret_cast<CephWriteVRun*>(arg);
+  run->rc = rc;
+  run->group->done();
+}
+
+/**
+ * Vectored write. The segments are sorted, the ones contiguous in the file
+ * are gathered into a single write, without copy, and all writes are in
+ * flight together. The call returns once all of them are acknowledged.
+ * Writes go through the striper, which keeps the size of the file and its
+ * locks consistent. Overlapping segments are written one after the other,
+ * so that the last one wins as with sequential writes
+ */
+static ssize_t ceph_posix_internal_writev(CephFileRef *fr, XrdOucIOVec *writeV, int n) {
+  if ((fr->flags & (O_WRONLY|O_RDWR)) == 0) {
     return -EBADF;
   }
+  std::vector<int> order;
+  order.reserve(n);
+  for (int i = 0; i < n; i++) {
+    if (writeV[i].size < 0 || writeV[i].offset < 0) return -EINVAL;
+    if (writeV[i].size > 0) order.push_back(i);
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [writeV](int a, int b) { return writeV[a].offset < writeV[b].offset; });
+  // gather the contiguous segments into runs
+  std::vector<CephWriteVRun> runs;
+  runs.reserve(order.size());
+  unsigned long long total = 0;
+  for (std::vector<int>::const_iterator it = order.begin(); it != order.end(); it++) {
+    const XrdOucIOVec &seg = writeV[*it];
+    if (!runs.empty()) {
+      unsigned long long end = runs.back().offset + runs.back().bl.length();
+      if ((unsigned long long)seg.offset < end) {
+        ssize_t written = 0;
+        for (int i = 0; i < n; i++) {
+          ssize_t rc = ceph_posix_internal_pwrite(fr, writeV[i].data, writeV[i].size, writeV[i].offset);
+          if (rc < 0) return rc;
+          written += rc;
+        }
+        return written;
+      }
+      if ((unsigned long long)seg.offset == end) {
+        prepareWrite(runs.back().bl, seg.data, seg.size);
+        total += seg.size;
+        continue;
+      }
+    }
+    runs.push_back(CephWriteVRun());
+    runs.back().offset = seg.offset;
+    prepareWrite(runs.back().bl, seg.data, seg.size);
+    total += seg.size;
+  }
+  // all runs in flight together, accounted on the connection until done
+  CephInflightOp inflight(fr->connIdx, total);
+  CephAioGroup group;
+  int rc = 0;
+  for (std::vector<CephWriteVRun>::iterator it = runs.begin(); it != runs.end(); it++) {
+    it->group = &group;
+    it->rc = 0;
+    group.started();
+    rc = fr->striper->aio_write(fr->name, it->bl, it->bl.length(), it->offset,
+                                ceph_writev_complete, &*it);
+    if (rc < 0) {
+      // the completion will not be called
+      group.done();
+      break;
+    }
+  }
+  group.wait();
+  for (std::vector<CephWriteVRun>::const_iterator it = runs.begin(); it != runs.end() && 0 == rc; it++) {
+    rc = it->rc;
+  }
+  if (rc < 0) return checkConnection(fr->connIdx, fr->connGeneration, rc);
+  fr->wrcount.fetch_add(1, std::memory_order_relaxed);
+  fr->bytesWritten.fetch_add(total, std::memory_order_relaxed);
+  if (!runs.empty()) atomicMax(fr->maxOffsetWritten, runs.back().offset + runs.back().bl.length() - 1);
+  return total;
+}
+
+ssize_t ceph_posix_fh_writev(CephFileRef *fr, XrdOucIOVec *writeV, int n) {
+  // traced with the offset of the first segment and the total length
+  XrdCephTraceScope trace(CEPH_TRACE_WRITEV, fr->fd, 0, n > 0 ? writeV[0].offset : 0, ioVecLength(writeV, n));
+  return trace.done(ceph_posix_internal_writev(fr, writeV, n));
+}
+
+static int ceph_posix_internal_fstat(CephFileRef *fr, struct stat *buf) {
+  logwrapper((char*)"ceph_stat: fd %d", fr->fd);
+  // minimal stat : only size and times are filled
+  // atime, mtime and ctime are set all to the same value
+  // mode is set arbitrarily to 0666 | S_IFREG
+  memset(buf, 0, sizeof(*buf));
+  CephInflightOp inflight(fr->connIdx, 0);
+  int rc = checkConnection(fr->connIdx, fr->connGeneration, fr->striper->stat(fr->name, (uint64_t*)&(buf->st_size), &(buf->st_atime)));
+  if (rc != 0) {
+    return -rc;
+  }
+  buf->st_mtime = buf->st_atime;
+  buf->st_ctime = buf->st_atime;
+  buf->st_mode = 0666 | S_IFREG;
+  return 0;
 }
 
 int ceph_posix_fstat(int fd, struct stat *buf) {
+  XrdCephTraceScope trace(CEPH_TRACE_FSTAT, fd);
   CephFileRef* fr = getFileRef(fd);
   if (fr) {
-    logwrapper((char*)"ceph_stat: fd %d", fd);
-    // minimal stat : only size and times are filled
-    // atime, mtime and ctime are set all to the same value
-    // mode is set arbitrarily to 0666 | S_IFREG
-    libradosstriper::RadosStriper *striper = getRadosStriper(*fr);
-    if (0 == striper) {
-      logwrapper((char*)"ceph_stat: getRadosStriper failed");
-      return -EINVAL;
-    }
-    memset(buf, 0, sizeof(*buf));
-    int rc = striper->stat(fr->name, (uint64_t*)&(buf->st_size), &(buf->st_atime));
-    if (rc != 0) {
-      return -rc;
-    }
-    buf->st_mtime = buf->st_atime;
-    buf->st_ctime = buf->st_atime;
-    buf->st_mode = 0666 | S_IFREG;
-    return 0;
+    return trace.done(ceph_posix_internal_fstat(fr, buf));
   } else {
-    return -EBADF;
+    return trace.done(-EBADF);
   }
 }
 
+int ceph_posix_fh_fstat(CephFileRef *fr, struct stat *buf) {
+  XrdCephTraceScope trace(CEPH_TRACE_FSTAT, fr->fd);
+  return trace.done(ceph_posix_internal_fstat(fr, buf));
+}
+
 int ceph_posix_stat(XrdOucEnv* env, const char *pathname, struct stat *buf) {
+  XrdCephTraceScope trace(CEPH_TRACE_STAT, -1, pathname);
   logwrapper((char*)"ceph_stat: %s", pathname);
   // minimal stat : only size and times are filled
   // atime, mtime and ctime are set all to the same value
   // mode is set arbitrarily to 0666 | S_IFREG
   CephFile file = getCephFile(pathname, env);
-  libradosstriper::RadosStriper *striper = getRadosStriper(file);
+  CephHandles handles;
+  XrdCephStriper *striper = getRadosStriper(file, handles);
   if (0 == striper) {
-    return -EINVAL;
+    return trace.done(-EINVAL);
   }
   memset(buf, 0, sizeof(*buf));
-  int rc = striper->stat(file.name, (uint64_t*)&(buf->st_size), &(buf->st_atime));
+  int rc = checkConnection(handles.idx, handles.generation, striper->stat(file.name, (uint64_t*)&(buf->st_size), &(buf->st_atime)));
   if (rc != 0) {
     // for non existing file. Check that we did not open it for write recently
     // in that case, we return 0 size and current time
@@ -1036,45 +2414,46 @@ int ceph_posix_stat(XrdOucEnv* env, const char *pathname, struct stat *buf) {
       buf->st_size = 0;
       buf->st_atime = time(NULL);
     } else {
-      return -rc;
+      return trace.done(-rc);
     }
   }
   buf->st_mtime = buf->st_atime;
   buf->st_ctime = buf->st_atime;
   buf->st_mode = 0666 | S_IFREG;
-  return 0;
+  return trace.done(0);
 }
 
 int ceph_posix_fsync(int fd) {
+  XrdCephTraceScope trace(CEPH_TRACE_FSYNC, fd);
   CephFileRef* fr = getFileRef(fd);
   if (fr) {
     // no locking of fr as it is not used.
     logwrapper((char*)"ceph_sync: fd %d", fd);
-    return 0;
+    return trace.done(0);
   } else {
-    return -EBADF;
+    return trace.done(-EBADF);
   }
 }
 
 int ceph_posix_fcntl(int fd, int cmd, ... /* arg */ ) {
+  XrdCephTraceScope trace(CEPH_TRACE_FCNTL, fd, 0, cmd);
   CephFileRef* fr = getFileRef(fd);
   if (fr) {
     logwrapper((char*)"ceph_fcntl: fd %d cmd=%d", fd, cmd);
     // minimal implementation
     switch (cmd) {
     case F_GETFL:
-      return fr->mode;
+      return trace.done(fr->mode);
     default:
-      return -EINVAL;
+      return trace.done(-EINVAL);
     }
   } else {
-    return -EBADF;
+    return trace.done(-EBADF);
   }
 }
 
-static ssize_t ceph_posix_internal_getxattr(const CephFile &file, const char* name,
+static ssize_t ceph_posix_internal_getxattr(XrdCephStriper *striper, const CephFile &file, const char* name,
                                             void* value, size_t size) {
-  libradosstriper::RadosStriper *striper = getRadosStriper(file);
   if (0 == striper) {
     return -EINVAL;
   }
@@ -1089,24 +2468,28 @@ static ssize_t ceph_posix_internal_getxattr(const CephFile &file, const char* na
 ssize_t ceph_posix_getxattr(XrdOucEnv* env, const char* path,
                             const char* name, void* value,
                             size_t size) {
+  XrdCephTraceScope trace(CEPH_TRACE_GETXATTR, -1, path, 0, size);
   logwrapper((char*)"ceph_getxattr: path %s name=%s", path, name);
-  return ceph_posix_internal_getxattr(getCephFile(path, env), name, value, size);
+  CephFile file = getCephFile(path, env);
+  CephHandles handles;
+  return trace.done(ceph_posix_internal_getxattr(getRadosStriper(file, handles), file, name, value, size));
 }
 
 ssize_t ceph_posix_fgetxattr(int fd, const char* name,
                              void* value, size_t size) {
+  XrdCephTraceScope trace(CEPH_TRACE_FGETXATTR, fd, 0, 0, size);
   CephFileRef* fr = getFileRef(fd);
   if (fr) {
     logwrapper((char*)"ceph_fgetxattr: fd %d name=%s", fd, name);
-    return ceph_posix_internal_getxattr(*fr, name, value, size);
+    CephInflightOp inflight(fr->connIdx, 0);
+    return trace.done(ceph_posix_internal_getxattr(fr->striper, *fr, name, value, size));
   } else {
-    return -EBADF;
+    return trace.done(-EBADF);
   }
 }
 
-static ssize_t ceph_posix_internal_setxattr(const CephFile &file, const char* name,
+static ssize_t ceph_posix_internal_setxattr(XrdCephStriper *striper, const CephFile &file, const char* name,
                                             const void* value, size_t size, int flags) {
-  libradosstriper::RadosStriper *striper = getRadosStriper(file);
   if (0 == striper) {
     return -EINVAL;
   }
@@ -1122,24 +2505,28 @@ static ssize_t ceph_posix_internal_setxattr(const CephFile &file, const char* na
 ssize_t ceph_posix_setxattr(XrdOucEnv* env, const char* path,
                             const char* name, const void* value,
                             size_t size, int flags) {
+  XrdCephTraceScope trace(CEPH_TRACE_SETXATTR, -1, path, 0, size);
   logwrapper((char*)"ceph_setxattr: path %s name=%s value=%s", path, name, value);
-  return ceph_posix_internal_setxattr(getCephFile(path, env), name, value, size, flags);
+  CephFile file = getCephFile(path, env);
+  CephHandles handles;
+  return trace.done(ceph_posix_internal_setxattr(getRadosStriper(file, handles), file, name, value, size, flags));
 }
 
 int ceph_posix_fsetxattr(int fd,
                          const char* name, const void* value,
                          size_t size, int flags)  {
+  XrdCephTraceScope trace(CEPH_TRACE_FSETXATTR, fd, 0, 0, size);
   CephFileRef* fr = getFileRef(fd);
   if (fr) {
     logwrapper((char*)"ceph_fsetxattr: fd %d name=%s value=%s", fd, name, value);
-    return ceph_posix_internal_setxattr(*fr, name, value, size, flags);
+    CephInflightOp inflight(fr->connIdx, 0);
+    return trace.done(ceph_posix_internal_setxattr(fr->striper, *fr, name, value, size, flags));
   } else {
-    return -EBADF;
+    return trace.done(-EBADF);
   }
 }
 
-static int ceph_posix_internal_removexattr(const CephFile &file, const char* name) {
-  libradosstriper::RadosStriper *striper = getRadosStriper(file);
+static int ceph_posix_internal_removexattr(XrdCephStriper *striper, const CephFile &file, const char* name) {
   if (0 == striper) {
     return -EINVAL;
   }
@@ -1152,22 +2539,26 @@ static int ceph_posix_internal_removexattr(const CephFile &file, const char* nam
 
 int ceph_posix_removexattr(XrdOucEnv* env, const char* path,
                            const char* name) {
+  XrdCephTraceScope trace(CEPH_TRACE_REMOVEXATTR, -1, path);
   logwrapper((char*)"ceph_removexattr: path %s name=%s", path, name);
-  return ceph_posix_internal_removexattr(getCephFile(path, env), name);
+  CephFile file = getCephFile(path, env);
+  CephHandles handles;
+  return trace.done(ceph_posix_internal_removexattr(getRadosStriper(file, handles), file, name));
 }
 
 int ceph_posix_fremovexattr(int fd, const char* name) {
+  XrdCephTraceScope trace(CEPH_TRACE_FREMOVEXATTR, fd);
   CephFileRef* fr = getFileRef(fd);
   if (fr) {
     logwrapper((char*)"ceph_fremovexattr: fd %d name=%s", fd, name);
-    return ceph_posix_internal_removexattr(*fr, name);
+    CephInflightOp inflight(fr->connIdx, 0);
+    return trace.done(ceph_posix_internal_removexattr(fr->striper, *fr, name));
   } else {
-    return -EBADF;
+    return trace.done(-EBADF);
   }
 }
 
-static int ceph_posix_internal_listxattrs(const CephFile &file, XrdSysXAttr::AList **aPL, int getSz) {
-  libradosstriper::RadosStriper *striper = getRadosStriper(file);
+static int ceph_posix_internal_listxattrs(XrdCephStriper *striper, const CephFile &file, XrdSysXAttr::AList **aPL, int getSz) {
   if (0 == striper) {
     return -EINVAL;
   }
@@ -1201,17 +2592,22 @@ static int ceph_posix_internal_listxattrs(const CephFile &file, XrdSysXAttr::ALi
 }
 
 int ceph_posix_listxattrs(XrdOucEnv* env, const char* path, XrdSysXAttr::AList **aPL, int getSz) {
+  XrdCephTraceScope trace(CEPH_TRACE_LISTXATTRS, -1, path);
   logwrapper((char*)"ceph_listxattrs: path %s", path);
-  return ceph_posix_internal_listxattrs(getCephFile(path, env), aPL, getSz);
+  CephFile file = getCephFile(path, env);
+  CephHandles handles;
+  return trace.done(ceph_posix_internal_listxattrs(getRadosStriper(file, handles), file, aPL, getSz));
 }
 
 int ceph_posix_flistxattrs(int fd, XrdSysXAttr::AList **aPL, int getSz) {
+  XrdCephTraceScope trace(CEPH_TRACE_FLISTXATTRS, fd);
   CephFileRef* fr = getFileRef(fd);
   if (fr) {
     logwrapper((char*)"ceph_flistxattrs: fd %d", fd);
-    return ceph_posix_internal_listxattrs(*fr, aPL, getSz);
+    CephInflightOp inflight(fr->connIdx, 0);
+    return trace.done(ceph_posix_internal_listxattrs(fr->striper, *fr, aPL, getSz));
   } else {
-    return -EBADF;
+    return trace.done(-EBADF);
   }
 }
 
@@ -1225,99 +2621,123 @@ void ceph_posix_freexattrlist(XrdSysXAttr::AList *aPL) {
 }
 
 int ceph_posix_statfs(long long *totalSpace, long long *freeSpace) {
+  XrdCephTraceScope trace(CEPH_TRACE_STATFS, -1);
   logwrapper((char*)"ceph_posix_statfs");
-  // get the poolIdx to use
-  int cephPoolIdx = getCephPoolIdxAndIncrease();
-  // Get the cluster to use
-  librados::Rados* cluster = checkAndCreateCluster(cephPoolIdx);
-  if (0 == cluster) {
-    return -EINVAL;
-  }
-  // call ceph stat
-  librados::cluster_stat_t result;
-  int rc = cluster->cluster_stat(result);
-  if (0 == rc) {
-    *totalSpace = result.kb * 1024;
-    *freeSpace = result.kb_avail * 1024;
+  // space of all clusters served, the default one and the additional ones
+  *totalSpace = 0;
+  *freeSpace = 0;
+  for (unsigned int c = 0; c <= g_cephClusters.size(); c++) {
+    // get the poolIdx to use
+    int cephPoolIdx = getCephPoolIdx(CEPH_CLASS_METADATA, c);
+    // Get the cluster to use
+    unsigned long long generation = g_cephRegistry.generation(cephPoolIdx);
+    XrdCephCluster* cluster = getCluster(cephPoolIdx);
+    if (0 == cluster) {
+      return trace.done(-EINVAL);
+    }
+    CephInflightOp inflight(cephPoolIdx, 0);
+    // call ceph stat
+    librados::cluster_stat_t result;
+    int rc = checkConnection(cephPoolIdx, generation, cluster->cluster_stat(result));
+    if (rc) {
+      return trace.done(rc);
+    }
+    *totalSpace += result.kb * 1024;
+    *freeSpace += result.kb_avail * 1024;
   }
-  return rc;
+  return trace.done(0);
 }
 
-static int ceph_posix_internal_truncate(const CephFile &file, unsigned long long size) {
-  libradosstriper::RadosStriper *striper = getRadosStriper(file);
+static int ceph_posix_internal_truncate(XrdCephStriper *striper, const CephFile &file, unsigned long long size) {
   if (0 == striper) {
     return -EINVAL;
   }
-  return striper->trunc(file.name, size);
+  int rc = striper->trunc(file.name, size);
+  g_filesOpenForWrite.written(file.name);
+  return rc;
 }
 
 int ceph_posix_ftruncate(int fd, unsigned long long size) {
+  XrdCephTraceScope trace(CEPH_TRACE_FTRUNCATE, fd, 0, 0, size);
   CephFileRef* fr = getFileRef(fd);
   if (fr) {
     logwrapper((char*)"ceph_posix_ftruncate: fd %d, size %d", fd, size);
-    return ceph_posix_internal_truncate(*fr, size);
+    CephInflightOp inflight(fr->connIdx, 0);
+    return trace.done(ceph_posix_internal_truncate(fr->striper, *fr, size));
   } else {
-    return -EBADF;
+    return trace.done(-EBADF);
   }
 }
 
 int ceph_posix_truncate(XrdOucEnv* env, const char *pathname, unsigned long long size) {
+  XrdCephTraceScope trace(CEPH_TRACE_TRUNCATE, -1, pathname, 0, size);
   logwrapper((char*)"ceph_posix_truncate : %s", pathname);
   // minimal stat : only size and times are filled
   CephFile file = getCephFile(pathname, env);
-  return ceph_posix_internal_truncate(file, size);
+  CephHandles handles;
+  return trace.done(ceph_posix_internal_truncate(getRadosStriper(file, handles), file, size));
 }
 
 int ceph_posix_unlink(XrdOucEnv* env, const char *pathname) {
+  XrdCephTraceScope trace(CEPH_TRACE_UNLINK, -1, pathname);
   logwrapper((char*)"ceph_posix_unlink : %s", pathname);
   // minimal stat : only size and times are filled
   CephFile file = getCephFile(pathname, env);
-  libradosstriper::RadosStriper *striper = getRadosStriper(file);
+  CephHandles handles;
+  XrdCephStriper *striper = getRadosStriper(file, handles);
   if (0 == striper) {
-    return -EINVAL;
+    return trace.done(-EINVAL);
   }
-  return striper->remove(file.name);
+  int rc = striper->remove(file.name);
+  g_filesOpenForWrite.written(file.name);
+  return trace.done(rc);
 }
 
 DIR* ceph_posix_opendir(XrdOucEnv* env, const char *pathname) {
+  XrdCephTraceScope trace(CEPH_TRACE_OPENDIR, -1, pathname);
   logwrapper((char*)"ceph_posix_opendir : %s", pathname);
   // only accept root dir, as there is no concept of dirs in object stores
   CephFile file = getCephFile(pathname, env);
   if (file.name.size() != 1 || file.name[0] != '/') {
     errno = -ENOENT;
-    return 0;
+    return trace.done((DIR*)0);
   }
-  librados::IoCtx *ioctx = getIoCtx(file);
+  CephHandles handles;
+  XrdCephIoCtx *ioctx = getIoCtx(file, handles);
   if (0 == ioctx) {
     errno = EINVAL;
-    return 0;
+    return trace.done((DIR*)0);
   }
   DirIterator* res = new DirIterator();
-  res->m_iterator = ioctx->nobjects_begin();
-  res->m_ioctx = ioctx;
-  return (DIR*)res;
+  res->m_list = ioctx->list_objects();
+  handles.detach(res->m_slot, res->m_session);
+  return trace.done((DIR*)res);
 }
 
 int ceph_posix_readdir(DIR *dirp, char *buff, int blen) {
-  librados::NObjectIterator &iterator = ((DirIterator*)dirp)->m_iterator;
-  librados::IoCtx *ioctx = ((DirIterator*)dirp)->m_ioctx;
-  while (iterator->get_oid().compare(iterator->get_oid().size()-17, 17, ".0000000000000000") &&
-         iterator != ioctx->nobjects_end()) {
-    iterator++;
-  }
-  if (iterator == ioctx->nobjects_end()) {
-    buff[0] = 0;
-  } else {
-    int l = iterator->get_oid().size()-17;
-    if (l < blen) blen = l;
-    strncpy(buff, iterator->get_oid().c_str(), blen-1);
-    buff[blen-1] = 0;
-    iterator++;
+  XrdCephTraceScope trace(CEPH_TRACE_READDIR, -1);
+  XrdCephObjectList *list = ((DirIterator*)dirp)->m_list;
+  // only first objects of striped files are listed
+  std::string oid;
+  while (list->next(oid)) {
+    if (oid.size() > 17 && !oid.compare(oid.size()-17, 17, ".0000000000000000")) {
+      int l = oid.size()-17;
+      if (l+1 < blen) blen = l+1;
+      strncpy(buff, oid.c_str(), blen-1);
+      buff[blen-1] = 0;
+      return trace.done(0);
+    }
   }
-  return 0;
+  buff[0] = 0;
+  return trace.done(0);
 }
 
 int ceph_posix_closedir(DIR *dirp) {
-  delete ((DirIterator*)dirp);
-  return 0;
+  XrdCephTraceScope trace(CEPH_TRACE_CLOSEDIR, -1);
+  DirIterator *dir = (DirIterator*)dirp;
+  delete dir->m_list;
+  if (dir->m_slot) dir->m_slot->release();
+  if (dir->m_session) g_cephRegistry.releaseSession(dir->m_session);
+  delete dir;
+  return trace.done(0);
 }
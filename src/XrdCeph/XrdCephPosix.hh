@@ -36,11 +36,44 @@
 #include <XrdSys/XrdSysXAttr.hh>
 
 class XrdSfsAio;
+struct XrdOucIOVec;
+class XrdCephBackend;
+struct XrdCephRegistryStats;
+struct XrdCephConnectionStats;
 typedef void(AioCB)(XrdSfsAio*, size_t);
 
 void ceph_posix_set_defaults(const char* value);
+/// declares an additional ceph cluster serving the given comma separated pools,
+/// with its own configuration file, keyring and number of connections. Empty
+/// or null confFile and keyring mean the ceph defaults. To be called before
+/// the first connection. Returns 0 or -errno
+int ceph_posix_add_cluster(const char *name, const char *confFile, const char *keyring,
+                           unsigned int nbConnections, const char *pools);
+/// forgets the additional clusters, to be called after ceph_posix_disconnect_all
+void ceph_posix_clear_clusters();
+/// adds a librados option, set on every connection before it connects, or
+/// only on the ones of the given XrdCephConnectionClass. connClass is -1 for
+/// all connections. The option is checked and its effective value logged.
+/// To be called before the first connection. Returns 0 or -errno
+int ceph_posix_add_option(const char *key, const char *value, int connClass);
+/// effective value of a librados option on the given connection, 0 or -errno
+int ceph_posix_get_connection_option(unsigned int idx, const char *key, char *value, size_t size);
+/// forgets the librados options, to be called after ceph_posix_disconnect_all
+void ceph_posix_clear_options();
+/// connects all cluster connections in parallel and creates the ioctxs and
+/// stripers of the given space separated pools, each with the syntax of the
+/// defaults, i.e. [user@]pool[,nbStripes[,stripeUnit[,objectSize]]]
+/// Returns 0 or the -errno of one of the failures
+int ceph_posix_preconnect(const char *pools);
 void ceph_posix_disconnect_all();
 void ceph_posix_set_logfunc(void (*logfunc) (char *, va_list argp));
+/// selects the backend used for new cluster connections (See XrdCephBackend.hh)
+/// to be called before any connection is made or after ceph_posix_disconnect_all
+void ceph_posix_set_backend(XrdCephBackend *backend);
+/// fills the counters of the connection/pool/layout registry (See XrdCephRegistry.hh)
+void ceph_posix_get_registry_stats(XrdCephRegistryStats *stats);
+/// fills the load counters of the given connection, returns 0 or -EINVAL
+int ceph_posix_get_connection_stats(unsigned int idx, XrdCephConnectionStats *stats);
 int ceph_posix_open(XrdOucEnv* env, const char *pathname, int flags, mode_t mode);
 int ceph_posix_close(int fd);
 off_t ceph_posix_lseek(int fd, off_t offset, int whence);
@@ -74,4 +107,21 @@ DIR* ceph_posix_opendir(XrdOucEnv* env, const char *pathname);
 int ceph_posix_readdir(DIR* dirp, char *buff, int blen);
 int ceph_posix_closedir(DIR *dirp);
 
+/// opaque handle on an open file, holding the ceph handles resolved at open time
+struct CephFileRef;
+/// returns the handle of an open file, 0 if fd is not valid.
+/// The handle is valid until ceph_posix_close is called on fd
+CephFileRef* ceph_posix_get_handle(int fd);
+/// equivalents of the fd based calls, sparing the lookup of the file descriptor
+ssize_t ceph_posix_fh_pwrite(CephFileRef *fh, const void *buf, size_t count, off64_t offset);
+ssize_t ceph_aio_fh_write(CephFileRef *fh, XrdSfsAio *aiop, AioCB *cb);
+ssize_t ceph_posix_fh_pread(CephFileRef *fh, void *buf, size_t count, off64_t offset);
+ssize_t ceph_aio_fh_read(CephFileRef *fh, XrdSfsAio *aiop, AioCB *cb);
+/// vectored read of the segments of readV, returning the total length read
+/// or -ESPIPE if a segment goes beyond the end of the file
+ssize_t ceph_posix_fh_readv(CephFileRef *fh, XrdOucIOVec *readV, int n);
+/// vectored write of the segments of writeV, returning the total length written
+ssize_t ceph_posix_fh_writev(CephFileRef *fh, XrdOucIOVec *writeV, int n);
+int ceph_posix_fh_fstat(CephFileRef *fh, struct stat *buf);
+
 #endif // __XRD_CEPH_POSIX__
@@ -0,0 +1,552 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+#include <sched.h>
+#include <time.h>
+#include <algorithm>
+#include <functional>
+
+#include "XrdCeph/XrdCephRegistry.hh"
+
+/// coarse monotonic time in ms, good enough for LRU
+static unsigned long long coarseNowMs() {
+  struct timespec ts;
+#ifdef CLOCK_MONOTONIC_COARSE
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#else
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+  return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+XrdCephPoolEntry::XrdCephPoolEntry(const std::string &userId, const std::string &pool,
+                                   unsigned int nbConnections) :
+  m_userId(userId), m_pool(pool), m_ioctxs(new std::atomic<XrdCephIoCtx*>[nbConnections]),
+  m_nbLayouts(0) {
+  for (unsigned int i = 0; i < nbConnections; i++) {
+    m_ioctxs[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+XrdCephPoolEntry::~XrdCephPoolEntry() {
+  delete[] m_ioctxs;
+}
+
+XrdCephStriper* XrdCephLayoutSlot::acquire() {
+  m_users.fetch_add(1);
+  XrdCephStriper *striper = m_striper.load();
+  if (0 == striper) {
+    m_users.fetch_sub(1, std::memory_order_release);
+    return 0;
+  }
+  // only write the shared time stamp when it changes
+  unsigned long long now = coarseNowMs();
+  if (m_lastUse.load(std::memory_order_relaxed) != now) {
+    m_lastUse.store(now, std::memory_order_relaxed);
+  }
+  return striper;
+}
+
+XrdCephLayout::XrdCephLayout(XrdCephPoolEntry *pool, unsigned int nbStripes,
+                             unsigned long long stripeUnit, unsigned long long objectSize,
+                             size_t hash, unsigned int nbConnections) :
+  m_pool(pool), m_nbStripes(nbStripes), m_stripeUnit(stripeUnit),
+  m_objectSize(objectSize), m_hash(hash), m_slots(new XrdCephLayoutSlot[nbConnections]) {}
+
+XrdCephLayout::~XrdCephLayout() {
+  delete[] m_slots;
+}
+
+XrdCephRegistry::XrdCephRegistry() :
+  m_table(new Table(16)), m_phase(0), m_nbConnections(0), m_clusters(0), m_sessions(0),
+  m_nextGeneration(0), m_nbStripers(0),
+  m_nbIoCtxs(0), m_nbStripersCreated(0), m_nbStripersEvicted(0), m_nbEvictionsFailed(0),
+  m_nbLayouts(0), m_nbLayoutsEvicted(0), m_nbLayoutEvictionsFailed(0), m_nextConnection(0) {
+  m_readers[0].count.store(0, std::memory_order_relaxed);
+  m_readers[1].count.store(0, std::memory_order_relaxed);
+}
+
+XrdCephRegistry::~XrdCephRegistry() {
+  clear();
+  delete m_table.load();
+}
+
+void XrdCephRegistry::init(unsigned int nbConnections) {
+  if (m_nbConnections.load(std::memory_order_acquire)) return;
+  XrdSysMutexHelper lock(m_mutex);
+  if (m_nbConnections.load(std::memory_order_relaxed)) return;
+  if (nbConnections > CEPH_MAX_CONNECTIONS) nbConnections = CEPH_MAX_CONNECTIONS;
+  if (0 == nbConnections) nbConnections = 1;
+  m_clusters = new std::atomic<XrdCephCluster*>[nbConnections];
+  m_sessions = new std::atomic<XrdCephSession*>[nbConnections];
+  m_nbStripers = new std::atomic<unsigned int>[nbConnections];
+  for (unsigned int i = 0; i < nbConnections; i++) {
+    m_clusters[i].store(0, std::memory_order_relaxed);
+    XrdCephSession *session = new XrdCephSession(++m_nextGeneration);
+    m_sessions[i].store(session, std::memory_order_relaxed);
+    m_loads[i].generation.store(session->m_generation, std::memory_order_relaxed);
+    m_nbStripers[i].store(0, std::memory_order_relaxed);
+  }
+  m_nbConnections.store(nbConnections, std::memory_order_release);
+}
+
+size_t XrdCephRegistry::hash(const std::string &userId, const std::string &pool, unsigned int nbStripes,
+                             unsigned long long stripeUnit, unsigned long long objectSize) {
+  std::hash<std::string> strHash;
+  std::hash<unsigned long long> intHash;
+  size_t h = strHash(userId);
+  h = h * 31 + strHash(pool);
+  h = h * 31 + intHash(nbStripes);
+  h = h * 31 + intHash(stripeUnit);
+  h = h * 31 + intHash(objectSize);
+  // spread the low bits used by the table
+  h ^= h >> 17;
+  h *= 0xed5ad4bbU;
+  h ^= h >> 11;
+  return h;
+}
+
+XrdCephLayout* XrdCephRegistry::lookup(const Table *table, size_t hash, const std::string &userId,
+                                       const std::string &pool, unsigned int nbStripes,
+                                       unsigned long long stripeUnit, unsigned long long objectSize) {
+  size_t mask = table->slots.size() - 1;
+  for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+    XrdCephLayout *layout = table->slots[i];
+    if (0 == layout) return 0;
+    if (layout->m_hash == hash && layout->matches(userId, pool, nbStripes, stripeUnit, objectSize)) {
+      return layout;
+    }
+  }
+}
+
+void XrdCephRegistry::place(Table *table, XrdCephLayout *layout) {
+  size_t mask = table->slots.size() - 1;
+  size_t i = layout->m_hash & mask;
+  while (table->slots[i]) i = (i + 1) & mask;
+  table->slots[i] = layout;
+  table->nbLayouts++;
+}
+
+unsigned int XrdCephRegistry::readLock() const {
+  unsigned int phase = m_phase.load() & 1;
+  m_readers[phase].count.fetch_add(1);
+  return phase;
+}
+
+void XrdCephRegistry::synchronize() {
+  // a reader may have loaded the phase just before the first flip and only
+  // be counted after the wait, hence the second one
+  for (unsigned int i = 0; i < 2; i++) {
+    unsigned int phase = m_phase.load(std::memory_order_relaxed) & 1;
+    m_phase.store(phase ^ 1);
+    while (m_readers[phase].count.load()) sched_yield();
+  }
+}
+
+XrdCephRegistry::Table* XrdCephRegistry::copyTable(size_t size, const XrdCephLayout *skipped) const {
+  const Table *table = m_table.load(std::memory_order_relaxed);
+  Table *newTable = new Table(size);
+  for (std::vector<XrdCephLayout*>::const_iterator it = table->slots.begin(); it != table->slots.end(); it++) {
+    if (*it && *it != skipped) place(newTable, *it);
+  }
+  return newTable;
+}
+
+void XrdCephRegistry::publish(Table *table) {
+  Table *old = m_table.exchange(table);
+  synchronize();
+  delete old;
+}
+
+XrdCephLayout* XrdCephRegistry::findAndAcquire(const std::string &userId, const std::string &pool,
+                                               unsigned int nbStripes, unsigned long long stripeUnit,
+                                               unsigned long long objectSize, unsigned int idx,
+                                               XrdCephStriper *&striper) const {
+  size_t h = hash(userId, pool, nbStripes, stripeUnit, objectSize);
+  unsigned int phase = readLock();
+  XrdCephLayout *layout = lookup(m_table.load(), h, userId, pool, nbStripes, stripeUnit, objectSize);
+  striper = layout ? layout->m_slots[idx].acquire() : 0;
+  readUnlock(phase);
+  return striper ? layout : 0;
+}
+
+XrdCephSession* XrdCephRegistry::acquireSession(unsigned int idx) const {
+  unsigned int phase = readLock();
+  XrdCephSession *session = m_sessions[idx].load();
+  session->m_refs.fetch_add(1, std::memory_order_relaxed);
+  readUnlock(phase);
+  return session;
+}
+
+void XrdCephRegistry::releaseSession(XrdCephSession *session) {
+  if (1 != session->m_refs.fetch_sub(1, std::memory_order_acq_rel)) return;
+  // only retired sessions lose their last reference
+  {
+    XrdSysMutexHelper lock(m_mutex);
+    m_retiredSessions.erase(std::find(m_retiredSessions.begin(), m_retiredSessions.end(), session));
+  }
+  // stripers first, as they rely on the ioctxs
+  for (size_t i = 0; i < session->m_stripers.size(); i++) delete session->m_stripers[i];
+  for (size_t i = 0; i < session->m_ioctxs.size(); i++) delete session->m_ioctxs[i];
+  if (session->m_cluster) {
+    session->m_cluster->shutdown();
+    delete session->m_cluster;
+  }
+  delete session;
+}
+
+bool XrdCephRegistry::evictLayout() {
+  unsigned int n = nbConnections();
+  std::vector<XrdCephLayout*> skipped;
+  while (true) {
+    // least recently used layout whose slots are all unpinned
+    const Table *table = m_table.load(std::memory_order_relaxed);
+    XrdCephLayout *victim = 0;
+    unsigned long long victimLastUse = 0;
+    for (std::vector<XrdCephLayout*>::const_iterator it = table->slots.begin(); it != table->slots.end(); it++) {
+      if (0 == *it || std::find(skipped.begin(), skipped.end(), *it) != skipped.end()) continue;
+      unsigned long long lastUse = 0;
+      bool pinned = false;
+      for (unsigned int i = 0; i < n && !pinned; i++) {
+        XrdCephLayoutSlot &slot = (*it)->m_slots[i];
+        pinned = slot.m_users.load(std::memory_order_relaxed) != 0;
+        lastUse = std::max(lastUse, slot.m_lastUse.load(std::memory_order_relaxed));
+      }
+      if (!pinned && (0 == victim || lastUse < victimLastUse)) {
+        victim = *it;
+        victimLastUse = lastUse;
+      }
+    }
+    if (0 == victim) return false;
+    publish(copyTable(table->slots.size(), victim));
+    // readers that found the layout before its removal are gone, but may have pinned it
+    bool pinned = false;
+    for (unsigned int i = 0; i < n && !pinned; i++) {
+      pinned = victim->m_slots[i].m_users.load() != 0;
+    }
+    if (pinned) {
+      Table *newTable = copyTable(m_table.load(std::memory_order_relaxed)->slots.size(), 0);
+      place(newTable, victim);
+      publish(newTable);
+      skipped.push_back(victim);
+      continue;
+    }
+    // nobody can reach it anymore
+    for (unsigned int i = 0; i < n; i++) {
+      XrdCephStriper *striper = victim->m_slots[i].m_striper.load(std::memory_order_relaxed);
+      if (striper) {
+        delete striper;
+        m_nbStripers[i]--;
+      }
+    }
+    XrdCephPoolEntry *pool = victim->m_pool;
+    delete victim;
+    m_nbLayouts--;
+    m_nbLayoutsEvicted++;
+    if (0 == --pool->m_nbLayouts) {
+      for (unsigned int i = 0; i < n; i++) {
+        XrdCephIoCtx *ioctx = pool->m_ioctxs[i].load(std::memory_order_relaxed);
+        if (ioctx) {
+          delete ioctx;
+          m_nbIoCtxs--;
+        }
+      }
+      m_pools.erase(pool->m_userId + '@' + pool->m_pool);
+      delete pool;
+    }
+    return true;
+  }
+}
+
+XrdCephLayout* XrdCephRegistry::findOrInsert(const std::string &userId, const std::string &pool,
+                                             unsigned int nbStripes, unsigned long long stripeUnit,
+                                             unsigned long long objectSize, unsigned int maxLayouts) {
+  size_t h = hash(userId, pool, nbStripes, stripeUnit, objectSize);
+  XrdSysMutexHelper lock(m_mutex);
+  // insertions and removals take the mutex, no need for a read section
+  XrdCephLayout *layout = lookup(m_table.load(std::memory_order_relaxed), h,
+                                 userId, pool, nbStripes, stripeUnit, objectSize);
+  if (layout) return layout;
+  if (maxLayouts) {
+    while (m_nbLayouts.load(std::memory_order_relaxed) >= maxLayouts) {
+      if (!evictLayout()) {
+        m_nbLayoutEvictionsFailed++;
+        break;
+      }
+    }
+  }
+  // layouts of a pool share its entry, and thus its ioctxs
+  XrdCephPoolEntry *&poolEntry = m_pools[userId + '@' + pool];
+  if (0 == poolEntry) poolEntry = new XrdCephPoolEntry(userId, pool, nbConnections());
+  poolEntry->m_nbLayouts++;
+  layout = new XrdCephLayout(poolEntry, nbStripes, stripeUnit, objectSize, h, nbConnections());
+  // copy on write, keeping the load factor under one half
+  const Table *table = m_table.load(std::memory_order_relaxed);
+  size_t size = table->slots.size();
+  if (2 * (table->nbLayouts + 1) > size) size *= 2;
+  Table *newTable = copyTable(size, 0);
+  place(newTable, layout);
+  publish(newTable);
+  m_nbLayouts++;
+  return layout;
+}
+
+void XrdCephRegistry::setIoCtx(XrdCephPoolEntry *pool, unsigned int idx, XrdCephIoCtx *ioctx) {
+  pool->m_ioctxs[idx].store(ioctx, std::memory_order_release);
+  m_nbIoCtxs++;
+}
+
+bool XrdCephRegistry::evictOne(unsigned int idx) {
+  // the table is only replaced under the same serialization as evictions
+  Table *table = m_table.load(std::memory_order_acquire);
+  while (true) {
+    XrdCephLayoutSlot *victim = 0;
+    for (std::vector<XrdCephLayout*>::const_iterator it = table->slots.begin(); it != table->slots.end(); it++) {
+      if (0 == *it) continue;
+      XrdCephLayoutSlot &slot = (*it)->m_slots[idx];
+      if (slot.m_striper.load(std::memory_order_relaxed) && 0 == slot.m_users.load(std::memory_order_relaxed) &&
+          (0 == victim || slot.m_lastUse.load(std::memory_order_relaxed) < victim->m_lastUse.load(std::memory_order_relaxed))) {
+        victim = &slot;
+      }
+    }
+    if (0 == victim) return false;
+    XrdCephStriper *striper = victim->m_striper.exchange(0);
+    if (victim->m_users.load()) {
+      // someone pinned it in the meantime, put it back and look again
+      victim->m_striper.store(striper);
+      continue;
+    }
+    delete striper;
+    m_nbStripers[idx]--;
+    m_nbStripersEvicted++;
+    return true;
+  }
+}
+
+void XrdCephRegistry::setStriper(XrdCephLayout *layout, unsigned int idx, XrdCephStriper *striper,
+                                 unsigned int maxStripers) {
+  if (maxStripers) {
+    while (m_nbStripers[idx].load(std::memory_order_relaxed) >= maxStripers) {
+      if (!evictOne(idx)) {
+        m_nbEvictionsFailed++;
+        break;
+      }
+    }
+  }
+  XrdCephLayoutSlot &slot = layout->m_slots[idx];
+  slot.m_lastUse.store(coarseNowMs(), std::memory_order_relaxed);
+  slot.m_striper.store(striper);
+  m_nbStripers[idx]++;
+  m_nbStripersCreated++;
+}
+
+bool XrdCephRegistry::opResult(unsigned int idx, unsigned long long generation, int rc,
+                               unsigned int maxErrors) {
+  XrdCephConnectionLoad &load = m_loads[idx];
+  // a retired session says nothing about the current one
+  if (generation != load.generation.load(std::memory_order_relaxed)) return false;
+  if (rc != -EBLOCKLISTED && rc != -ETIMEDOUT && rc != -ENOTCONN && rc != -ECONNRESET) {
+    // avoid writing the shared line in the common case
+    if (load.nbErrors.load(std::memory_order_relaxed)) load.nbErrors.store(0, std::memory_order_relaxed);
+    return false;
+  }
+  unsigned int nbErrors = load.nbErrors.fetch_add(1, std::memory_order_relaxed) + 1;
+  if (rc != -EBLOCKLISTED && nbErrors < maxErrors) return false;
+  int expected = CEPH_CONN_HEALTHY;
+  return load.health.compare_exchange_strong(expected, CEPH_CONN_RECOVERING);
+}
+
+void XrdCephRegistry::setHealthy(unsigned int idx) {
+  m_loads[idx].nbErrors.store(0, std::memory_order_relaxed);
+  m_loads[idx].health.store(CEPH_CONN_HEALTHY);
+}
+
+void XrdCephRegistry::retireConnection(unsigned int idx) {
+  XrdSysMutexHelper lock(m_mutex);
+  XrdCephSession *retired = m_sessions[idx].load(std::memory_order_relaxed);
+  XrdCephSession *session = new XrdCephSession(++m_nextGeneration);
+  m_loads[idx].generation.store(session->m_generation);
+  m_sessions[idx].store(session);
+  retired->m_cluster = m_clusters[idx].exchange(0);
+  Table *table = m_table.load(std::memory_order_relaxed);
+  for (std::vector<XrdCephLayout*>::const_iterator it = table->slots.begin(); it != table->slots.end(); it++) {
+    if (0 == *it) continue;
+    XrdCephStriper *striper = (*it)->m_slots[idx].m_striper.exchange(0);
+    if (striper) {
+      retired->m_stripers.push_back(striper);
+      m_nbStripers[idx]--;
+    }
+  }
+  for (std::map<std::string, XrdCephPoolEntry*>::const_iterator it = m_pools.begin(); it != m_pools.end(); it++) {
+    XrdCephIoCtx *ioctx = it->second->m_ioctxs[idx].exchange(0);
+    if (ioctx) {
+      retired->m_ioctxs.push_back(ioctx);
+      m_nbIoCtxs--;
+    }
+  }
+  m_retiredSessions.push_back(retired);
+  m_loads[idx].nbRecoveries++;
+  // pins taken on the retired session while it was still current are all
+  // counted after a grace period, the reference of the registry can go
+  synchronize();
+  lock.UnLock();
+  releaseSession(retired);
+}
+
+void XrdCephRegistry::stats(XrdCephRegistryStats &stats) const {
+  stats.nbConnections = nbConnections();
+  {
+    XrdSysMutexHelper lock(m_mutex);
+    stats.nbPools = m_pools.size();
+    stats.nbRetiredSessions = m_retiredSessions.size();
+  }
+  stats.nbLayouts = m_nbLayouts.load();
+  stats.nbIoCtxs = m_nbIoCtxs.load();
+  stats.nbStripers = 0;
+  for (unsigned int i = 0; i < stats.nbConnections; i++) {
+    stats.nbStripers += m_nbStripers[i].load(std::memory_order_relaxed);
+  }
+  stats.nbStripersCreated = m_nbStripersCreated.load();
+  stats.nbStripersEvicted = m_nbStripersEvicted.load();
+  stats.nbEvictionsFailed = m_nbEvictionsFailed.load();
+  stats.nbLayoutsEvicted = m_nbLayoutsEvicted.load();
+  stats.nbLayoutEvictionsFailed = m_nbLayoutEvictionsFailed.load();
+}
+
+/// per thread random generator, a xorshift seeded from the thread address
+static unsigned int randomConnection(unsigned int nbConnections) {
+  static thread_local unsigned long long state = 0;
+  if (0 == state) state = (unsigned long long)(size_t)&state | 1;
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state % nbConnections;
+}
+
+unsigned int XrdCephRegistry::pickConnection(XrdCephConnectionPolicy policy,
+                                             unsigned int first, unsigned int count,
+                                             unsigned int group, unsigned int nbGroups) {
+  unsigned int n = nbConnections();
+  if (first >= n) first = 0;
+  if (0 == count || first + count > n) count = n - first;
+  // candidates are the connections of the range belonging to the group, i.e.
+  // start, start + nbGroups, ... or the whole range if there are none
+  unsigned int start = first;
+  unsigned int stride = 1;
+  if (nbGroups > 1 && group < nbGroups) {
+    unsigned int groupStart = first + (group + nbGroups - first % nbGroups) % nbGroups;
+    if (groupStart < first + count) {
+      start = groupStart;
+      stride = nbGroups;
+    }
+  }
+  unsigned int nbCandidates = (first + count - start + stride - 1) / stride;
+  if (nbCandidates <= 1) return start;
+  switch (policy) {
+  case CEPH_CONN_LEAST_OUTSTANDING: {
+    // start the scan at a rotating index so that ties are spread
+    unsigned int k = m_nextConnection.fetch_add(1, std::memory_order_relaxed) % nbCandidates;
+    unsigned int best = start + k * stride;
+    unsigned long long bestScore = m_loads[best].score();
+    for (unsigned int i = 1; i < nbCandidates && bestScore > 0; i++) {
+      unsigned int idx = start + ((k + i) % nbCandidates) * stride;
+      unsigned long long score = m_loads[idx].score();
+      if (score < bestScore) {
+        best = idx;
+        bestScore = score;
+      }
+    }
+    return best;
+  }
+  case CEPH_CONN_POWER_OF_TWO: {
+    unsigned int a = randomConnection(nbCandidates);
+    unsigned int b = randomConnection(nbCandidates - 1);
+    if (b >= a) b++;
+    a = start + a * stride;
+    b = start + b * stride;
+    return m_loads[b].score() < m_loads[a].score() ? b : a;
+  }
+  default: {
+    // next healthy connection, or the next one if none is
+    unsigned int k = m_nextConnection.fetch_add(1, std::memory_order_relaxed) % nbCandidates;
+    for (unsigned int i = 0; i < nbCandidates; i++) {
+      unsigned int idx = start + ((k + i) % nbCandidates) * stride;
+      if (m_loads[idx].healthy()) return idx;
+    }
+    return start + k * stride;
+  }
+  }
+}
+
+void XrdCephRegistry::clear() {
+  XrdSysMutexHelper lock(m_mutex);
+  unsigned int nbConnections = m_nbConnections.load(std::memory_order_relaxed);
+  Table *table = m_table.load(std::memory_order_relaxed);
+  // stripers first, as they rely on the ioctxs
+  for (std::vector<XrdCephLayout*>::const_iterator it = table->slots.begin(); it != table->slots.end(); it++) {
+    if (0 == *it) continue;
+    for (unsigned int i = 0; i < nbConnections; i++) {
+      delete (*it)->m_slots[i].m_striper.load(std::memory_order_relaxed);
+    }
+    delete *it;
+  }
+  for (std::map<std::string, XrdCephPoolEntry*>::const_iterator it = m_pools.begin(); it != m_pools.end(); it++) {
+    for (unsigned int i = 0; i < nbConnections; i++) {
+      delete it->second->m_ioctxs[i].load(std::memory_order_relaxed);
+    }
+    delete it->second;
+  }
+  m_pools.clear();
+  // retired sessions still pinned, in the same order
+  for (std::vector<XrdCephSession*>::const_iterator it = m_retiredSessions.begin();
+       it != m_retiredSessions.end(); it++) {
+    for (size_t i = 0; i < (*it)->m_stripers.size(); i++) delete (*it)->m_stripers[i];
+    for (size_t i = 0; i < (*it)->m_ioctxs.size(); i++) delete (*it)->m_ioctxs[i];
+    delete (*it)->m_cluster;
+    delete *it;
+  }
+  m_retiredSessions.clear();
+  for (unsigned int i = 0; i < nbConnections; i++) {
+    delete m_clusters[i].load(std::memory_order_relaxed);
+    delete m_sessions[i].load(std::memory_order_relaxed);
+  }
+  delete[] m_clusters;
+  m_clusters = 0;
+  delete[] m_sessions;
+  m_sessions = 0;
+  delete[] m_nbStripers;
+  m_nbStripers = 0;
+  m_nbConnections.store(0, std::memory_order_release);
+  m_nbIoCtxs = 0;
+  m_nextConnection = 0;
+  for (unsigned int i = 0; i < CEPH_MAX_CONNECTIONS; i++) {
+    m_loads[i].totalOps = 0;
+    m_loads[i].totalBytes = 0;
+    m_loads[i].nbRecoveries = 0;
+    m_loads[i].nbErrors = 0;
+    m_loads[i].health = CEPH_CONN_HEALTHY;
+  }
+  m_nbLayouts = 0;
+  delete table;
+  m_table.store(new Table(16), std::memory_order_release);
+}
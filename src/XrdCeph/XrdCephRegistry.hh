@@ -0,0 +1,400 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+#ifndef _XRD_CEPH_REGISTRY_H
+#define _XRD_CEPH_REGISTRY_H
+
+#include <errno.h>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+#include "XrdSys/XrdSysPthread.hh"
+#include "XrdCeph/XrdCephBackend.hh"
+
+/// a pool used by a given user, with its IoCtx on each cluster connection
+struct XrdCephPoolEntry {
+  XrdCephPoolEntry(const std::string &userId, const std::string &pool, unsigned int nbConnections);
+  ~XrdCephPoolEntry();
+  const std::string m_userId;
+  const std::string m_pool;
+  /// one ioctx per connection, 0 until created. Only freed with the last
+  /// layout of the pool, as the stripers of its layouts are built on top of them
+  std::atomic<XrdCephIoCtx*> *m_ioctxs;
+  /// layouts interned for the pool, protected by the registry mutex
+  unsigned int m_nbLayouts;
+};
+
+//------------------------------------------------------------------------------
+//! The striper of a layout on a given connection.
+//!
+//! Users pin the slot while they use its striper, open files for their whole
+//! lifetime, so that an evicted striper is never deleted under their feet.
+//! Pinning is lock free : users increment m_users then load m_striper, while
+//! eviction swaps m_striper with 0 then checks m_users, restoring the striper
+//! if anyone got in. Sequentially consistent ordering makes sure that one of
+//! the two sides sees the other.
+//------------------------------------------------------------------------------
+struct XrdCephLayoutSlot {
+  XrdCephLayoutSlot() : m_striper(0), m_users(0), m_lastUse(0) {}
+  /// pins the slot, returns its striper or 0 if none, in which case the slot is not pinned
+  XrdCephStriper* acquire();
+  void release() { m_users.fetch_sub(1, std::memory_order_release); }
+  std::atomic<XrdCephStriper*> m_striper;
+  std::atomic<unsigned int> m_users;
+  /// last use, in ms of coarse monotonic time
+  std::atomic<unsigned long long> m_lastUse;
+};
+
+//------------------------------------------------------------------------------
+//! A striping layout in a given pool for a given user, as interned by the
+//! registry, together with its striper on each cluster connection.
+//------------------------------------------------------------------------------
+struct XrdCephLayout {
+  XrdCephLayout(XrdCephPoolEntry *pool, unsigned int nbStripes,
+                unsigned long long stripeUnit, unsigned long long objectSize,
+                size_t hash, unsigned int nbConnections);
+  ~XrdCephLayout();
+  bool matches(const std::string &userId, const std::string &pool, unsigned int nbStripes,
+               unsigned long long stripeUnit, unsigned long long objectSize) const {
+    return nbStripes == m_nbStripes && stripeUnit == m_stripeUnit &&
+      objectSize == m_objectSize && pool == m_pool->m_pool && userId == m_pool->m_userId;
+  }
+  XrdCephPoolEntry * const m_pool;
+  const unsigned int m_nbStripes;
+  const unsigned long long m_stripeUnit;
+  const unsigned long long m_objectSize;
+  const size_t m_hash;
+  /// one slot per connection
+  XrdCephLayoutSlot *m_slots;
+};
+
+//------------------------------------------------------------------------------
+//! A session of a cluster connection : its cluster, together with the ioctxs
+//! and stripers built on top of it, from its connection until a recovery
+//! replaces it.
+//!
+//! Open files and calls in progress pin the session they got their handles
+//! from, so that a retired session is only shut down and freed when the last
+//! of them is done with it. The registry holds one reference on the current
+//! session of each connection.
+//------------------------------------------------------------------------------
+struct XrdCephSession {
+  explicit XrdCephSession(unsigned long long generation) :
+    m_generation(generation), m_refs(1), m_cluster(0) {}
+  /// unique over all sessions of all connections
+  const unsigned long long m_generation;
+  std::atomic<unsigned int> m_refs;
+  /// handles of the session, only filled when it gets retired
+  XrdCephCluster *m_cluster;
+  std::vector<XrdCephIoCtx*> m_ioctxs;
+  std::vector<XrdCephStriper*> m_stripers;
+};
+
+/// maximum number of cluster connections, over all classes and clusters
+#define CEPH_MAX_CONNECTIONS 256
+
+/// policies for the choice of the connection used by a new operation
+enum XrdCephConnectionPolicy {
+  /// each connection in turn, whatever its load
+  CEPH_CONN_ROUND_ROBIN,
+  /// the least loaded of all connections
+  CEPH_CONN_LEAST_OUTSTANDING,
+  /// the least loaded of two connections picked at random
+  CEPH_CONN_POWER_OF_TWO
+};
+
+/// classes of operations, each possibly having dedicated connections
+enum XrdCephConnectionClass {
+  /// files opened for read
+  CEPH_CLASS_READ = 0,
+  /// files opened for write
+  CEPH_CLASS_WRITE,
+  /// path based calls : stat, xattrs, truncate, unlink, listing, statfs
+  CEPH_CLASS_METADATA,
+  /// files opened for third party copies
+  CEPH_CLASS_BULK,
+  CEPH_NB_CONNECTION_CLASSES
+};
+
+/// connections of a class : count connections starting at first
+struct XrdCephConnectionRange {
+  unsigned int first;
+  unsigned int count;
+};
+
+/// error returned by ceph to a client that was blocklisted by the monitors
+#ifndef EBLOCKLISTED
+#define EBLOCKLISTED ESHUTDOWN
+#endif
+
+/// health of a cluster connection
+enum XrdCephConnectionHealth {
+  CEPH_CONN_HEALTHY = 0,
+  /// the session went bad, a new one is being established in the background
+  CEPH_CONN_RECOVERING
+};
+
+/// load and health of a cluster connection. In flight bytes count as
+/// additional operations, one per CEPH_CONN_BYTES_PER_OP, when comparing
+/// loads. Connections being recovered come after all healthy ones
+#define CEPH_CONN_BYTES_PER_OP (4*1024*1024)
+#define CEPH_CONN_RECOVERING_PENALTY (1ull << 40)
+struct alignas(64) XrdCephConnectionLoad {
+  XrdCephConnectionLoad() : inflightOps(0), inflightBytes(0), totalOps(0), totalBytes(0),
+                            nbRecoveries(0), health(CEPH_CONN_HEALTHY), nbErrors(0),
+                            generation(0) {}
+  bool healthy() const { return CEPH_CONN_HEALTHY == health.load(std::memory_order_relaxed); }
+  unsigned long long score() const {
+    return inflightOps.load(std::memory_order_relaxed) +
+      inflightBytes.load(std::memory_order_relaxed) / CEPH_CONN_BYTES_PER_OP +
+      (healthy() ? 0 : CEPH_CONN_RECOVERING_PENALTY);
+  }
+  std::atomic<unsigned long long> inflightOps;
+  std::atomic<unsigned long long> inflightBytes;
+  /// cumulated since the connection was created
+  std::atomic<unsigned long long> totalOps;
+  std::atomic<unsigned long long> totalBytes;
+  std::atomic<unsigned long long> nbRecoveries;
+  /// a XrdCephConnectionHealth
+  std::atomic<int> health;
+  /// consecutive operations failed with a session error
+  std::atomic<unsigned int> nbErrors;
+  /// generation of the current session
+  std::atomic<unsigned long long> generation;
+};
+
+/// snapshot of the load and health counters of a connection
+struct XrdCephConnectionStats {
+  unsigned long long inflightOps;
+  unsigned long long inflightBytes;
+  unsigned long long totalOps;
+  unsigned long long totalBytes;
+  unsigned long long nbRecoveries;
+  bool healthy;
+};
+
+/// counters of the registry
+struct XrdCephRegistryStats {
+  unsigned int nbConnections;
+  unsigned int nbPools;
+  unsigned int nbLayouts;
+  unsigned int nbIoCtxs;
+  /// stripers currently alive, over all connections
+  unsigned int nbStripers;
+  unsigned long long nbStripersCreated;
+  unsigned long long nbStripersEvicted;
+  /// evictions that found no unused striper, leaving the cache over its limit
+  unsigned long long nbEvictionsFailed;
+  unsigned long long nbLayoutsEvicted;
+  /// evictions that found no unused layout, leaving the registry over its limit
+  unsigned long long nbLayoutEvictionsFailed;
+  /// sessions replaced by a recovery but still pinned by open files
+  unsigned int nbRetiredSessions;
+};
+
+//------------------------------------------------------------------------------
+//! Registry of the cluster connections, pools and layouts in use.
+//!
+//! Layouts are interned in an open addressing hash table that is never
+//! modified once published : lookups only load the current table, without
+//! any lock. Insertions and removals copy the table under a mutex and
+//! publish the copy.
+//!
+//! Lookups run in read sections, counted in one of two counters depending
+//! on the current phase. Replaced tables and removed layouts are freed after
+//! a grace period : the phase is flipped twice, each time waiting for the
+//! readers of the previous phase to leave. Read sections being a few loads
+//! long, so are the waits.
+//!
+//! Stripers are evicted, least recently used first, when a connection holds
+//! more than the configured maximum. So are layouts whose stripers are all
+//! unused, together with their pool when it was their last layout, when the
+//! registry holds more than its maximum. Creations and evictions are
+//! serialized by the caller.
+//!
+//! Recoveries replace the session of a connection, see XrdCephSession. The
+//! session pinned by a caller is acquired in a read section, so that a
+//! retired session only loses the reference of the registry after a grace
+//! period.
+//------------------------------------------------------------------------------
+class XrdCephRegistry {
+public:
+  XrdCephRegistry();
+  ~XrdCephRegistry();
+
+  /// sizes the registry for the given number of connections, unless already done
+  /// The number is capped to CEPH_MAX_CONNECTIONS
+  void init(unsigned int nbConnections);
+  /// number of connections, 0 if not initialized
+  unsigned int nbConnections() const { return m_nbConnections.load(std::memory_order_acquire); }
+
+  static size_t hash(const std::string &userId, const std::string &pool, unsigned int nbStripes,
+                     unsigned long long stripeUnit, unsigned long long objectSize);
+  /// lock free lookup of a layout, pinning its slot for the given connection.
+  /// Returns the layout and fills striper, or 0 if the layout is not known or
+  /// has no striper on the connection, in which case nothing is pinned
+  XrdCephLayout* findAndAcquire(const std::string &userId, const std::string &pool,
+                                unsigned int nbStripes, unsigned long long stripeUnit,
+                                unsigned long long objectSize, unsigned int idx,
+                                XrdCephStriper *&striper) const;
+  /// looks up a layout and interns it if needed, together with its pool,
+  /// evicting the least recently used unused layouts if the registry holds
+  /// more than maxLayouts. 0 means no limit. The returned layout stays valid
+  /// until the next call, or for as long as one of its slots is pinned
+  XrdCephLayout* findOrInsert(const std::string &userId, const std::string &pool, unsigned int nbStripes,
+                              unsigned long long stripeUnit, unsigned long long objectSize,
+                              unsigned int maxLayouts = 0);
+
+  /// cluster connection of the given index, 0 if not connected
+  XrdCephCluster* cluster(unsigned int idx) const {
+    return m_clusters[idx].load(std::memory_order_acquire);
+  }
+  void setCluster(unsigned int idx, XrdCephCluster *cluster) {
+    m_clusters[idx].store(cluster, std::memory_order_release);
+  }
+  /// records a new ioctx of a pool
+  void setIoCtx(XrdCephPoolEntry *pool, unsigned int idx, XrdCephIoCtx *ioctx);
+  /// records a new striper of a layout, evicting the least recently used
+  /// unpinned stripers of the connection if it holds more than maxStripers.
+  /// 0 means no limit
+  void setStriper(XrdCephLayout *layout, unsigned int idx, XrdCephStriper *striper,
+                  unsigned int maxStripers);
+
+  void stats(XrdCephRegistryStats &stats) const;
+
+  /// picks the connection to be used by a new operation, among the count
+  /// connections starting at first (all of them if count is 0). Connections
+  /// of the given group, i.e. those with idx % nbGroups == group, are
+  /// preferred when the range has some (See XrdCephAffinity.hh)
+  unsigned int pickConnection(XrdCephConnectionPolicy policy,
+                              unsigned int first = 0, unsigned int count = 0,
+                              unsigned int group = 0, unsigned int nbGroups = 1);
+  /// accounting of the operations in flight on each connection
+  void opStarted(unsigned int idx, unsigned long long bytes) {
+    XrdCephConnectionLoad &load = m_loads[idx];
+    load.inflightOps.fetch_add(1, std::memory_order_relaxed);
+    load.totalOps.fetch_add(1, std::memory_order_relaxed);
+    if (bytes) {
+      load.inflightBytes.fetch_add(bytes, std::memory_order_relaxed);
+      load.totalBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+  }
+  void opDone(unsigned int idx, unsigned long long bytes) {
+    XrdCephConnectionLoad &load = m_loads[idx];
+    load.inflightOps.fetch_sub(1, std::memory_order_relaxed);
+    if (bytes) load.inflightBytes.fetch_sub(bytes, std::memory_order_relaxed);
+  }
+  const XrdCephConnectionLoad& load(unsigned int idx) const { return m_loads[idx]; }
+
+  /// pins the current session of a connection. Handles found afterwards
+  /// belong to it if it is still current once they are all loaded
+  XrdCephSession* acquireSession(unsigned int idx) const;
+  bool isCurrent(unsigned int idx, const XrdCephSession *session) const {
+    return m_sessions[idx].load() == session;
+  }
+  /// unpins a session, shutting it down and freeing its handles if it was
+  /// retired and this was its last user
+  void releaseSession(XrdCephSession *session);
+  /// generation of the current session of a connection
+  unsigned long long generation(unsigned int idx) const {
+    return m_loads[idx].generation.load(std::memory_order_acquire);
+  }
+
+  /// records the result of an operation made on the session of the given
+  /// generation of a connection. Blocklisting, or maxErrors consecutive
+  /// session errors (timeouts, lost connections), mark the connection as
+  /// recovering. Returns true for the call doing so, the caller being then
+  /// in charge of the recovery. Results of retired sessions are ignored
+  bool opResult(unsigned int idx, unsigned long long generation, int rc, unsigned int maxErrors);
+  /// marks a connection as healthy again, e.g. at the end of its recovery
+  void setHealthy(unsigned int idx);
+  /// retires the current session of a connection, detaching its cluster
+  /// with all its ioctxs and stripers so that they get recreated in a new
+  /// session. The detached objects are freed with the last pin on the
+  /// retired session. To be called under the same serialization as creations
+  void retireConnection(unsigned int idx);
+
+  /// deletes all handles, connections, layouts and pools. Not to be called
+  /// concurrently with any other use of the registry
+  void clear();
+
+private:
+  struct Table {
+    explicit Table(size_t size) : slots(size, (XrdCephLayout*)0), nbLayouts(0) {}
+    std::vector<XrdCephLayout*> slots;
+    unsigned int nbLayouts;
+  };
+  static XrdCephLayout* lookup(const Table *table, size_t hash, const std::string &userId,
+                               const std::string &pool, unsigned int nbStripes,
+                               unsigned long long stripeUnit, unsigned long long objectSize);
+  static void place(Table *table, XrdCephLayout *layout);
+  /// copy of the current table, without the given layout if any
+  Table* copyTable(size_t size, const XrdCephLayout *skipped) const;
+  /// publishes a new table and frees the previous one after a grace period
+  void publish(Table *table);
+  /// enters and leaves a read section, returning and taking its phase
+  unsigned int readLock() const;
+  void readUnlock(unsigned int phase) const {
+    m_readers[phase].count.fetch_sub(1, std::memory_order_release);
+  }
+  /// waits until all read sections started before the call are over
+  void synchronize();
+  /// evicts the least recently used unpinned striper of a connection
+  bool evictOne(unsigned int idx);
+  /// evicts the least recently used layout having no pinned slot
+  bool evictLayout();
+
+  std::atomic<Table*> m_table;
+  /// read sections, by phase. See synchronize
+  std::atomic<unsigned int> m_phase;
+  struct alignas(64) ReaderCount {
+    std::atomic<unsigned long long> count;
+  };
+  mutable ReaderCount m_readers[2];
+  std::atomic<unsigned int> m_nbConnections;
+  std::atomic<XrdCephCluster*> *m_clusters;
+  /// current session of each connection
+  std::atomic<XrdCephSession*> *m_sessions;
+  std::atomic<unsigned long long> m_nextGeneration;
+  /// protects insertions, initialization, the pools and the retired sessions
+  mutable XrdSysMutex m_mutex;
+  /// pools, by user@pool
+  std::map<std::string, XrdCephPoolEntry*> m_pools;
+  /// sessions replaced by new ones and still pinned, freed on clear otherwise
+  std::vector<XrdCephSession*> m_retiredSessions;
+  /// metrics
+  std::atomic<unsigned int> *m_nbStripers;
+  std::atomic<unsigned int> m_nbIoCtxs;
+  std::atomic<unsigned long long> m_nbStripersCreated;
+  std::atomic<unsigned long long> m_nbStripersEvicted;
+  std::atomic<unsigned long long> m_nbEvictionsFailed;
+  std::atomic<unsigned int> m_nbLayouts;
+  std::atomic<unsigned long long> m_nbLayoutsEvicted;
+  std::atomic<unsigned long long> m_nbLayoutEvictionsFailed;
+  /// next connection for the round robin policy
+  std::atomic<unsigned int> m_nextConnection;
+  XrdCephConnectionLoad m_loads[CEPH_MAX_CONNECTIONS];
+};
+
+#endif // _XRD_CEPH_REGISTRY_H
@@ -0,0 +1,177 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "XrdSys/XrdSysPthread.hh"
+#include "XrdCeph/XrdCephTrace.hh"
+
+std::atomic<bool> g_cephTraceEnabled(false);
+
+/// records are buffered in shards, picked by thread, and written by batches
+static const unsigned int g_traceNbShards = 16;
+static const size_t g_traceBatchSize = 4096;
+
+struct TraceShard {
+  XrdSysMutex mutex;
+  std::vector<XrdCephTraceRecord> records;
+};
+static TraceShard g_traceShards[g_traceNbShards];
+
+/// trace file, -1 when not tracing. Protected by g_traceFileMutex
+static int g_traceFd = -1;
+static XrdSysMutex g_traceFileMutex;
+/// monotonic time of the trace start, in ns
+static uint64_t g_traceStart = 0;
+
+static const char* g_traceOpNames[CEPH_TRACE_NB_OPS] = {
+  "unknown", "open", "close", "lseek", "read", "pread", "aio_read", "write",
+  "pwrite", "aio_write", "fstat", "stat", "fsync", "fcntl", "getxattr",
+  "fgetxattr", "setxattr", "fsetxattr", "removexattr", "fremovexattr",
+  "listxattrs", "flistxattrs", "statfs", "truncate", "ftruncate", "unlink",
+  "opendir", "readdir", "closedir", "readv", "writev"
+};
+
+static uint64_t monotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+const char* ceph_trace_op_name(unsigned int op) {
+  return op < CEPH_TRACE_NB_OPS ? g_traceOpNames[op] : g_traceOpNames[0];
+}
+
+uint64_t ceph_trace_path_hash(const char *path) {
+  // 64 bits FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  for (const unsigned char *p = (const unsigned char*)path; *p; p++) {
+    hash ^= *p;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+uint64_t ceph_trace_now() {
+  return monotonicNs() - g_traceStart;
+}
+
+/// writes a batch of records to the trace file
+static void writeRecords(const std::vector<XrdCephTraceRecord> &records) {
+  if (records.empty()) return;
+  XrdSysMutexHelper lock(g_traceFileMutex);
+  if (g_traceFd < 0) return;
+  const char *data = (const char*)&records[0];
+  size_t size = records.size() * sizeof(XrdCephTraceRecord);
+  while (size > 0) {
+    ssize_t n = write(g_traceFd, data, size);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      // give up on the trace rather than on the I/O
+      g_cephTraceEnabled = false;
+      return;
+    }
+    data += n;
+    size -= n;
+  }
+}
+
+/// shard of the calling thread, assigned round robin
+static unsigned int traceShard() {
+  static std::atomic<unsigned int> nextShard(0);
+  static thread_local unsigned int shard = nextShard++ % g_traceNbShards;
+  return shard;
+}
+
+void ceph_trace_record(const XrdCephTraceRecord &record) {
+  TraceShard &shard = g_traceShards[traceShard()];
+  std::vector<XrdCephTraceRecord> batch;
+  {
+    XrdSysMutexHelper lock(shard.mutex);
+    if (shard.records.capacity() < g_traceBatchSize) {
+      shard.records.reserve(g_traceBatchSize);
+    }
+    shard.records.push_back(record);
+    if (shard.records.size() < g_traceBatchSize) return;
+    batch.swap(shard.records);
+  }
+  writeRecords(batch);
+}
+
+/// writes the content of all shards
+static void flushShards() {
+  for (unsigned int i = 0; i < g_traceNbShards; i++) {
+    std::vector<XrdCephTraceRecord> batch;
+    {
+      XrdSysMutexHelper lock(g_traceShards[i].mutex);
+      batch.swap(g_traceShards[i].records);
+    }
+    writeRecords(batch);
+  }
+}
+
+int ceph_posix_trace_start(const char *path) {
+  static bool atexitRegistered = false;
+  XrdSysMutexHelper lock(g_traceFileMutex);
+  if (g_traceFd >= 0) return -EALREADY;
+  int fd = open(path, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+  if (fd < 0) return -errno;
+  XrdCephTraceHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, CEPH_TRACE_MAGIC, sizeof(header.magic));
+  header.version = CEPH_TRACE_VERSION;
+  header.recordSize = sizeof(XrdCephTraceRecord);
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  header.startTime = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+  if (write(fd, &header, sizeof(header)) != sizeof(header)) {
+    int rc = errno ? -errno : -EIO;
+    close(fd);
+    return rc;
+  }
+  g_traceFd = fd;
+  g_traceStart = monotonicNs();
+  g_cephTraceEnabled = true;
+  // make sure buffered records reach the file, xrootd never deletes its oss plugin
+  if (!atexitRegistered) {
+    atexit(ceph_posix_trace_stop);
+    atexitRegistered = true;
+  }
+  return 0;
+}
+
+void ceph_posix_trace_stop() {
+  g_cephTraceEnabled = false;
+  flushShards();
+  XrdSysMutexHelper lock(g_traceFileMutex);
+  if (g_traceFd >= 0) {
+    close(g_traceFd);
+    g_traceFd = -1;
+  }
+}
@@ -0,0 +1,175 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+/*
+ * Binary trace of the ceph_posix_* calls.
+ *
+ * A trace file is a XrdCephTraceHeader followed by XrdCephTraceRecords, in
+ * host byte order. Records are written in batches, so they are only roughly
+ * ordered by timestamp. Paths are not stored, only a hash of them, given at
+ * open time for the calls taking a file descriptor.
+ * Asynchronous calls are recorded at completion time, with the timestamp of
+ * their submission and a latency covering the whole operation.
+ */
+
+#ifndef _XRD_CEPH_TRACE_H
+#define _XRD_CEPH_TRACE_H
+
+#include <errno.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <atomic>
+
+/// traced calls
+enum XrdCephTraceOp {
+  CEPH_TRACE_OPEN = 1,
+  CEPH_TRACE_CLOSE,
+  CEPH_TRACE_LSEEK,
+  CEPH_TRACE_READ,
+  CEPH_TRACE_PREAD,
+  CEPH_TRACE_AIO_READ,
+  CEPH_TRACE_WRITE,
+  CEPH_TRACE_PWRITE,
+  CEPH_TRACE_AIO_WRITE,
+  CEPH_TRACE_FSTAT,
+  CEPH_TRACE_STAT,
+  CEPH_TRACE_FSYNC,
+  CEPH_TRACE_FCNTL,
+  CEPH_TRACE_GETXATTR,
+  CEPH_TRACE_FGETXATTR,
+  CEPH_TRACE_SETXATTR,
+  CEPH_TRACE_FSETXATTR,
+  CEPH_TRACE_REMOVEXATTR,
+  CEPH_TRACE_FREMOVEXATTR,
+  CEPH_TRACE_LISTXATTRS,
+  CEPH_TRACE_FLISTXATTRS,
+  CEPH_TRACE_STATFS,
+  CEPH_TRACE_TRUNCATE,
+  CEPH_TRACE_FTRUNCATE,
+  CEPH_TRACE_UNLINK,
+  CEPH_TRACE_OPENDIR,
+  CEPH_TRACE_READDIR,
+  CEPH_TRACE_CLOSEDIR,
+  CEPH_TRACE_READV,
+  CEPH_TRACE_WRITEV,
+  CEPH_TRACE_NB_OPS
+};
+
+#define CEPH_TRACE_MAGIC "XRDCTRC1"
+#define CEPH_TRACE_VERSION 1
+
+/// header of a trace file
+struct XrdCephTraceHeader {
+  char magic[8];            // CEPH_TRACE_MAGIC, not null terminated
+  uint32_t version;         // CEPH_TRACE_VERSION
+  uint32_t recordSize;      // sizeof(XrdCephTraceRecord)
+  uint64_t startTime;       // wall clock time of the trace start, in ns since epoch
+};
+
+/// one traced call
+struct XrdCephTraceRecord {
+  uint64_t timestamp;       // start of the call, in ns since the trace start
+  uint64_t pathHash;        // hash of the path for path based calls and open, 0 otherwise
+  uint64_t offset;          // offset of data calls, open flags for open
+  uint64_t length;          // length of data and xattr calls
+  uint64_t latency;         // duration of the call, in ns
+  int64_t result;           // return value of the call, -errno on failure
+  int32_t fd;               // file descriptor, or the one returned by open
+  uint16_t op;              // a XrdCephTraceOp
+  uint16_t reserved;
+};
+
+/// starts tracing into the given file, returns 0 or -errno
+int ceph_posix_trace_start(const char *path);
+/// stops tracing, flushing and closing the trace file
+void ceph_posix_trace_stop();
+
+/// name of a traced call, e.g. "pread"
+const char* ceph_trace_op_name(unsigned int op);
+/// hash of a path, as stored in the trace
+uint64_t ceph_trace_path_hash(const char *path);
+/// current time in ns since the start of the trace
+uint64_t ceph_trace_now();
+/// appends a record to the trace
+void ceph_trace_record(const XrdCephTraceRecord &record);
+
+/// whether tracing is on, the only cost paid by the calls when it is off
+extern std::atomic<bool> g_cephTraceEnabled;
+
+//------------------------------------------------------------------------------
+//! Traces the call in which it lives. The result of the call has to be
+//! passed through done() and is recorded when the scope is left
+//------------------------------------------------------------------------------
+class XrdCephTraceScope {
+public:
+  XrdCephTraceScope(XrdCephTraceOp op, int fd, const char *path = 0,
+                    uint64_t offset = 0, uint64_t length = 0) :
+    m_enabled(g_cephTraceEnabled.load(std::memory_order_relaxed)) {
+    if (m_enabled) {
+      m_record.timestamp = ceph_trace_now();
+      m_record.pathHash = path ? ceph_trace_path_hash(path) : 0;
+      m_record.offset = offset;
+      m_record.length = length;
+      m_record.result = 0;
+      m_record.fd = fd;
+      m_record.op = op;
+      m_record.reserved = 0;
+    }
+  }
+  ~XrdCephTraceScope() {
+    if (m_enabled) {
+      m_record.latency = ceph_trace_now() - m_record.timestamp;
+      ceph_trace_record(m_record);
+    }
+  }
+  template<typename T> T done(T rc) {
+    if (m_enabled) m_record.result = rc;
+    return rc;
+  }
+  DIR* done(DIR *dir) {
+    if (m_enabled) m_record.result = dir ? 0 : -errno;
+    return dir;
+  }
+  /// the fd of open is only known at the end of the call
+  int doneOpen(int fd) {
+    if (m_enabled) {
+      m_record.fd = fd;
+      m_record.result = fd < 0 ? fd : 0;
+    }
+    return fd;
+  }
+  /// hands the record over to an asynchronous completion, returns false
+  /// if tracing is off. The completion calls ceph_trace_record itself
+  bool defer(XrdCephTraceRecord &record) {
+    if (!m_enabled) return false;
+    record = m_record;
+    return true;
+  }
+  /// to be called once the deferred operation is submitted successfully
+  void deferred() { m_enabled = false; }
+private:
+  bool m_enabled;
+  XrdCephTraceRecord m_record;
+};
+
+#endif // _XRD_CEPH_TRACE_H
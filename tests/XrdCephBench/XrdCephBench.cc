@@ -0,0 +1,532 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+/*
+ * Microbenchmarks of the ceph_posix_* hot paths, run against the in-memory
+ * backend so that the cost of the POSIX layer itself can be measured.
+ *
+ * Usage : xrdceph-bench [-t maxThreads] [-n opsPerThread] [-b blockSize]
+ *                       [-c nbConnections] [-p layoutPrefix] [-f faults]
+ *                       [-s readSplitSize] [-w writeSplitSize] [-v nbSegments] [op...]
+ * where op is one of open, stat, pread, pwrite, aio_read, aio_write, readdir,
+ * pread_sfd, aio_rd_sfd, writev, writev_seq. pread_sfd and aio_rd_sfd share a
+ * single file descriptor between all threads, as xrootd does for clients
+ * reading the same file. writev writes nbSegments non overlapping segments,
+ * of one block in total and scattered over the file, in one vectored call.
+ * writev_seq writes the same segments with one pwrite each, as the default
+ * XrdOssDF::WriteV does.
+ * faults are fault injection settings as described in XrdCephFaultBackend.hh,
+ * e.g. -f "read.latency=lognormal:200:0.5 read.tail=pareto:5000:1.2@0.01".
+ * readSplitSize and writeSplitSize are the sizes above which reads and writes
+ * are split over the connections, as the ceph.readsplit and ceph.writesplit
+ * directives.
+ * Every op is run with 1, 2, 4, ... up to maxThreads threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "XrdCeph/XrdCephPosix.hh"
+#include "XrdCeph/XrdCephMemBackend.hh"
+#include "XrdCeph/XrdCephFaultBackend.hh"
+#include "XrdOuc/XrdOucIOVec.hh"
+#include "XrdSfs/XrdSfsAio.hh"
+#include "XrdSys/XrdSysPthread.hh"
+
+//------------------------------------------------------------------------------
+// Allocation counting : every C++ allocation of the process goes through here
+// Not inlined so that the compiler does not pair malloc/free with new/delete
+//------------------------------------------------------------------------------
+static std::atomic<unsigned long long> g_nbAllocs(0);
+
+__attribute__((noinline)) void* operator new(size_t size) {
+  g_nbAllocs.fetch_add(1, std::memory_order_relaxed);
+  void *p = malloc(size ? size : 1);
+  if (0 == p) throw std::bad_alloc();
+  return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+  free(p);
+}
+
+/// size of the Striper/IoCtx pool, declared in XrdCephPosix.cc
+extern unsigned int g_maxCephPoolIdx;
+/// sizes above which reads and writes are split, declared in XrdCephPosix.cc
+extern unsigned long long g_cephReadSplitSize;
+extern unsigned long long g_cephWriteSplitSize;
+
+//------------------------------------------------------------------------------
+// Benchmark configuration and helpers
+//------------------------------------------------------------------------------
+struct BenchConfig {
+  unsigned int maxThreads;
+  unsigned int nbOps;
+  size_t blockSize;
+  size_t fileSize;
+  unsigned int nbDirEntries;
+  unsigned int nbSegments;
+  std::string prefix;
+  std::string faults;
+};
+
+static BenchConfig g_config = { 8, 20000, 64*1024, 16*1024*1024, 100, 16, "bench@bench,1,4194304,4194304:", "" };
+
+static inline unsigned long long nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/// aio object waiting for its completion
+class BenchAio : public XrdSfsAio {
+public:
+  BenchAio() : m_sem(0) { memset(&sfsAio, 0, sizeof(sfsAio)); }
+  void doneRead() { m_sem.Post(); }
+  void doneWrite() { m_sem.Post(); }
+  void Recycle() {}
+  void wait() { m_sem.Wait(); }
+private:
+  XrdSysSemaphore m_sem;
+};
+
+static void benchAioReadCallback(XrdSfsAio *aiop, size_t rc) {
+  aiop->Result = rc;
+  aiop->doneRead();
+}
+
+static void benchAioWriteCallback(XrdSfsAio *aiop, size_t rc) {
+  aiop->Result = rc;
+  aiop->doneWrite();
+}
+
+/// per thread state
+struct ThreadContext {
+  unsigned int idx;
+  int fd;
+  DIR *dir;
+  std::string path;
+  std::vector<char> buffer;
+  BenchAio aio;
+  unsigned int seed;
+  std::vector<unsigned long long> latencies;
+  unsigned int nbErrors;
+};
+
+static std::string sharedFile() { return g_config.prefix + "/bench/shared"; }
+
+static std::string threadFile(unsigned int idx) {
+  char name[64];
+  snprintf(name, sizeof(name), "/bench/thread%u", idx);
+  return g_config.prefix + name;
+}
+
+static off64_t randomBlockOffset(ThreadContext &ctx) {
+  size_t nbBlocks = g_config.fileSize / g_config.blockSize;
+  return (off64_t)(rand_r(&ctx.seed) % nbBlocks) * g_config.blockSize;
+}
+
+static int createFile(const std::string &path, size_t size) {
+  int fd = ceph_posix_open(0, path.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
+  if (fd < 0) return fd;
+  std::vector<char> block(1024*1024, 'x');
+  for (size_t off = 0; off < size; off += block.size()) {
+    ssize_t rc = ceph_posix_pwrite(fd, &block[0], std::min(block.size(), size - off), off);
+    if (rc < 0) {
+      ceph_posix_close(fd);
+      return rc;
+    }
+  }
+  return ceph_posix_close(fd);
+}
+
+//------------------------------------------------------------------------------
+// The benchmarked operations
+//------------------------------------------------------------------------------
+struct BenchOp {
+  const char *name;
+  /// called once per thread before the measurement
+  int (*setup)(ThreadContext &ctx);
+  /// the measured operation
+  int (*run)(ThreadContext &ctx);
+  /// called once per thread after the measurement
+  void (*teardown)(ThreadContext &ctx);
+};
+
+static void teardownNothing(ThreadContext &ctx) {}
+
+static void teardownClose(ThreadContext &ctx) {
+  if (ctx.fd >= 0) ceph_posix_close(ctx.fd);
+  ctx.fd = -1;
+}
+
+static int runOpen(ThreadContext &ctx) {
+  int fd = ceph_posix_open(0, ctx.path.c_str(), O_RDONLY, 0);
+  if (fd < 0) return fd;
+  return ceph_posix_close(fd);
+}
+
+static int setupOpen(ThreadContext &ctx) {
+  ctx.path = sharedFile();
+  return 0;
+}
+
+static int runStat(ThreadContext &ctx) {
+  struct stat buf;
+  return ceph_posix_stat(0, ctx.path.c_str(), &buf);
+}
+
+static int setupRead(ThreadContext &ctx) {
+  ctx.buffer.resize(g_config.blockSize);
+  ctx.fd = ceph_posix_open(0, sharedFile().c_str(), O_RDONLY, 0);
+  return ctx.fd < 0 ? ctx.fd : 0;
+}
+
+/// file descriptor shared by all threads, opened by the first one set up
+/// and closed by the last one torn down
+static XrdSysMutex g_sharedFdMutex;
+static int g_sharedFd = -1;
+static unsigned int g_sharedFdUsers = 0;
+
+static int setupSharedRead(ThreadContext &ctx) {
+  ctx.buffer.resize(g_config.blockSize);
+  XrdSysMutexHelper lock(g_sharedFdMutex);
+  if (0 == g_sharedFdUsers) {
+    g_sharedFd = ceph_posix_open(0, sharedFile().c_str(), O_RDONLY, 0);
+    if (g_sharedFd < 0) return g_sharedFd;
+  }
+  g_sharedFdUsers++;
+  ctx.fd = g_sharedFd;
+  return 0;
+}
+
+static void teardownSharedClose(ThreadContext &ctx) {
+  if (ctx.fd < 0) return;
+  ctx.fd = -1;
+  XrdSysMutexHelper lock(g_sharedFdMutex);
+  if (0 == --g_sharedFdUsers) {
+    ceph_posix_close(g_sharedFd);
+    g_sharedFd = -1;
+  }
+}
+
+static int runPread(ThreadContext &ctx) {
+  ssize_t rc = ceph_posix_pread(ctx.fd, &ctx.buffer[0], ctx.buffer.size(), randomBlockOffset(ctx));
+  return rc < 0 ? rc : 0;
+}
+
+static int runAioRead(ThreadContext &ctx) {
+  ctx.aio.sfsAio.aio_buf = &ctx.buffer[0];
+  ctx.aio.sfsAio.aio_nbytes = ctx.buffer.size();
+  ctx.aio.sfsAio.aio_offset = randomBlockOffset(ctx);
+  ssize_t rc = ceph_aio_read(ctx.fd, &ctx.aio, benchAioReadCallback);
+  if (rc < 0) return rc;
+  ctx.aio.wait();
+  return ctx.aio.Result < 0 ? ctx.aio.Result : 0;
+}
+
+static int setupWrite(ThreadContext &ctx) {
+  ctx.buffer.resize(g_config.blockSize, 'y');
+  ctx.fd = ceph_posix_open(0, threadFile(ctx.idx).c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
+  return ctx.fd < 0 ? ctx.fd : 0;
+}
+
+static int runPwrite(ThreadContext &ctx) {
+  ssize_t rc = ceph_posix_pwrite(ctx.fd, &ctx.buffer[0], ctx.buffer.size(), randomBlockOffset(ctx));
+  return rc < 0 ? rc : 0;
+}
+
+static int runAioWrite(ThreadContext &ctx) {
+  ctx.aio.sfsAio.aio_buf = &ctx.buffer[0];
+  ctx.aio.sfsAio.aio_nbytes = ctx.buffer.size();
+  ctx.aio.sfsAio.aio_offset = randomBlockOffset(ctx);
+  ssize_t rc = ceph_aio_write(ctx.fd, &ctx.aio, benchAioWriteCallback);
+  if (rc < 0) return rc;
+  ctx.aio.wait();
+  return ctx.aio.Result < 0 ? ctx.aio.Result : 0;
+}
+
+/// segments of a vectored write, the i-th one in the i-th slot of a random
+/// block, so that they never overlap
+static void randomSegments(ThreadContext &ctx, std::vector<XrdOucIOVec> &segs) {
+  size_t segSize = g_config.blockSize / g_config.nbSegments;
+  segs.resize(g_config.nbSegments);
+  for (unsigned int i = 0; i < g_config.nbSegments; i++) {
+    segs[i].offset = randomBlockOffset(ctx) + i * segSize;
+    segs[i].size = segSize;
+    segs[i].info = 0;
+    segs[i].data = &ctx.buffer[i * segSize];
+  }
+}
+
+static int runWriteV(ThreadContext &ctx) {
+  std::vector<XrdOucIOVec> segs;
+  randomSegments(ctx, segs);
+  ssize_t rc = ceph_posix_fh_writev(ceph_posix_get_handle(ctx.fd), &segs[0], segs.size());
+  return rc < 0 ? rc : 0;
+}
+
+static int runWriteVSeq(ThreadContext &ctx) {
+  std::vector<XrdOucIOVec> segs;
+  randomSegments(ctx, segs);
+  for (unsigned int i = 0; i < segs.size(); i++) {
+    ssize_t rc = ceph_posix_pwrite(ctx.fd, segs[i].data, segs[i].size, segs[i].offset);
+    if (rc < 0) return rc;
+  }
+  return 0;
+}
+
+static int setupReaddir(ThreadContext &ctx) {
+  ctx.buffer.resize(1024);
+  ctx.dir = 0;
+  return 0;
+}
+
+static int runReaddir(ThreadContext &ctx) {
+  if (0 == ctx.dir) {
+    ctx.dir = ceph_posix_opendir(0, (g_config.prefix + "/").c_str());
+    if (0 == ctx.dir) return -errno;
+  }
+  int rc = ceph_posix_readdir(ctx.dir, &ctx.buffer[0], ctx.buffer.size());
+  if (rc || 0 == ctx.buffer[0]) {
+    ceph_posix_closedir(ctx.dir);
+    ctx.dir = 0;
+  }
+  return rc;
+}
+
+static void teardownReaddir(ThreadContext &ctx) {
+  if (ctx.dir) ceph_posix_closedir(ctx.dir);
+  ctx.dir = 0;
+}
+
+static BenchOp g_ops[] = {
+  { "open",      setupOpen,    runOpen,     teardownNothing },
+  { "stat",      setupOpen,    runStat,     teardownNothing },
+  { "pread",     setupRead,    runPread,    teardownClose },
+  { "aio_read",  setupRead,    runAioRead,  teardownClose },
+  { "pwrite",    setupWrite,   runPwrite,   teardownClose },
+  { "aio_write", setupWrite,   runAioWrite, teardownClose },
+  { "readdir",   setupReaddir, runReaddir,  teardownReaddir },
+  { "pread_sfd", setupSharedRead, runPread,   teardownSharedClose },
+  { "aio_rd_sfd", setupSharedRead, runAioRead, teardownSharedClose },
+  { "writev",     setupWrite,   runWriteV,    teardownClose },
+  { "writev_seq", setupWrite,   runWriteVSeq, teardownClose },
+};
+
+//------------------------------------------------------------------------------
+// Threading : all threads run setup, wait for the start signal, run the
+// measured loop, report and wait for the end signal before tearing down
+//------------------------------------------------------------------------------
+struct RunState {
+  RunState() : cond(0), ready(0), finished(0), started(false), stopped(false), op(0) {}
+  XrdSysCondVar cond;
+  unsigned int ready;
+  unsigned int finished;
+  bool started;
+  bool stopped;
+  BenchOp *op;
+  std::vector<ThreadContext*> contexts;
+};
+
+static void* benchThread(void *arg) {
+  std::pair<RunState*, ThreadContext*> *p = (std::pair<RunState*, ThreadContext*>*)arg;
+  RunState &state = *p->first;
+  ThreadContext &ctx = *p->second;
+  int rc = state.op->setup(ctx);
+  if (rc) {
+    fprintf(stderr, "%s : setup failed for thread %u, rc = %d\n", state.op->name, ctx.idx, rc);
+    ctx.nbErrors++;
+  }
+  state.cond.Lock();
+  state.ready++;
+  state.cond.Broadcast();
+  while (!state.started) state.cond.Wait();
+  state.cond.UnLock();
+  if (0 == rc) {
+    for (unsigned int i = 0; i < g_config.nbOps; i++) {
+      unsigned long long start = nowNs();
+      if (state.op->run(ctx)) ctx.nbErrors++;
+      ctx.latencies.push_back(nowNs() - start);
+    }
+  }
+  state.cond.Lock();
+  state.finished++;
+  state.cond.Broadcast();
+  while (!state.stopped) state.cond.Wait();
+  state.cond.UnLock();
+  state.op->teardown(ctx);
+  return 0;
+}
+
+static double percentile(const std::vector<unsigned long long> &sorted, double p) {
+  if (sorted.empty()) return 0;
+  size_t idx = (size_t)(p * (sorted.size() - 1));
+  return sorted[idx] / 1000.0;
+}
+
+static void runBench(BenchOp &op, unsigned int nbThreads) {
+  RunState state;
+  state.op = &op;
+  std::vector<pthread_t> tids(nbThreads);
+  std::vector<std::pair<RunState*, ThreadContext*> > args(nbThreads);
+  for (unsigned int i = 0; i < nbThreads; i++) {
+    ThreadContext *ctx = new ThreadContext;
+    ctx->idx = i;
+    ctx->fd = -1;
+    ctx->dir = 0;
+    ctx->seed = i + 1;
+    ctx->nbErrors = 0;
+    ctx->latencies.reserve(g_config.nbOps);
+    state.contexts.push_back(ctx);
+    args[i] = std::make_pair(&state, ctx);
+    XrdSysThread::Run(&tids[i], benchThread, &args[i], XRDSYSTHREAD_HOLD, "xrdceph-bench");
+  }
+  // start all threads together
+  state.cond.Lock();
+  while (state.ready < nbThreads) state.cond.Wait();
+  unsigned long long allocsBefore = g_nbAllocs.load();
+  unsigned long long start = nowNs();
+  state.started = true;
+  state.cond.Broadcast();
+  while (state.finished < nbThreads) state.cond.Wait();
+  unsigned long long elapsed = nowNs() - start;
+  unsigned long long allocs = g_nbAllocs.load() - allocsBefore;
+  state.stopped = true;
+  state.cond.Broadcast();
+  state.cond.UnLock();
+  for (unsigned int i = 0; i < nbThreads; i++) {
+    XrdSysThread::Join(tids[i], 0);
+  }
+  // merge results
+  std::vector<unsigned long long> latencies;
+  unsigned int nbErrors = 0;
+  for (unsigned int i = 0; i < nbThreads; i++) {
+    latencies.insert(latencies.end(), state.contexts[i]->latencies.begin(), state.contexts[i]->latencies.end());
+    nbErrors += state.contexts[i]->nbErrors;
+    delete state.contexts[i];
+  }
+  std::sort(latencies.begin(), latencies.end());
+  double nbOps = latencies.size();
+  printf("%-10s %7u %12.0f %10.2f %10.2f %10.2f %10.2f %8u\n",
+         op.name, nbThreads, nbOps ? nbOps * 1e9 / elapsed : 0.0,
+         percentile(latencies, 0.5), percentile(latencies, 0.99), percentile(latencies, 0.999),
+         nbOps ? allocs / nbOps : 0.0, nbErrors);
+  fflush(stdout);
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr, "Usage : %s [-t maxThreads] [-n opsPerThread] [-b blockSize] "
+          "[-c nbConnections] [-p layoutPrefix] [-f faults] [-s readSplitSize] [-w writeSplitSize] "
+          "[-v nbSegments] [op...]\n", prog);
+  fprintf(stderr, "ops :");
+  for (unsigned int i = 0; i < sizeof(g_ops)/sizeof(BenchOp); i++) fprintf(stderr, " %s", g_ops[i].name);
+  fprintf(stderr, "\n");
+}
+
+int main(int argc, char **argv) {
+  int c;
+  while ((c = getopt(argc, argv, "t:n:b:c:p:f:s:w:v:h")) != -1) {
+    switch (c) {
+    case 't': g_config.maxThreads = atoi(optarg); break;
+    case 'n': g_config.nbOps = atoi(optarg); break;
+    case 'b': g_config.blockSize = strtoull(optarg, 0, 10); break;
+    case 'c': g_maxCephPoolIdx = atoi(optarg); break;
+    case 'p': g_config.prefix = optarg; break;
+    case 'f': g_config.faults = optarg; break;
+    case 's': g_cephReadSplitSize = strtoull(optarg, 0, 10); break;
+    case 'w': g_cephWriteSplitSize = strtoull(optarg, 0, 10); break;
+    case 'v': g_config.nbSegments = atoi(optarg); break;
+    default: usage(argv[0]); return 1;
+    }
+  }
+  if (0 == g_config.maxThreads || 0 == g_config.nbOps || 0 == g_config.blockSize ||
+      g_config.blockSize > g_config.fileSize || 0 == g_maxCephPoolIdx ||
+      0 == g_config.nbSegments || g_config.nbSegments > g_config.blockSize) {
+    usage(argv[0]);
+    return 1;
+  }
+  std::vector<BenchOp*> ops;
+  for (int i = optind; i < argc; i++) {
+    BenchOp *op = 0;
+    for (unsigned int j = 0; j < sizeof(g_ops)/sizeof(BenchOp); j++) {
+      if (!strcmp(argv[i], g_ops[j].name)) op = &g_ops[j];
+    }
+    if (0 == op) {
+      usage(argv[0]);
+      return 1;
+    }
+    ops.push_back(op);
+  }
+  if (ops.empty()) {
+    for (unsigned int j = 0; j < sizeof(g_ops)/sizeof(BenchOp); j++) ops.push_back(&g_ops[j]);
+  }
+
+  XrdCephMemBackend backend;
+  XrdCephFaultBackend *faultBackend = 0;
+  if (g_config.faults.empty()) {
+    ceph_posix_set_backend(&backend);
+  } else {
+    XrdCephFaultConfig faultConfig;
+    std::string error;
+    if (!faultConfig.parse(g_config.faults, error)) {
+      fprintf(stderr, "Invalid fault settings : %s\n", error.c_str());
+      return 1;
+    }
+    faultBackend = new XrdCephFaultBackend(&backend, faultConfig);
+    ceph_posix_set_backend(faultBackend);
+  }
+  // populate : one shared file for reads and a flat directory for listings
+  int rc = createFile(sharedFile(), g_config.fileSize);
+  for (unsigned int i = 0; 0 == rc && i < g_config.nbDirEntries; i++) {
+    char name[64];
+    snprintf(name, sizeof(name), "/bench/entry%u", i);
+    rc = createFile(g_config.prefix + name, 1);
+  }
+  if (rc) {
+    fprintf(stderr, "Unable to populate the memory backend, rc = %d\n", rc);
+    return 1;
+  }
+
+  printf("%-10s %7s %12s %10s %10s %10s %10s %8s\n",
+         "op", "threads", "ops/s", "p50(us)", "p99(us)", "p999(us)", "allocs/op", "errors");
+  for (std::vector<BenchOp*>::const_iterator it = ops.begin(); it != ops.end(); it++) {
+    for (unsigned int n = 1; n <= g_config.maxThreads; n *= 2) {
+      runBench(**it, n);
+      if (n < g_config.maxThreads && n * 2 > g_config.maxThreads) runBench(**it, g_config.maxThreads);
+    }
+  }
+  ceph_posix_disconnect_all();
+  delete faultBackend;
+  return 0;
+}
@@ -0,0 +1,556 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+/*
+ * Replays a trace of ceph_posix_* calls, as recorded with the ceph.trace
+ * directive (See XrdCephTrace.hh), against the in-memory or rados backend.
+ *
+ * Usage : xrdceph-replay [-s speed] [-w nbWorkers] [-c nbConnections]
+ *                        [-b memory|rados] [-p layoutPrefix] [-f faults]
+ *                        [-l] traceFile
+ *   -s : 1 replays at the original pace, 10 ten times faster and 0 as fast
+ *        as possible. Default is 1
+ *   -w : number of replaying threads. Calls on a given path always go to the
+ *        same thread so that their order is kept. Default is 16
+ *   -l : only lists the content of the trace
+ *
+ * Paths are not part of traces, so every traced file is replayed as
+ * <layoutPrefix>/replay/<path hash>. Files that are read without being
+ * written first in the trace are created beforehand, big enough for the
+ * traced reads. Extended attribute names are not traced either, a fixed one
+ * is used. readdir calls are not replayed as the listing they belong to is
+ * not known. At the end, the latencies of the replay are compared per call
+ * with the traced ones.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "XrdCeph/XrdCephPosix.hh"
+#include "XrdCeph/XrdCephTrace.hh"
+#include "XrdCeph/XrdCephBackend.hh"
+#include "XrdCeph/XrdCephMemBackend.hh"
+#include "XrdCeph/XrdCephFaultBackend.hh"
+#include "XrdSfs/XrdSfsAio.hh"
+#include "XrdSys/XrdSysPthread.hh"
+
+/// size of the Striper/IoCtx pool, declared in XrdCephPosix.cc
+extern unsigned int g_maxCephPoolIdx;
+
+/// largest data call replayed, longer ones are truncated
+static const uint64_t g_maxLength = 64*1024*1024;
+
+//------------------------------------------------------------------------------
+// Configuration and helpers
+//------------------------------------------------------------------------------
+struct ReplayConfig {
+  double speed;
+  unsigned int nbWorkers;
+  std::string backend;
+  std::string prefix;
+  std::string faults;
+  bool listOnly;
+};
+
+static ReplayConfig g_config = { 1.0, 16, "memory", "replay@replay,1,4194304,4194304:", "", false };
+
+static inline unsigned long long nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void sleepUntil(unsigned long long target) {
+  unsigned long long now = nowNs();
+  if (target <= now) return;
+  struct timespec ts;
+  ts.tv_sec = (target - now) / 1000000000ULL;
+  ts.tv_nsec = (target - now) % 1000000000ULL;
+  while (nanosleep(&ts, &ts) && EINTR == errno);
+}
+
+static std::string replayPath(uint64_t pathHash) {
+  char name[64];
+  snprintf(name, sizeof(name), "/replay/%016llx", (unsigned long long)pathHash);
+  return g_config.prefix + name;
+}
+
+static bool isDataOp(unsigned int op) {
+  return op == CEPH_TRACE_READ || op == CEPH_TRACE_PREAD || op == CEPH_TRACE_AIO_READ ||
+    op == CEPH_TRACE_WRITE || op == CEPH_TRACE_PWRITE || op == CEPH_TRACE_AIO_WRITE;
+}
+
+/// whether the call identifies its file by path rather than by file descriptor
+static bool isPathOp(unsigned int op) {
+  return op == CEPH_TRACE_OPEN || op == CEPH_TRACE_STAT || op == CEPH_TRACE_GETXATTR ||
+    op == CEPH_TRACE_SETXATTR || op == CEPH_TRACE_REMOVEXATTR || op == CEPH_TRACE_LISTXATTRS ||
+    op == CEPH_TRACE_TRUNCATE || op == CEPH_TRACE_UNLINK;
+}
+
+static int loadTrace(const char *path, std::vector<XrdCephTraceRecord> &records) {
+  FILE *f = fopen(path, "rb");
+  if (0 == f) {
+    fprintf(stderr, "Unable to open %s : %s\n", path, strerror(errno));
+    return -1;
+  }
+  XrdCephTraceHeader header;
+  if (fread(&header, sizeof(header), 1, f) != 1 ||
+      memcmp(header.magic, CEPH_TRACE_MAGIC, sizeof(header.magic)) ||
+      header.version != CEPH_TRACE_VERSION ||
+      header.recordSize != sizeof(XrdCephTraceRecord)) {
+    fprintf(stderr, "%s is not a trace file or has an unsupported version\n", path);
+    fclose(f);
+    return -1;
+  }
+  XrdCephTraceRecord record;
+  while (fread(&record, sizeof(record), 1, f) == 1) {
+    records.push_back(record);
+  }
+  fclose(f);
+  // records are written by batches, restore the call order
+  std::stable_sort(records.begin(), records.end(),
+                   [](const XrdCephTraceRecord &a, const XrdCephTraceRecord &b) {
+                     return a.timestamp < b.timestamp;
+                   });
+  return 0;
+}
+
+static void listTrace(const std::vector<XrdCephTraceRecord> &records) {
+  printf("%16s %-12s %6s %16s %14s %12s %12s %12s\n",
+         "timestamp(ns)", "op", "fd", "path hash", "offset", "length", "latency(ns)", "result");
+  for (std::vector<XrdCephTraceRecord>::const_iterator it = records.begin(); it != records.end(); it++) {
+    printf("%16llu %-12s %6d %016llx %14llu %12llu %12llu %12lld\n",
+           (unsigned long long)it->timestamp, ceph_trace_op_name(it->op), it->fd,
+           (unsigned long long)it->pathHash, (unsigned long long)it->offset,
+           (unsigned long long)it->length, (unsigned long long)it->latency,
+           (long long)it->result);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Statistics, per call type
+//------------------------------------------------------------------------------
+struct OpStats {
+  OpStats() : nbErrors(0), nbTracedErrors(0) {}
+  std::vector<unsigned long long> traced;
+  std::vector<unsigned long long> replayed;
+  unsigned int nbErrors;
+  unsigned int nbTracedErrors;
+};
+
+static XrdSysMutex g_statsMutex;
+static OpStats g_stats[CEPH_TRACE_NB_OPS];
+static unsigned long long g_nbSkipped = 0;
+
+static void recordStats(const XrdCephTraceRecord &record, unsigned long long latency, long long rc) {
+  XrdSysMutexHelper lock(g_statsMutex);
+  OpStats &stats = g_stats[record.op];
+  stats.traced.push_back(record.latency);
+  stats.replayed.push_back(latency);
+  if (rc < 0) stats.nbErrors++;
+  if (record.result < 0) stats.nbTracedErrors++;
+}
+
+static double percentile(std::vector<unsigned long long> &values, double p) {
+  if (values.empty()) return 0;
+  std::sort(values.begin(), values.end());
+  return values[(size_t)(p * (values.size() - 1))] / 1000.0;
+}
+
+//------------------------------------------------------------------------------
+// Replay of the calls
+//------------------------------------------------------------------------------
+
+/// a replayed file
+struct ReplayFile {
+  ReplayFile() : fd(-1), pending(0), pendingCond(0) {}
+  int fd;
+  /// aio in flight on this file
+  unsigned int pending;
+  XrdSysCondVar pendingCond;
+};
+
+class ReplayAio : public XrdSfsAio {
+public:
+  ReplayAio(const XrdCephTraceRecord &record, ReplayFile *file, size_t len) :
+    m_record(record), m_file(file), m_buffer(len), m_start(nowNs()) {
+    memset(&sfsAio, 0, sizeof(sfsAio));
+    sfsAio.aio_buf = &m_buffer[0];
+    sfsAio.aio_nbytes = len;
+    sfsAio.aio_offset = record.offset;
+  }
+  void doneRead() { done(); }
+  void doneWrite() { done(); }
+  void Recycle() {}
+private:
+  void done() {
+    recordStats(m_record, nowNs() - m_start, Result);
+    ReplayFile *file = m_file;
+    delete this;
+    XrdSysCondVarHelper lock(file->pendingCond);
+    file->pending--;
+    file->pendingCond.Signal();
+  }
+  XrdCephTraceRecord m_record;
+  ReplayFile *m_file;
+  std::vector<char> m_buffer;
+  unsigned long long m_start;
+};
+
+static void replayAioCallback(XrdSfsAio *aiop, size_t rc) {
+  aiop->Result = rc;
+  aiop->doneRead();
+}
+
+/// a replaying thread and its queue of calls
+struct ReplayWorker {
+  ReplayWorker() : cond(0), stopping(false) {}
+  XrdSysCondVar cond;
+  std::deque<XrdCephTraceRecord> queue;
+  bool stopping;
+  /// files opened in the trace, by traced file descriptor
+  std::map<int, ReplayFile*> files;
+  std::vector<char> buffer;
+};
+
+static void waitPending(ReplayFile *file) {
+  XrdSysCondVarHelper lock(file->pendingCond);
+  while (file->pending > 0) file->pendingCond.Wait();
+}
+
+static void closeFile(ReplayFile *file) {
+  waitPending(file);
+  ceph_posix_close(file->fd);
+  delete file;
+}
+
+static void replay(ReplayWorker &worker, const XrdCephTraceRecord &record) {
+  ReplayFile *file = 0;
+  if (!isPathOp(record.op) && record.fd >= 0) {
+    std::map<int, ReplayFile*>::iterator it = worker.files.find(record.fd);
+    if (it == worker.files.end()) {
+      // the open was not traced or failed, nothing to replay on
+      XrdSysMutexHelper lock(g_statsMutex);
+      g_nbSkipped++;
+      return;
+    }
+    file = it->second;
+  }
+  size_t len = std::min(record.length, g_maxLength);
+  if (isDataOp(record.op) && worker.buffer.size() < len) worker.buffer.resize(len);
+  char *buf = worker.buffer.empty() ? 0 : &worker.buffer[0];
+  std::string path = replayPath(record.pathHash);
+  char xattr[256];
+  long long rc = 0;
+  unsigned long long start = nowNs();
+  switch (record.op) {
+  case CEPH_TRACE_OPEN: {
+    int flags = record.offset;
+    // files are created by the replay with their own names, there is no
+    // point failing as the original may have because of existing files
+    if ((flags & O_ACCMODE) != O_RDONLY) flags |= O_CREAT|O_TRUNC;
+    rc = ceph_posix_open(0, path.c_str(), flags, 0644);
+    if (rc >= 0) {
+      ReplayFile *f = new ReplayFile;
+      f->fd = rc;
+      std::map<int, ReplayFile*>::iterator it = worker.files.find(record.fd);
+      if (it != worker.files.end()) {
+        closeFile(it->second);
+        worker.files.erase(it);
+      }
+      worker.files[record.fd] = f;
+    }
+    break;
+  }
+  case CEPH_TRACE_CLOSE:
+    waitPending(file);
+    start = nowNs();
+    rc = ceph_posix_close(file->fd);
+    delete file;
+    worker.files.erase(record.fd);
+    break;
+  case CEPH_TRACE_LSEEK: rc = ceph_posix_lseek64(file->fd, record.offset, SEEK_SET); break;
+  case CEPH_TRACE_READ: rc = ceph_posix_read(file->fd, buf, len); break;
+  case CEPH_TRACE_PREAD: rc = ceph_posix_pread(file->fd, buf, len, record.offset); break;
+  case CEPH_TRACE_WRITE: rc = ceph_posix_write(file->fd, buf, len); break;
+  case CEPH_TRACE_PWRITE: rc = ceph_posix_pwrite(file->fd, buf, len, record.offset); break;
+  case CEPH_TRACE_AIO_READ:
+  case CEPH_TRACE_AIO_WRITE: {
+    ReplayAio *aio = new ReplayAio(record, file, len);
+    {
+      XrdSysCondVarHelper lock(file->pendingCond);
+      file->pending++;
+    }
+    if (record.op == CEPH_TRACE_AIO_READ) {
+      rc = ceph_aio_read(file->fd, aio, replayAioCallback);
+    } else {
+      rc = ceph_aio_write(file->fd, aio, replayAioCallback);
+    }
+    if (rc < 0) {
+      delete aio;
+      XrdSysCondVarHelper lock(file->pendingCond);
+      file->pending--;
+      break;
+    }
+    // statistics are recorded at completion
+    return;
+  }
+  case CEPH_TRACE_FSTAT: {
+    struct stat st;
+    rc = ceph_posix_fstat(file->fd, &st);
+    break;
+  }
+  case CEPH_TRACE_STAT: {
+    struct stat st;
+    rc = ceph_posix_stat(0, path.c_str(), &st);
+    break;
+  }
+  case CEPH_TRACE_FSYNC: rc = ceph_posix_fsync(file->fd); break;
+  case CEPH_TRACE_FCNTL: rc = ceph_posix_fcntl(file->fd, F_GETFL); break;
+  case CEPH_TRACE_GETXATTR:
+    rc = ceph_posix_getxattr(0, path.c_str(), "replay", xattr, std::min(len, sizeof(xattr)));
+    break;
+  case CEPH_TRACE_FGETXATTR:
+    rc = ceph_posix_fgetxattr(file->fd, "replay", xattr, std::min(len, sizeof(xattr)));
+    break;
+  case CEPH_TRACE_SETXATTR:
+    memset(xattr, 'x', sizeof(xattr));
+    rc = ceph_posix_setxattr(0, path.c_str(), "replay", xattr, std::min(len, sizeof(xattr)), 0);
+    break;
+  case CEPH_TRACE_FSETXATTR:
+    memset(xattr, 'x', sizeof(xattr));
+    rc = ceph_posix_fsetxattr(file->fd, "replay", xattr, std::min(len, sizeof(xattr)), 0);
+    break;
+  case CEPH_TRACE_REMOVEXATTR: rc = ceph_posix_removexattr(0, path.c_str(), "replay"); break;
+  case CEPH_TRACE_FREMOVEXATTR: rc = ceph_posix_fremovexattr(file->fd, "replay"); break;
+  case CEPH_TRACE_LISTXATTRS:
+  case CEPH_TRACE_FLISTXATTRS: {
+    XrdSysXAttr::AList *list = 0;
+    rc = record.op == CEPH_TRACE_LISTXATTRS ?
+      ceph_posix_listxattrs(0, path.c_str(), &list, 1) :
+      ceph_posix_flistxattrs(file->fd, &list, 1);
+    // the list is freed by hand as ceph_posix_freexattrlist frees the inlined names
+    while (list) {
+      XrdSysXAttr::AList *next = list->Next;
+      free(list);
+      list = next;
+    }
+    break;
+  }
+  case CEPH_TRACE_STATFS: {
+    long long total, free;
+    rc = ceph_posix_statfs(&total, &free);
+    break;
+  }
+  case CEPH_TRACE_TRUNCATE: rc = ceph_posix_truncate(0, path.c_str(), record.length); break;
+  case CEPH_TRACE_FTRUNCATE: rc = ceph_posix_ftruncate(file->fd, record.length); break;
+  case CEPH_TRACE_UNLINK: rc = ceph_posix_unlink(0, path.c_str()); break;
+  case CEPH_TRACE_OPENDIR: {
+    DIR *dir = ceph_posix_opendir(0, (g_config.prefix + "/").c_str());
+    rc = dir ? 0 : -errno;
+    if (dir) ceph_posix_closedir(dir);
+    break;
+  }
+  default: {
+    XrdSysMutexHelper lock(g_statsMutex);
+    g_nbSkipped++;
+    return;
+  }
+  }
+  recordStats(record, nowNs() - start, rc);
+}
+
+static void* workerThread(void *arg) {
+  ReplayWorker &worker = *(ReplayWorker*)arg;
+  worker.cond.Lock();
+  while (true) {
+    while (worker.queue.empty() && !worker.stopping) worker.cond.Wait();
+    if (worker.queue.empty()) break;
+    XrdCephTraceRecord record = worker.queue.front();
+    worker.queue.pop_front();
+    worker.cond.UnLock();
+    replay(worker, record);
+    worker.cond.Lock();
+  }
+  worker.cond.UnLock();
+  // close what the trace left open
+  for (std::map<int, ReplayFile*>::iterator it = worker.files.begin(); it != worker.files.end(); it++) {
+    closeFile(it->second);
+  }
+  worker.files.clear();
+  return 0;
+}
+
+/// creates the files that are read before being written in the trace
+static int prepareFiles(const std::vector<XrdCephTraceRecord> &records) {
+  std::map<int, uint64_t> fdToHash;
+  std::set<uint64_t> written;
+  std::map<uint64_t, uint64_t> needed;
+  for (std::vector<XrdCephTraceRecord>::const_iterator it = records.begin(); it != records.end(); it++) {
+    if (it->op == CEPH_TRACE_OPEN) {
+      if (it->result < 0) continue;
+      fdToHash[it->fd] = it->pathHash;
+      if ((it->offset & O_ACCMODE) != O_RDONLY) {
+        written.insert(it->pathHash);
+      } else if (!written.count(it->pathHash)) {
+        needed[it->pathHash];
+      }
+    } else if (isPathOp(it->op) && it->op != CEPH_TRACE_UNLINK) {
+      if (!written.count(it->pathHash)) needed[it->pathHash];
+    } else if (it->op == CEPH_TRACE_READ || it->op == CEPH_TRACE_PREAD || it->op == CEPH_TRACE_AIO_READ) {
+      std::map<int, uint64_t>::const_iterator h = fdToHash.find(it->fd);
+      if (h == fdToHash.end() || written.count(h->second)) continue;
+      uint64_t &size = needed[h->second];
+      size = std::max(size, it->offset + std::min(it->length, g_maxLength));
+    }
+  }
+  std::vector<char> block(1024*1024, 'r');
+  for (std::map<uint64_t, uint64_t>::const_iterator it = needed.begin(); it != needed.end(); it++) {
+    int fd = ceph_posix_open(0, replayPath(it->first).c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if (fd < 0) return fd;
+    for (uint64_t off = 0; off < it->second; off += block.size()) {
+      ssize_t rc = ceph_posix_pwrite(fd, &block[0], std::min((uint64_t)block.size(), it->second - off), off);
+      if (rc < 0) {
+        ceph_posix_close(fd);
+        return rc;
+      }
+    }
+    int rc = ceph_posix_close(fd);
+    if (rc) return rc;
+  }
+  printf("Created %lu files for the replay\n", (unsigned long)needed.size());
+  return 0;
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr, "Usage : %s [-s speed] [-w nbWorkers] [-c nbConnections] [-b memory|rados] "
+          "[-p layoutPrefix] [-f faults] [-l] traceFile\n", prog);
+}
+
+int main(int argc, char **argv) {
+  int c;
+  while ((c = getopt(argc, argv, "s:w:c:b:p:f:lh")) != -1) {
+    switch (c) {
+    case 's': g_config.speed = atof(optarg); break;
+    case 'w': g_config.nbWorkers = atoi(optarg); break;
+    case 'c': g_maxCephPoolIdx = atoi(optarg); break;
+    case 'b': g_config.backend = optarg; break;
+    case 'p': g_config.prefix = optarg; break;
+    case 'f': g_config.faults = optarg; break;
+    case 'l': g_config.listOnly = true; break;
+    default: usage(argv[0]); return 1;
+    }
+  }
+  if (optind != argc - 1 || g_config.speed < 0 || 0 == g_config.nbWorkers || 0 == g_maxCephPoolIdx ||
+      (g_config.backend != "memory" && g_config.backend != "rados")) {
+    usage(argv[0]);
+    return 1;
+  }
+  std::vector<XrdCephTraceRecord> records;
+  if (loadTrace(argv[optind], records)) return 1;
+  if (g_config.listOnly) {
+    listTrace(records);
+    return 0;
+  }
+
+  XrdCephBackend *backend = g_config.backend == "memory" ? XrdCephGetMemBackend() : XrdCephGetRadosBackend();
+  XrdCephFaultBackend *faultBackend = 0;
+  if (!g_config.faults.empty()) {
+    XrdCephFaultConfig faultConfig;
+    std::string error;
+    if (!faultConfig.parse(g_config.faults, error)) {
+      fprintf(stderr, "Invalid fault settings : %s\n", error.c_str());
+      return 1;
+    }
+    faultBackend = new XrdCephFaultBackend(backend, faultConfig);
+    backend = faultBackend;
+  }
+  ceph_posix_set_backend(backend);
+  int rc = prepareFiles(records);
+  if (rc) {
+    fprintf(stderr, "Unable to create the files needed by the replay, rc = %d\n", rc);
+    return 1;
+  }
+
+  std::vector<ReplayWorker> workers(g_config.nbWorkers);
+  std::vector<pthread_t> tids(g_config.nbWorkers);
+  for (unsigned int i = 0; i < workers.size(); i++) {
+    XrdSysThread::Run(&tids[i], workerThread, &workers[i], XRDSYSTHREAD_HOLD, "xrdceph-replay");
+  }
+  // calls on a given path go to the same worker, so that they keep their order
+  std::map<int, uint64_t> fdToHash;
+  unsigned long long start = nowNs();
+  for (std::vector<XrdCephTraceRecord>::const_iterator it = records.begin(); it != records.end(); it++) {
+    if (g_config.speed > 0) sleepUntil(start + it->timestamp / g_config.speed);
+    uint64_t key = it->fd;
+    if (it->op == CEPH_TRACE_OPEN && it->result >= 0) fdToHash[it->fd] = it->pathHash;
+    if (isPathOp(it->op)) {
+      key = it->pathHash;
+    } else {
+      std::map<int, uint64_t>::const_iterator h = fdToHash.find(it->fd);
+      if (h != fdToHash.end()) key = h->second;
+    }
+    ReplayWorker &worker = workers[key % workers.size()];
+    XrdSysCondVarHelper lock(worker.cond);
+    worker.queue.push_back(*it);
+    worker.cond.Signal();
+  }
+  for (unsigned int i = 0; i < workers.size(); i++) {
+    {
+      XrdSysCondVarHelper lock(workers[i].cond);
+      workers[i].stopping = true;
+      workers[i].cond.Signal();
+    }
+    XrdSysThread::Join(tids[i], 0);
+  }
+  unsigned long long elapsed = nowNs() - start;
+
+  unsigned long long traceDuration = records.empty() ? 0 : records.back().timestamp + records.back().latency;
+  printf("Replayed %lu calls in %.3fs, traced duration %.3fs, %llu calls skipped\n",
+         (unsigned long)records.size(), elapsed / 1e9, traceDuration / 1e9, g_nbSkipped);
+  printf("%-12s %9s %12s %12s %12s %12s %8s %8s\n", "op", "count", "trc p50(us)", "rep p50(us)",
+         "trc p99(us)", "rep p99(us)", "trc err", "rep err");
+  for (unsigned int op = 0; op < CEPH_TRACE_NB_OPS; op++) {
+    OpStats &stats = g_stats[op];
+    if (stats.replayed.empty()) continue;
+    printf("%-12s %9lu %12.1f %12.1f %12.1f %12.1f %8u %8u\n", ceph_trace_op_name(op),
+           (unsigned long)stats.replayed.size(), percentile(stats.traced, 0.5), percentile(stats.replayed, 0.5),
+           percentile(stats.traced, 0.99), percentile(stats.replayed, 0.99),
+           stats.nbTracedErrors, stats.nbErrors);
+  }
+  ceph_posix_disconnect_all();
+  delete faultBackend;
+  return 0;
+}
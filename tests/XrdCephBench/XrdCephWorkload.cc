@@ -0,0 +1,586 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// This file is part of the XRootD software suite.
+//
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//
+// In applying this licence, CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+//------------------------------------------------------------------------------
+
+/*
+ * HEP workload generator for the XrdCeph plugin.
+ *
+ * The plugin is loaded the way xrootd loads it, i.e. via dlopen and
+ * XrdOssGetStorageSystem, and the workloads only go through the XrdOss and
+ * XrdOssDF interfaces, so that the whole plugin stack is exercised.
+ * The workloads ("mixes") are :
+ *   - scattered  : ROOT-like analysis, many small reads at random places
+ *   - sequential : whole files read from start to end, e.g. copies
+ *   - tpc        : third party copy uploads through Write(XrdSfsAio*), with
+ *                  several writes in flight per upload
+ *   - storm      : stat and open/close storms on existing files
+ * Every mix is run for every combination of number of client threads and
+ * of ceph.nbconnections and a throughput/latency matrix is printed.
+ *
+ * Usage : xrdceph-workload [-l plugin] [-f configFile] [-p layoutPrefix]
+ *                          [-t threadList] [-c connectionList] [-d seconds]
+ *                          [-s fileSize] [-n nbFiles] [mix...]
+ * thread and connection lists are comma separated, e.g. -t 1,8,32 -c 1,4,16.
+ * Without -f, the in-memory backend is used. With -f, the given file provides
+ * the plugin configuration (e.g. ceph.backend rados) and ceph.nbconnections
+ * is appended to it for every run.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dlfcn.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "XrdOss/XrdOss.hh"
+#include "XrdOuc/XrdOucEnv.hh"
+#include "XrdSfs/XrdSfsAio.hh"
+#include "XrdSys/XrdSysLogger.hh"
+#include "XrdSys/XrdSysPthread.hh"
+
+#ifndef XRDCEPH_PLUGIN
+#define XRDCEPH_PLUGIN "libXrdCeph.so"
+#endif
+
+typedef XrdOss* (*XrdOssGetStorageSystem_t)(XrdOss*, XrdSysLogger*, const char*, const char*);
+
+//------------------------------------------------------------------------------
+// Configuration and helpers
+//------------------------------------------------------------------------------
+struct WorkloadConfig {
+  std::string plugin;
+  std::string configFile;
+  std::string prefix;
+  std::vector<unsigned int> threads;
+  std::vector<unsigned int> connections;
+  unsigned int duration;
+  unsigned long long fileSize;
+  unsigned int nbFiles;
+  /// size of the reads in the sequential mix and of the writes in the tpc mix
+  size_t blockSize;
+  /// number of writes in flight per upload in the tpc mix
+  unsigned int tpcWindow;
+  /// number of reads per file opening in the scattered mix
+  unsigned int scatteredReads;
+};
+
+static WorkloadConfig g_config;
+
+static inline unsigned long long nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static std::string dataFile(unsigned int idx) {
+  char name[64];
+  snprintf(name, sizeof(name), "/workload/data%u", idx);
+  return g_config.prefix + name;
+}
+
+static std::string uploadFile(unsigned int thread, unsigned int n) {
+  char name[64];
+  snprintf(name, sizeof(name), "/workload/upload%u.%u", thread, n);
+  return g_config.prefix + name;
+}
+
+static bool parseList(const char *arg, std::vector<unsigned int> &list) {
+  list.clear();
+  std::stringstream ss(arg);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    unsigned long value = strtoul(item.c_str(), 0, 10);
+    if (0 == value) return false;
+    list.push_back(value);
+  }
+  return !list.empty();
+}
+
+//------------------------------------------------------------------------------
+// Per thread state and statistics
+//------------------------------------------------------------------------------
+struct WorkloadThread;
+
+/// aio used by the tpc uploads, handing itself back to its thread when done
+class WorkloadAio : public XrdSfsAio {
+public:
+  WorkloadAio() : m_thread(0), m_start(0) { memset(&sfsAio, 0, sizeof(sfsAio)); }
+  void doneRead();
+  void doneWrite();
+  void Recycle() {}
+  WorkloadThread *m_thread;
+  unsigned long long m_start;
+};
+
+struct WorkloadThread {
+  WorkloadThread() : idx(0), seed(0), oss(0), nbErrors(0), bytes(0), nbUploads(0), doneSem(0) {}
+  unsigned int idx;
+  unsigned int seed;
+  XrdOss *oss;
+  XrdOucEnv env;
+  std::vector<char> buffer;
+  std::vector<unsigned long long> latencies;
+  unsigned int nbErrors;
+  unsigned long long bytes;
+  unsigned int nbUploads;
+  // completed aios of the tpc mix
+  XrdSysSemaphore doneSem;
+  XrdSysMutex doneMutex;
+  std::vector<WorkloadAio*> done;
+  std::vector<WorkloadAio> aios;
+
+  void record(unsigned long long start, long long rc) {
+    latencies.push_back(nowNs() - start);
+    if (rc < 0) nbErrors++; else bytes += rc;
+  }
+};
+
+void WorkloadAio::doneRead() { doneWrite(); }
+
+void WorkloadAio::doneWrite() {
+  WorkloadThread *t = m_thread;
+  {
+    XrdSysMutexHelper lock(t->doneMutex);
+    t->done.push_back(this);
+  }
+  t->doneSem.Post();
+}
+
+static WorkloadAio* waitAio(WorkloadThread &t) {
+  t.doneSem.Wait();
+  XrdSysMutexHelper lock(t.doneMutex);
+  WorkloadAio *aio = t.done.back();
+  t.done.pop_back();
+  return aio;
+}
+
+//------------------------------------------------------------------------------
+// The mixes. Each call runs one "session" (a file opening or a single
+// metadata operation) and records one latency per elementary operation
+//------------------------------------------------------------------------------
+struct WorkloadMix {
+  const char *name;
+  /// called once per thread before the measurement
+  void (*setup)(WorkloadThread &t);
+  /// one session of the workload
+  void (*run)(WorkloadThread &t);
+  /// called once per thread after the measurement
+  void (*teardown)(WorkloadThread &t);
+};
+
+static void setupNothing(WorkloadThread &t) {}
+static void teardownNothing(WorkloadThread &t) {}
+
+static XrdOssDF* openFile(WorkloadThread &t, const std::string &path, int flags) {
+  XrdOssDF *file = t.oss->newFile("xrdceph-workload");
+  unsigned long long start = nowNs();
+  int rc = file->Open(path.c_str(), flags, 0644, t.env);
+  t.record(start, rc < 0 ? rc : 0);
+  if (rc < 0) {
+    delete file;
+    return 0;
+  }
+  return file;
+}
+
+static void closeFile(WorkloadThread &t, XrdOssDF *file) {
+  file->Close();
+  delete file;
+}
+
+static void setupRead(WorkloadThread &t) {
+  t.buffer.resize(std::max(g_config.blockSize, (size_t)128*1024));
+}
+
+/// ROOT-like reading : baskets of a few KB to 128KB, spread over the file
+static void runScattered(WorkloadThread &t) {
+  XrdOssDF *file = openFile(t, dataFile(rand_r(&t.seed) % g_config.nbFiles), O_RDONLY);
+  if (0 == file) return;
+  for (unsigned int i = 0; i < g_config.scatteredReads; i++) {
+    size_t len = 1024 * (1 + rand_r(&t.seed) % 128);
+    off_t offset = ((unsigned long long)rand_r(&t.seed) * 4096) % (g_config.fileSize - len);
+    unsigned long long start = nowNs();
+    t.record(start, file->Read(&t.buffer[0], offset, len));
+  }
+  closeFile(t, file);
+}
+
+static void runSequential(WorkloadThread &t) {
+  XrdOssDF *file = openFile(t, dataFile(rand_r(&t.seed) % g_config.nbFiles), O_RDONLY);
+  if (0 == file) return;
+  for (unsigned long long offset = 0; offset < g_config.fileSize; offset += g_config.blockSize) {
+    unsigned long long start = nowNs();
+    ssize_t rc = file->Read(&t.buffer[0], offset, g_config.blockSize);
+    t.record(start, rc);
+    if (rc <= 0) break;
+  }
+  closeFile(t, file);
+}
+
+static void setupTpc(WorkloadThread &t) {
+  t.buffer.resize(g_config.blockSize, 'u');
+  t.aios.resize(g_config.tpcWindow);
+  for (unsigned int i = 0; i < t.aios.size(); i++) {
+    t.aios[i].m_thread = &t;
+  }
+}
+
+static bool submitWrite(WorkloadThread &t, XrdOssDF *file, WorkloadAio *aio, unsigned long long offset) {
+  aio->sfsAio.aio_buf = &t.buffer[0];
+  aio->sfsAio.aio_nbytes = std::min((unsigned long long)g_config.blockSize, g_config.fileSize - offset);
+  aio->sfsAio.aio_offset = offset;
+  aio->Result = 0;
+  aio->m_start = nowNs();
+  int rc = file->Write(aio);
+  if (rc < 0) {
+    t.record(aio->m_start, rc);
+    return false;
+  }
+  return true;
+}
+
+/// TPC-like upload : the whole file is written with a window of aio writes
+static void runTpc(WorkloadThread &t) {
+  std::string path = uploadFile(t.idx, t.nbUploads++);
+  XrdOssDF *file = openFile(t, path, O_WRONLY|O_CREAT|O_TRUNC);
+  if (0 == file) return;
+  unsigned long long offset = 0;
+  unsigned int inFlight = 0;
+  bool failed = false;
+  for (unsigned int i = 0; i < t.aios.size() && offset < g_config.fileSize; i++) {
+    if (!submitWrite(t, file, &t.aios[i], offset)) {
+      failed = true;
+      break;
+    }
+    offset += g_config.blockSize;
+    inFlight++;
+  }
+  while (inFlight > 0) {
+    WorkloadAio *aio = waitAio(t);
+    inFlight--;
+    t.record(aio->m_start, aio->Result);
+    if (aio->Result < 0) failed = true;
+    if (!failed && offset < g_config.fileSize) {
+      if (submitWrite(t, file, aio, offset)) {
+        offset += g_config.blockSize;
+        inFlight++;
+      } else {
+        failed = true;
+      }
+    }
+  }
+  closeFile(t, file);
+  // do not let uploads accumulate, the data set has to fit in the backend
+  t.oss->Unlink(path.c_str(), 0, &t.env);
+}
+
+/// metadata storm : stats mixed with open/close of existing files
+static void runStorm(WorkloadThread &t) {
+  std::string path = dataFile(rand_r(&t.seed) % g_config.nbFiles);
+  if (rand_r(&t.seed) % 2) {
+    struct stat buf;
+    unsigned long long start = nowNs();
+    int rc = t.oss->Stat(path.c_str(), &buf, 0, &t.env);
+    t.record(start, rc < 0 ? rc : 0);
+  } else {
+    XrdOssDF *file = openFile(t, path, O_RDONLY);
+    if (file) closeFile(t, file);
+  }
+}
+
+static WorkloadMix g_mixes[] = {
+  { "scattered",  setupRead,    runScattered,  teardownNothing },
+  { "sequential", setupRead,    runSequential, teardownNothing },
+  { "tpc",        setupTpc,     runTpc,        teardownNothing },
+  { "storm",      setupNothing, runStorm,      teardownNothing },
+};
+
+//------------------------------------------------------------------------------
+// Plugin instantiation
+//------------------------------------------------------------------------------
+static XrdOssGetStorageSystem_t g_getStorageSystem = 0;
+static XrdSysLogger *g_logger = 0;
+
+static int loadPlugin() {
+  void *handle = dlopen(g_config.plugin.c_str(), RTLD_NOW|RTLD_GLOBAL);
+  if (0 == handle) {
+    fprintf(stderr, "Unable to load %s : %s\n", g_config.plugin.c_str(), dlerror());
+    return -1;
+  }
+  g_getStorageSystem = (XrdOssGetStorageSystem_t)dlsym(handle, "XrdOssGetStorageSystem");
+  if (0 == g_getStorageSystem) {
+    fprintf(stderr, "No XrdOssGetStorageSystem in %s : %s\n", g_config.plugin.c_str(), dlerror());
+    return -1;
+  }
+  g_logger = new XrdSysLogger();
+  return 0;
+}
+
+/// instantiates the plugin with the given number of connections,
+/// as xrootd would do with a configuration file
+static XrdOss* newOss(unsigned int nbConnections) {
+  char cfgName[] = "/tmp/xrdceph-workload.XXXXXX";
+  int fd = mkstemp(cfgName);
+  if (fd < 0) {
+    fprintf(stderr, "Unable to create temporary configuration file : %s\n", strerror(errno));
+    return 0;
+  }
+  close(fd);
+  {
+    std::ofstream cfg(cfgName);
+    if (g_config.configFile.empty()) {
+      cfg << "ceph.backend memory\n";
+    } else {
+      std::ifstream base(g_config.configFile.c_str());
+      cfg << base.rdbuf() << "\n";
+    }
+    cfg << "ceph.nbconnections " << nbConnections << "\n";
+  }
+  XrdOss *oss = g_getStorageSystem(0, g_logger, cfgName, 0);
+  if (oss && oss->Init(g_logger, cfgName)) {
+    delete oss;
+    oss = 0;
+  }
+  unlink(cfgName);
+  if (0 == oss) {
+    fprintf(stderr, "Unable to instantiate the XrdCeph plugin\n");
+  }
+  return oss;
+}
+
+static int populate(XrdOss *oss) {
+  XrdOucEnv env;
+  std::vector<char> block(1024*1024, 'd');
+  for (unsigned int i = 0; i < g_config.nbFiles; i++) {
+    XrdOssDF *file = oss->newFile("xrdceph-workload");
+    int rc = file->Open(dataFile(i).c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644, env);
+    for (unsigned long long off = 0; 0 == rc && off < g_config.fileSize; off += block.size()) {
+      ssize_t n = file->Write(&block[0], off, std::min((unsigned long long)block.size(), g_config.fileSize - off));
+      if (n < 0) rc = n;
+    }
+    int crc = file->Close();
+    delete file;
+    if (rc) return rc;
+    if (crc) return crc;
+  }
+  return 0;
+}
+
+static void cleanup(XrdOss *oss) {
+  XrdOucEnv env;
+  for (unsigned int i = 0; i < g_config.nbFiles; i++) {
+    oss->Unlink(dataFile(i).c_str(), 0, &env);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Threading : all threads run setup, wait for the start signal, run sessions
+// until the deadline, report and wait for the end signal before tearing down
+//------------------------------------------------------------------------------
+struct RunState {
+  RunState() : cond(0), ready(0), finished(0), started(false), stopped(false), deadline(0), mix(0) {}
+  XrdSysCondVar cond;
+  unsigned int ready;
+  unsigned int finished;
+  bool started;
+  bool stopped;
+  unsigned long long deadline;
+  WorkloadMix *mix;
+};
+
+static void* workloadThread(void *arg) {
+  std::pair<RunState*, WorkloadThread*> *p = (std::pair<RunState*, WorkloadThread*>*)arg;
+  RunState &state = *p->first;
+  WorkloadThread &t = *p->second;
+  state.mix->setup(t);
+  state.cond.Lock();
+  state.ready++;
+  state.cond.Broadcast();
+  while (!state.started) state.cond.Wait();
+  state.cond.UnLock();
+  while (nowNs() < state.deadline) {
+    state.mix->run(t);
+  }
+  state.cond.Lock();
+  state.finished++;
+  state.cond.Broadcast();
+  while (!state.stopped) state.cond.Wait();
+  state.cond.UnLock();
+  state.mix->teardown(t);
+  return 0;
+}
+
+static double percentile(const std::vector<unsigned long long> &sorted, double p) {
+  if (sorted.empty()) return 0;
+  size_t idx = (size_t)(p * (sorted.size() - 1));
+  return sorted[idx] / 1000.0;
+}
+
+static void runMix(XrdOss *oss, WorkloadMix &mix, unsigned int nbConnections, unsigned int nbThreads) {
+  RunState state;
+  state.mix = &mix;
+  std::vector<WorkloadThread*> threads;
+  std::vector<pthread_t> tids(nbThreads);
+  std::vector<std::pair<RunState*, WorkloadThread*> > args(nbThreads);
+  for (unsigned int i = 0; i < nbThreads; i++) {
+    WorkloadThread *t = new WorkloadThread;
+    t->idx = i;
+    t->seed = i + 1;
+    t->oss = oss;
+    threads.push_back(t);
+    args[i] = std::make_pair(&state, t);
+    XrdSysThread::Run(&tids[i], workloadThread, &args[i], XRDSYSTHREAD_HOLD, "xrdceph-workload");
+  }
+  state.cond.Lock();
+  while (state.ready < nbThreads) state.cond.Wait();
+  unsigned long long start = nowNs();
+  state.deadline = start + g_config.duration * 1000000000ULL;
+  state.started = true;
+  state.cond.Broadcast();
+  while (state.finished < nbThreads) state.cond.Wait();
+  unsigned long long elapsed = nowNs() - start;
+  state.stopped = true;
+  state.cond.Broadcast();
+  state.cond.UnLock();
+  for (unsigned int i = 0; i < nbThreads; i++) {
+    XrdSysThread::Join(tids[i], 0);
+  }
+  std::vector<unsigned long long> latencies;
+  unsigned int nbErrors = 0;
+  unsigned long long bytes = 0;
+  for (unsigned int i = 0; i < nbThreads; i++) {
+    latencies.insert(latencies.end(), threads[i]->latencies.begin(), threads[i]->latencies.end());
+    nbErrors += threads[i]->nbErrors;
+    bytes += threads[i]->bytes;
+    delete threads[i];
+  }
+  std::sort(latencies.begin(), latencies.end());
+  printf("%-10s %5u %7u %12.0f %10.1f %10.2f %10.2f %10.2f %8u\n",
+         mix.name, nbConnections, nbThreads, latencies.size() * 1e9 / elapsed,
+         bytes * 1e3 / elapsed, percentile(latencies, 0.5),
+         percentile(latencies, 0.99), percentile(latencies, 0.999), nbErrors);
+  fflush(stdout);
+}
+
+static void usage(const char *prog) {
+  fprintf(stderr, "Usage : %s [-l plugin] [-f configFile] [-p layoutPrefix] "
+          "[-t threadList] [-c connectionList] [-d seconds] [-s fileSize] "
+          "[-n nbFiles] [mix...]\n", prog);
+  fprintf(stderr, "mixes :");
+  for (unsigned int i = 0; i < sizeof(g_mixes)/sizeof(WorkloadMix); i++) fprintf(stderr, " %s", g_mixes[i].name);
+  fprintf(stderr, "\n");
+}
+
+int main(int argc, char **argv) {
+  g_config.plugin = XRDCEPH_PLUGIN;
+  g_config.prefix = "workload@workload,1,4194304,4194304:";
+  g_config.threads.push_back(1);
+  g_config.threads.push_back(4);
+  g_config.threads.push_back(16);
+  g_config.threads.push_back(64);
+  g_config.connections.push_back(1);
+  g_config.connections.push_back(4);
+  g_config.connections.push_back(16);
+  g_config.duration = 5;
+  g_config.fileSize = 32*1024*1024;
+  g_config.nbFiles = 8;
+  g_config.blockSize = 1024*1024;
+  g_config.tpcWindow = 4;
+  g_config.scatteredReads = 100;
+  int c;
+  while ((c = getopt(argc, argv, "l:f:p:t:c:d:s:n:h")) != -1) {
+    switch (c) {
+    case 'l': g_config.plugin = optarg; break;
+    case 'f': g_config.configFile = optarg; break;
+    case 'p': g_config.prefix = optarg; break;
+    case 't':
+      if (!parseList(optarg, g_config.threads)) { usage(argv[0]); return 1; }
+      break;
+    case 'c':
+      if (!parseList(optarg, g_config.connections)) { usage(argv[0]); return 1; }
+      break;
+    case 'd': g_config.duration = atoi(optarg); break;
+    case 's': g_config.fileSize = strtoull(optarg, 0, 10); break;
+    case 'n': g_config.nbFiles = atoi(optarg); break;
+    default: usage(argv[0]); return 1;
+    }
+  }
+  if (0 == g_config.duration || 0 == g_config.nbFiles || g_config.fileSize <= 128*1024) {
+    usage(argv[0]);
+    return 1;
+  }
+  std::vector<WorkloadMix*> mixes;
+  for (int i = optind; i < argc; i++) {
+    WorkloadMix *mix = 0;
+    for (unsigned int j = 0; j < sizeof(g_mixes)/sizeof(WorkloadMix); j++) {
+      if (!strcmp(argv[i], g_mixes[j].name)) mix = &g_mixes[j];
+    }
+    if (0 == mix) {
+      usage(argv[0]);
+      return 1;
+    }
+    mixes.push_back(mix);
+  }
+  if (mixes.empty()) {
+    for (unsigned int j = 0; j < sizeof(g_mixes)/sizeof(WorkloadMix); j++) mixes.push_back(&g_mixes[j]);
+  }
+  if (loadPlugin()) return 1;
+
+  // the data set is shared by all runs
+  XrdOss *oss = newOss(g_config.connections[0]);
+  if (0 == oss) return 1;
+  int rc = populate(oss);
+  delete oss;
+  if (rc) {
+    fprintf(stderr, "Unable to create the data set, rc = %d\n", rc);
+    return 1;
+  }
+
+  printf("%-10s %5s %7s %12s %10s %10s %10s %10s %8s\n", "mix", "conns", "threads",
+         "ops/s", "MB/s", "p50(us)", "p99(us)", "p999(us)", "errors");
+  for (std::vector<WorkloadMix*>::const_iterator it = mixes.begin(); it != mixes.end(); it++) {
+    for (unsigned int i = 0; i < g_config.connections.size(); i++) {
+      oss = newOss(g_config.connections[i]);
+      if (0 == oss) return 1;
+      for (unsigned int j = 0; j < g_config.threads.size(); j++) {
+        runMix(oss, **it, g_config.connections[i], g_config.threads[j]);
+      }
+      delete oss;
+    }
+  }
+
+  oss = newOss(g_config.connections[0]);
+  if (oss) {
+    cleanup(oss);
+    delete oss;
+  }
+  return 0;
+}
@@ -0,0 +1,255 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//------------------------------------------------------------------------------
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <time.h>
+#include <XrdCeph/XrdCephPosix.hh>
+#include <XrdCeph/XrdCephMemBackend.hh>
+#include <XrdCeph/XrdCephFaultBackend.hh>
+#include <XrdCeph/XrdCephRegistry.hh>
+#include <XrdSfs/XrdSfsAio.hh>
+#include <XrdSys/XrdSysPthread.hh>
+
+#define FAULT_LAYOUT "user@pool,1,65536,65536:"
+
+//------------------------------------------------------------------------------
+// Declaration
+//------------------------------------------------------------------------------
+class CephFaultBackendTest: public CppUnit::TestCase
+{
+  public:
+    CPPUNIT_TEST_SUITE( CephFaultBackendTest );
+      CPPUNIT_TEST( ConfigTest );
+      CPPUNIT_TEST( ErrorTest );
+      CPPUNIT_TEST( AioTest );
+      CPPUNIT_TEST( HealthTest );
+    CPPUNIT_TEST_SUITE_END();
+    void tearDown();
+    void ConfigTest();
+    void ErrorTest();
+    void AioTest();
+    void HealthTest();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CephFaultBackendTest );
+
+//------------------------------------------------------------------------------
+// Helper functions
+//------------------------------------------------------------------------------
+static XrdCephMemBackend g_faultMemBackend;
+
+void CephFaultBackendTest::tearDown() {
+  ceph_posix_disconnect_all();
+  ceph_posix_set_backend(&g_faultMemBackend);
+  g_faultMemBackend.clear();
+}
+
+static bool parses(const char *spec) {
+  XrdCephFaultConfig config;
+  std::string error;
+  return config.parse(spec, error);
+}
+
+static double nowMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/// aio object waiting for its completion
+class FaultTestAio : public XrdSfsAio {
+public:
+  FaultTestAio(char *buf, size_t len) : m_sem(0) {
+    memset(&sfsAio, 0, sizeof(sfsAio));
+    sfsAio.aio_buf = buf;
+    sfsAio.aio_nbytes = len;
+  }
+  void doneRead() { m_sem.Post(); }
+  void doneWrite() { m_sem.Post(); }
+  void Recycle() {}
+  void wait() { m_sem.Wait(); }
+private:
+  XrdSysSemaphore m_sem;
+};
+
+static void faultTestAioCallback(XrdSfsAio *aiop, size_t rc) {
+  aiop->Result = rc;
+  aiop->doneRead();
+}
+
+//------------------------------------------------------------------------------
+// Configuration test
+//------------------------------------------------------------------------------
+void CephFaultBackendTest::ConfigTest() {
+  CPPUNIT_ASSERT(parses(""));
+  CPPUNIT_ASSERT(parses("read.latency=fixed:100 write.latency=uniform:10:20 meta.latency=exp:50"));
+  CPPUNIT_ASSERT(parses("all.latency=lognormal:500:0.5 read.tail=pareto:20000:1.2@0.01"));
+  CPPUNIT_ASSERT(parses("all.error=ETIMEDOUT:1000 write.error=EBLOCKLISTED:7 meta.error=5:3"));
+  CPPUNIT_ASSERT(parses("pool.slow.pool.slowdown=4 callback.delay=fixed:10 callback.threads=2 seed=3"));
+  CPPUNIT_ASSERT(!parses("read.latency"));
+  CPPUNIT_ASSERT(!parses("read.latency=gauss:10"));
+  CPPUNIT_ASSERT(!parses("read.latency=uniform:20:10"));
+  CPPUNIT_ASSERT(!parses("read.tail=fixed:10@2"));
+  CPPUNIT_ASSERT(!parses("other.latency=fixed:10"));
+  CPPUNIT_ASSERT(!parses("read.error=EIO:0"));
+  CPPUNIT_ASSERT(!parses("pool.slow.slowdown=0.5"));
+  CPPUNIT_ASSERT(!parses("callback.threads=0"));
+  XrdCephFaultConfig config;
+  std::string error;
+  CPPUNIT_ASSERT(config.parse("all.error=EIO:10 pool.p1.slowdown=2.5", error));
+  CPPUNIT_ASSERT(config.ops[FAULT_META].error == -EIO);
+  CPPUNIT_ASSERT(config.ops[FAULT_READ].errorPeriod == 10);
+  CPPUNIT_ASSERT(config.poolSlowdowns["p1"] == 2.5);
+}
+
+//------------------------------------------------------------------------------
+// Periodic errors test
+//------------------------------------------------------------------------------
+void CephFaultBackendTest::ErrorTest() {
+  XrdCephFaultConfig config;
+  std::string error;
+  CPPUNIT_ASSERT(config.parse("read.error=EIO:3 meta.error=EBLOCKLISTED:1000000", error));
+  XrdCephFaultBackend backend(&g_faultMemBackend, config);
+  ceph_posix_set_backend(&backend);
+  std::string path = FAULT_LAYOUT "/errors";
+  char buf[1000];
+  memset(buf, 'e', sizeof(buf));
+  int fd = ceph_posix_open(0, path.c_str(), O_WRONLY|O_CREAT, 0644);
+  CPPUNIT_ASSERT(fd >= 0);
+  CPPUNIT_ASSERT(ceph_posix_pwrite(fd, buf, sizeof(buf), 0) == sizeof(buf));
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  fd = ceph_posix_open(0, path.c_str(), O_RDONLY, 0);
+  CPPUNIT_ASSERT(fd >= 0);
+  // every third read fails, the others go through
+  for (unsigned int i = 1; i <= 9; i++) {
+    ssize_t rc = ceph_posix_pread(fd, buf, sizeof(buf), 0);
+    CPPUNIT_ASSERT(rc == (i % 3 ? (ssize_t)sizeof(buf) : -EIO));
+  }
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  ceph_posix_disconnect_all();
+}
+
+//------------------------------------------------------------------------------
+// Asynchronous latency and error test
+//------------------------------------------------------------------------------
+void CephFaultBackendTest::AioTest() {
+  XrdCephFaultConfig config;
+  std::string error;
+  CPPUNIT_ASSERT(config.parse("read.latency=fixed:50000 read.error=ETIMEDOUT:2", error));
+  XrdCephFaultBackend backend(&g_faultMemBackend, config);
+  ceph_posix_set_backend(&backend);
+  std::string path = FAULT_LAYOUT "/aio";
+  std::vector<char> data(100000, 'a');
+  int fd = ceph_posix_open(0, path.c_str(), O_WRONLY|O_CREAT, 0644);
+  CPPUNIT_ASSERT(fd >= 0);
+  CPPUNIT_ASSERT(ceph_posix_pwrite(fd, &data[0], data.size(), 0) == (ssize_t)data.size());
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  fd = ceph_posix_open(0, path.c_str(), O_RDONLY, 0);
+  CPPUNIT_ASSERT(fd >= 0);
+  // the completion is held back by the injected latency
+  std::vector<char> buf(data.size());
+  FaultTestAio aio(&buf[0], buf.size());
+  double start = nowMs();
+  CPPUNIT_ASSERT(ceph_aio_read(fd, &aio, faultTestAioCallback) == 0);
+  aio.wait();
+  CPPUNIT_ASSERT(nowMs() - start >= 50);
+  CPPUNIT_ASSERT(aio.Result == (ssize_t)data.size());
+  CPPUNIT_ASSERT(buf == data);
+  // injected errors are reported through the callback
+  FaultTestAio failing(&buf[0], buf.size());
+  CPPUNIT_ASSERT(ceph_aio_read(fd, &failing, faultTestAioCallback) == 0);
+  failing.wait();
+  CPPUNIT_ASSERT(failing.Result == -ETIMEDOUT);
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  ceph_posix_disconnect_all();
+}
+
+//------------------------------------------------------------------------------
+// Connection health and recovery test
+//------------------------------------------------------------------------------
+void CephFaultBackendTest::HealthTest() {
+  // blocklisting or repeated timeouts turn a connection away
+  XrdCephRegistry registry;
+  registry.init(3);
+  unsigned long long generation = registry.generation(2);
+  CPPUNIT_ASSERT(!registry.opResult(2, generation, -ETIMEDOUT, 3));
+  CPPUNIT_ASSERT(!registry.opResult(2, generation, -ENOENT, 3));
+  CPPUNIT_ASSERT(!registry.opResult(2, generation, -ETIMEDOUT, 3));
+  CPPUNIT_ASSERT(!registry.opResult(2, generation, -ETIMEDOUT, 3));
+  CPPUNIT_ASSERT(registry.opResult(2, generation, -ETIMEDOUT, 3));
+  generation = registry.generation(1);
+  CPPUNIT_ASSERT(registry.opResult(1, generation, -EBLOCKLISTED, 3));
+  CPPUNIT_ASSERT(!registry.opResult(1, generation, -EBLOCKLISTED, 3));
+  for (unsigned int i = 0; i < 10; i++) {
+    CPPUNIT_ASSERT(registry.pickConnection(CEPH_CONN_ROUND_ROBIN) == 0);
+    CPPUNIT_ASSERT(registry.pickConnection(CEPH_CONN_LEAST_OUTSTANDING) == 0);
+  }
+  // errors of a retired session do not turn the new one away
+  registry.retireConnection(1);
+  registry.setHealthy(1);
+  CPPUNIT_ASSERT(registry.generation(1) != generation);
+  CPPUNIT_ASSERT(!registry.opResult(1, generation, -EBLOCKLISTED, 3));
+  CPPUNIT_ASSERT(registry.load(1).healthy());
+  // a blocklisted session gets replaced in the background
+  XrdCephFaultConfig config;
+  std::string error;
+  CPPUNIT_ASSERT(config.parse("read.error=EBLOCKLISTED:2", error));
+  XrdCephFaultBackend backend(&g_faultMemBackend, config);
+  ceph_posix_set_backend(&backend);
+  std::string path = FAULT_LAYOUT "/health";
+  char buf[1000];
+  memset(buf, 'h', sizeof(buf));
+  int fd = ceph_posix_open(0, path.c_str(), O_WRONLY|O_CREAT, 0644);
+  CPPUNIT_ASSERT(fd >= 0);
+  CPPUNIT_ASSERT(ceph_posix_pwrite(fd, buf, sizeof(buf), 0) == sizeof(buf));
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  fd = ceph_posix_open(0, path.c_str(), O_RDONLY, 0);
+  CPPUNIT_ASSERT(fd >= 0);
+  CPPUNIT_ASSERT(ceph_posix_pread(fd, buf, sizeof(buf), 0) == sizeof(buf));
+  CPPUNIT_ASSERT(ceph_posix_pread(fd, buf, sizeof(buf), 0) == -EBLOCKLISTED);
+  XrdCephConnectionStats stats;
+  double start = nowMs();
+  do {
+    struct timespec pause = {0, 1000000};
+    nanosleep(&pause, 0);
+    CPPUNIT_ASSERT(ceph_posix_get_connection_stats(0, &stats) == 0);
+  } while ((stats.nbRecoveries == 0 || !stats.healthy) && nowMs() - start < 10000);
+  CPPUNIT_ASSERT(stats.nbRecoveries == 1 && stats.healthy);
+  // the open file keeps its handles, new ones use the new connection
+  CPPUNIT_ASSERT(ceph_posix_pread(fd, buf, sizeof(buf), 0) == sizeof(buf));
+  // errors on the retired session do not start another recovery
+  CPPUNIT_ASSERT(ceph_posix_pread(fd, buf, sizeof(buf), 0) == -EBLOCKLISTED);
+  CPPUNIT_ASSERT(ceph_posix_get_connection_stats(0, &stats) == 0);
+  CPPUNIT_ASSERT(stats.nbRecoveries == 1 && stats.healthy);
+  // the retired session goes with the last file using it
+  XrdCephRegistryStats registryStats;
+  ceph_posix_get_registry_stats(&registryStats);
+  CPPUNIT_ASSERT(registryStats.nbRetiredSessions == 1);
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  ceph_posix_get_registry_stats(&registryStats);
+  CPPUNIT_ASSERT(registryStats.nbRetiredSessions == 0);
+  struct stat st;
+  CPPUNIT_ASSERT(ceph_posix_stat(0, path.c_str(), &st) == 0);
+  CPPUNIT_ASSERT(st.st_size == sizeof(buf));
+  ceph_posix_disconnect_all();
+}
@@ -0,0 +1,985 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2026 by European Organization for Nuclear Research (CERN)
+//------------------------------------------------------------------------------
+// XRootD is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// XRootD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with XRootD.  If not, see <http://www.gnu.org/licenses/>.
+//------------------------------------------------------------------------------
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
+#include <XrdCeph/XrdCephPosix.hh>
+#include <XrdCeph/XrdCephMemBackend.hh>
+#include <XrdCeph/XrdCephRegistry.hh>
+#include <XrdCeph/XrdCephAffinity.hh>
+#include <XrdOuc/XrdOucEnv.hh>
+#include <XrdOuc/XrdOucIOVec.hh>
+#include <XrdSfs/XrdSfsAio.hh>
+#include <XrdSys/XrdSysPthread.hh>
+
+// small layout so that files span several objects : 2 stripes of 64KB, objects of 128KB
+#define SMALL_LAYOUT "user@pool,2,65536,131072:"
+
+//------------------------------------------------------------------------------
+// Declaration
+//------------------------------------------------------------------------------
+class CephMemBackendTest: public CppUnit::TestCase
+{
+  public:
+    CPPUNIT_TEST_SUITE( CephMemBackendTest );
+      CPPUNIT_TEST( ReadWriteTest );
+      CPPUNIT_TEST( AioTest );
+      CPPUNIT_TEST( XattrTest );
+      CPPUNIT_TEST( TruncateUnlinkTest );
+      CPPUNIT_TEST( ReaddirTest );
+      CPPUNIT_TEST( FileDescriptorTest );
+      CPPUNIT_TEST( LayoutsTest );
+      CPPUNIT_TEST( ConnectionPolicyTest );
+      CPPUNIT_TEST( AffinityTest );
+      CPPUNIT_TEST( ConnectionClassTest );
+      CPPUNIT_TEST( PreconnectTest );
+      CPPUNIT_TEST( ClusterRoutingTest );
+      CPPUNIT_TEST( OptionTest );
+      CPPUNIT_TEST( ReadVTest );
+      CPPUNIT_TEST( WriteVTest );
+      CPPUNIT_TEST( SplitReadTest );
+      CPPUNIT_TEST( SplitWriteTest );
+      CPPUNIT_TEST( DirectReadTest );
+    CPPUNIT_TEST_SUITE_END();
+    void setUp();
+    void tearDown();
+    void ReadWriteTest();
+    void AioTest();
+    void XattrTest();
+    void TruncateUnlinkTest();
+    void ReaddirTest();
+    void FileDescriptorTest();
+    void LayoutsTest();
+    void ConnectionPolicyTest();
+    void AffinityTest();
+    void ConnectionClassTest();
+    void PreconnectTest();
+    void ClusterRoutingTest();
+    void OptionTest();
+    void ReadVTest();
+    void WriteVTest();
+    void SplitReadTest();
+    void SplitWriteTest();
+    void DirectReadTest();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( CephMemBackendTest );
+
+//------------------------------------------------------------------------------
+// Helper functions
+//------------------------------------------------------------------------------
+static XrdCephMemBackend g_memBackend;
+/// striper cache limit and connection settings, declared in XrdCephPosix.cc
+extern unsigned int g_maxCephStripers;
+extern unsigned int g_maxCephLayouts;
+extern unsigned int g_maxCephPoolIdx;
+extern XrdCephConnectionPolicy g_cephConnectionPolicy;
+extern XrdCephAffinityMode g_cephAffinityMode;
+extern unsigned int g_cephClassNbConnections[CEPH_NB_CONNECTION_CLASSES];
+extern unsigned long long g_cephReadSplitSize;
+extern unsigned long long g_cephWriteSplitSize;
+extern bool g_cephDirectRead;
+
+void CephMemBackendTest::setUp() {
+  ceph_posix_set_backend(&g_memBackend);
+}
+
+void CephMemBackendTest::tearDown() {
+  ceph_posix_disconnect_all();
+  g_memBackend.clear();
+}
+
+static std::vector<char> pattern(size_t size, unsigned int seed) {
+  std::vector<char> res(size);
+  for (size_t i = 0; i < size; i++) {
+    res[i] = (char)((i * 31 + seed) % 251);
+  }
+  return res;
+}
+
+static void createFile(const std::string &path, const std::vector<char> &content) {
+  int fd = ceph_posix_open(0, path.c_str(), O_WRONLY|O_CREAT, 0644);
+  CPPUNIT_ASSERT(fd >= 0);
+  CPPUNIT_ASSERT(ceph_posix_pwrite(fd, &content[0], content.size(), 0) == (ssize_t)content.size());
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+}
+
+/// aio object waiting for its completion
+class TestAio : public XrdSfsAio {
+public:
+  TestAio(char *buf, size_t len, off_t off) : m_sem(0) {
+    memset(&sfsAio, 0, sizeof(sfsAio));
+    sfsAio.aio_buf = buf;
+    sfsAio.aio_nbytes = len;
+    sfsAio.aio_offset = off;
+  }
+  void doneRead() { m_sem.Post(); }
+  void doneWrite() { m_sem.Post(); }
+  void Recycle() {}
+  void wait() { m_sem.Wait(); }
+private:
+  XrdSysSemaphore m_sem;
+};
+
+static void testAioCallback(XrdSfsAio *aiop, size_t rc) {
+  aiop->Result = rc;
+  aiop->doneRead();
+}
+
+//------------------------------------------------------------------------------
+// Read/Write test
+//------------------------------------------------------------------------------
+void CephMemBackendTest::ReadWriteTest() {
+  std::string path = SMALL_LAYOUT "/readwrite";
+  std::vector<char> content = pattern(1000000, 7);
+  createFile(path, content);
+  // existing files cannot be reopened for write without O_TRUNC
+  CPPUNIT_ASSERT(ceph_posix_open(0, path.c_str(), O_WRONLY|O_CREAT, 0644) == -EEXIST);
+  int fd = ceph_posix_open(0, path.c_str(), O_RDONLY, 0);
+  CPPUNIT_ASSERT(fd >= 0);
+  struct stat buf;
+  CPPUNIT_ASSERT(ceph_posix_fstat(fd, &buf) == 0);
+  CPPUNIT_ASSERT(buf.st_size == (off_t)content.size());
+  // reads crossing stripe units and objects boundaries
+  size_t offsets[] = {0, 65000, 131000, 262144, 999000};
+  for (unsigned int i = 0; i < sizeof(offsets)/sizeof(size_t); i++) {
+    std::vector<char> data(200000);
+    ssize_t rc = ceph_posix_pread(fd, &data[0], data.size(), offsets[i]);
+    size_t expected = std::min(data.size(), content.size() - offsets[i]);
+    CPPUNIT_ASSERT(rc == (ssize_t)expected);
+    CPPUNIT_ASSERT(!memcmp(&data[0], &content[offsets[i]], expected));
+  }
+  // reads are not allowed on write only files and the other way round
+  char c;
+  CPPUNIT_ASSERT(ceph_posix_pwrite(fd, &c, 1, 0) == -EBADF);
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == -EBADF);
+  CPPUNIT_ASSERT(ceph_posix_open(0, SMALL_LAYOUT "/missing", O_RDONLY, 0) == -ENOENT);
+}
+
+//------------------------------------------------------------------------------
+// Aio test
+//------------------------------------------------------------------------------
+void CephMemBackendTest::AioTest() {
+  std::string path = SMALL_LAYOUT "/aio";
+  std::vector<char> content = pattern(300000, 3);
+  int fd = ceph_posix_open(0, path.c_str(), O_WRONLY|O_CREAT, 0644);
+  CPPUNIT_ASSERT(fd >= 0);
+  // write in 3 asynchronous chunks
+  std::vector<TestAio*> aios;
+  for (size_t off = 0; off < content.size(); off += 100000) {
+    TestAio *aio = new TestAio(&content[off], 100000, off);
+    CPPUNIT_ASSERT(ceph_aio_write(fd, aio, testAioCallback) == 0);
+    aios.push_back(aio);
+  }
+  for (std::vector<TestAio*>::iterator it = aios.begin(); it != aios.end(); it++) {
+    (*it)->wait();
+    CPPUNIT_ASSERT((*it)->Result == 100000);
+    delete *it;
+  }
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  // read back asynchronously
+  fd = ceph_posix_open(0, path.c_str(), O_RDONLY, 0);
+  CPPUNIT_ASSERT(fd >= 0);
+  std::vector<char> data(content.size());
+  TestAio aio(&data[0], data.size(), 0);
+  CPPUNIT_ASSERT(ceph_aio_read(fd, &aio, testAioCallback) == 0);
+  aio.wait();
+  CPPUNIT_ASSERT(aio.Result == (ssize_t)content.size());
+  CPPUNIT_ASSERT(data == content);
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+}
+
+//------------------------------------------------------------------------------
+// Xattr test
+//------------------------------------------------------------------------------
+void CephMemBackendTest::XattrTest() {
+  std::string path = SMALL_LAYOUT "/xattr";
+  createFile(path, pattern(10, 1));
+  CPPUNIT_ASSERT(ceph_posix_setxattr(0, path.c_str(), "foo", "bar", 3, 0) == 0);
+  CPPUNIT_ASSERT(ceph_posix_setxattr(0, path.c_str(), "xy", "z", 1, 0) == 0);
+  char value[10];
+  CPPUNIT_ASSERT(ceph_posix_getxattr(0, path.c_str(), "foo", value, sizeof(value)) == 3);
+  CPPUNIT_ASSERT(!strncmp(value, "bar", 3));
+  // internal striper attributes are not listed
+  XrdSysXAttr::AList *aList = 0;
+  CPPUNIT_ASSERT(ceph_posix_listxattrs(0, path.c_str(), &aList, 1) == 0);
+  std::set<std::string> names;
+  while (aList) {
+    names.insert(std::string(aList->Name, aList->Nlen));
+    XrdSysXAttr::AList *cur = aList;
+    aList = aList->Next;
+    free(cur);
+  }
+  CPPUNIT_ASSERT(names.size() == 2);
+  CPPUNIT_ASSERT(names.count("foo") == 1);
+  CPPUNIT_ASSERT(ceph_posix_removexattr(0, path.c_str(), "foo") == 0);
+  CPPUNIT_ASSERT(ceph_posix_getxattr(0, path.c_str(), "foo", value, sizeof(value)) < 0);
+}
+
+//------------------------------------------------------------------------------
+// Truncate and unlink test
+//------------------------------------------------------------------------------
+void CephMemBackendTest::TruncateUnlinkTest() {
+  std::string path = SMALL_LAYOUT "/trunc";
+  std::vector<char> content = pattern(500000, 5);
+  createFile(path, content);
+  CPPUNIT_ASSERT(ceph_posix_truncate(0, path.c_str(), 70000) == 0);
+  struct stat buf;
+  CPPUNIT_ASSERT(ceph_posix_stat(0, path.c_str(), &buf) == 0);
+  CPPUNIT_ASSERT(buf.st_size == 70000);
+  // growing again must expose zeros, not the old content
+  CPPUNIT_ASSERT(ceph_posix_truncate(0, path.c_str(), 200000) == 0);
+  int fd = ceph_posix_open(0, path.c_str(), O_RDONLY, 0);
+  CPPUNIT_ASSERT(fd >= 0);
+  std::vector<char> data(200000);
+  CPPUNIT_ASSERT(ceph_posix_pread(fd, &data[0], data.size(), 0) == 200000);
+  CPPUNIT_ASSERT(!memcmp(&data[0], &content[0], 70000));
+  CPPUNIT_ASSERT(std::vector<char>(data.begin()+70000, data.end()) == std::vector<char>(130000, 0));
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  CPPUNIT_ASSERT(ceph_posix_unlink(0, path.c_str()) == 0);
+  CPPUNIT_ASSERT(ceph_posix_stat(0, path.c_str(), &buf) != 0);
+  // O_TRUNC recreates an existing file
+  createFile(path, content);
+  fd = ceph_posix_open(0, path.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
+  CPPUNIT_ASSERT(fd >= 0);
+  CPPUNIT_ASSERT(ceph_posix_stat(0, path.c_str(), &buf) == 0);
+  CPPUNIT_ASSERT(buf.st_size == 0);
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+}
+
+//------------------------------------------------------------------------------
+// Readdir test
+//------------------------------------------------------------------------------
+void CephMemBackendTest::ReaddirTest() {
+  createFile(SMALL_LAYOUT "/a", pattern(300000, 1));
+  createFile(SMALL_LAYOUT "/bc", pattern(10, 1));
+  createFile("other:/d", pattern(10, 1));
+  ceph_posix_disconnect_all();
+  DIR *dir = ceph_posix_opendir(0, SMALL_LAYOUT "/");
+  CPPUNIT_ASSERT(dir != 0);
+  // the layout of an open listing is never evicted, with its ioctxs
+  unsigned int maxLayouts = g_maxCephLayouts;
+  g_maxCephLayouts = 1;
+  XrdCephRegistryStats before, after;
+  ceph_posix_get_registry_stats(&before);
+  struct stat buf;
+  CPPUNIT_ASSERT(ceph_posix_stat(0, "other:/d", &buf) == 0);
+  ceph_posix_get_registry_stats(&after);
+  CPPUNIT_ASSERT(after.nbLayoutsEvicted == before.nbLayoutsEvicted);
+  CPPUNIT_ASSERT(after.nbLayoutEvictionsFailed > before.nbLayoutEvictionsFailed);
+  std::set<std::string> names;
+  char buff[256];
+  while (true) {
+    CPPUNIT_ASSERT(ceph_posix_readdir(dir, buff, sizeof(buff)) == 0);
+    if (0 == buff[0]) break;
+    names.insert(buff);
+  }
+  CPPUNIT_ASSERT(ceph_posix_closedir(dir) == 0);
+  ceph_posix_stat(0, "user@pool,1,65536,65536:/e", &buf);
+  ceph_posix_get_registry_stats(&after);
+  CPPUNIT_ASSERT(after.nbLayoutsEvicted > before.nbLayoutsEvicted);
+  g_maxCephLayouts = maxLayouts;
+  CPPUNIT_ASSERT(names.size() == 2);
+  CPPUNIT_ASSERT(names.count("/a") == 1);
+  CPPUNIT_ASSERT(names.count("/bc") == 1);
+  long long total, free;
+  CPPUNIT_ASSERT(ceph_posix_statfs(&total, &free) == 0);
+  CPPUNIT_ASSERT(total > 0 && free <= total);
+}
+
+//------------------------------------------------------------------------------
+// File descriptor table test
+//------------------------------------------------------------------------------
+static void* openFiles(void *arg) {
+  std::vector<int> &fds = *(std::vector<int>*)arg;
+  for (unsigned int i = 0; i < fds.size(); i++) {
+    fds[i] = ceph_posix_open(0, SMALL_LAYOUT "/fdtable", O_RDONLY, 0);
+  }
+  return 0;
+}
+
+void CephMemBackendTest::FileDescriptorTest() {
+  std::string path = SMALL_LAYOUT "/fdtable";
+  createFile(path, pattern(1000, 6));
+  // descriptors are recycled and closed ones are invalid
+  int fd = ceph_posix_open(0, path.c_str(), O_RDONLY, 0);
+  CPPUNIT_ASSERT(fd >= 0);
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == -EBADF);
+  struct stat buf;
+  CPPUNIT_ASSERT(ceph_posix_fstat(fd, &buf) == -EBADF);
+  int fd2 = ceph_posix_open(0, path.c_str(), O_RDONLY, 0);
+  CPPUNIT_ASSERT(fd2 == fd);
+  CPPUNIT_ASSERT(ceph_posix_fstat(fd2, &buf) == 0);
+  CPPUNIT_ASSERT(buf.st_size == 1000);
+  // handles give the same view without the descriptor lookup
+  CephFileRef *fh = ceph_posix_get_handle(fd2);
+  CPPUNIT_ASSERT(fh != 0);
+  CPPUNIT_ASSERT(ceph_posix_fh_fstat(fh, &buf) == 0);
+  CPPUNIT_ASSERT(buf.st_size == 1000);
+  std::vector<char> data(1000);
+  CPPUNIT_ASSERT(ceph_posix_fh_pread(fh, &data[0], 1000, 0) == 1000);
+  CPPUNIT_ASSERT(data == pattern(1000, 6));
+  CPPUNIT_ASSERT(ceph_posix_fh_pwrite(fh, &data[0], 1000, 0) == -EBADF);
+  CPPUNIT_ASSERT(ceph_posix_close(fd2) == 0);
+  CPPUNIT_ASSERT(ceph_posix_get_handle(fd2) == 0);
+  CPPUNIT_ASSERT(ceph_posix_fstat(-1, &buf) == -EBADF);
+  CPPUNIT_ASSERT(ceph_posix_fstat(1 << 30, &buf) == -EBADF);
+  // concurrent opens get distinct descriptors and the table stays dense
+  const unsigned int nbThreads = 8, nbFiles = 200;
+  std::vector<std::vector<int> > fds(nbThreads, std::vector<int>(nbFiles));
+  std::vector<pthread_t> tids(nbThreads);
+  for (unsigned int t = 0; t < nbThreads; t++) {
+    CPPUNIT_ASSERT(XrdSysThread::Run(&tids[t], openFiles, &fds[t], XRDSYSTHREAD_HOLD) == 0);
+  }
+  for (unsigned int t = 0; t < nbThreads; t++) {
+    XrdSysThread::Join(tids[t], 0);
+  }
+  std::vector<int> all;
+  for (unsigned int t = 0; t < nbThreads; t++) {
+    all.insert(all.end(), fds[t].begin(), fds[t].end());
+  }
+  std::sort(all.begin(), all.end());
+  CPPUNIT_ASSERT(all.front() >= 0);
+  CPPUNIT_ASSERT(std::unique(all.begin(), all.end()) == all.end());
+  CPPUNIT_ASSERT(all.back() < (int)(nbThreads * nbFiles + 16));
+  for (unsigned int i = 0; i < all.size(); i++) {
+    CPPUNIT_ASSERT(ceph_posix_close(all[i]) == 0);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Many layouts test
+//------------------------------------------------------------------------------
+void CephMemBackendTest::LayoutsTest() {
+  // enough pools and layouts to grow the registry several times
+  std::vector<std::string> paths;
+  for (unsigned int i = 0; i < 40; i++) {
+    char path[128];
+    snprintf(path, sizeof(path), "user@pool%u,%u,65536,%u:/layout%u", i % 5, 1 + i % 4, 65536 * (1 + i / 8), i);
+    paths.push_back(path);
+    createFile(path, pattern(200000, i));
+  }
+  for (unsigned int i = 0; i < paths.size(); i++) {
+    struct stat buf;
+    CPPUNIT_ASSERT(ceph_posix_stat(0, paths[i].c_str(), &buf) == 0);
+    CPPUNIT_ASSERT(buf.st_size == 200000);
+    int fd = ceph_posix_open(0, paths[i].c_str(), O_RDONLY, 0);
+    CPPUNIT_ASSERT(fd >= 0);
+    std::vector<char> data(200000);
+    CPPUNIT_ASSERT(ceph_posix_pread(fd, &data[0], data.size(), 0) == 200000);
+    CPPUNIT_ASSERT(data == pattern(200000, i));
+    CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  }
+  // ioctxs are shared by the layouts of a pool
+  XrdCephRegistryStats stats;
+  ceph_posix_get_registry_stats(&stats);
+  CPPUNIT_ASSERT(stats.nbPools == 5);
+  CPPUNIT_ASSERT(stats.nbLayouts == 40);
+  CPPUNIT_ASSERT(stats.nbIoCtxs == 5 * stats.nbConnections);
+  // and a fresh start after a disconnection
+  ceph_posix_disconnect_all();
+  struct stat buf;
+  CPPUNIT_ASSERT(ceph_posix_stat(0, paths[7].c_str(), &buf) == 0);
+  // stripers are evicted beyond the limit, but never the ones of open files
+  unsigned int maxStripers = g_maxCephStripers;
+  g_maxCephStripers = 3;
+  int fd = ceph_posix_open(0, paths[0].c_str(), O_RDONLY, 0);
+  CPPUNIT_ASSERT(fd >= 0);
+  for (unsigned int i = 1; i < paths.size(); i++) {
+    CPPUNIT_ASSERT(ceph_posix_stat(0, paths[i].c_str(), &buf) == 0);
+  }
+  ceph_posix_get_registry_stats(&stats);
+  CPPUNIT_ASSERT(stats.nbStripers <= 3 * stats.nbConnections);
+  CPPUNIT_ASSERT(stats.nbStripersEvicted > 0);
+  std::vector<char> data(200000);
+  CPPUNIT_ASSERT(ceph_posix_pread(fd, &data[0], data.size(), 0) == 200000);
+  CPPUNIT_ASSERT(data == pattern(200000, 0));
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  g_maxCephStripers = maxStripers;
+  // so are layouts, with their pool when it is the last one, but never the ones of open files
+  ceph_posix_disconnect_all();
+  unsigned int maxLayouts = g_maxCephLayouts;
+  g_maxCephLayouts = 4;
+  fd = ceph_posix_open(0, paths[1].c_str(), O_RDONLY, 0);
+  CPPUNIT_ASSERT(fd >= 0);
+  for (unsigned int i = 0; i < paths.size(); i++) {
+    CPPUNIT_ASSERT(ceph_posix_stat(0, paths[i].c_str(), &buf) == 0);
+  }
+  ceph_posix_get_registry_stats(&stats);
+  CPPUNIT_ASSERT(stats.nbLayouts <= 4);
+  CPPUNIT_ASSERT(stats.nbLayoutsEvicted > 0);
+  CPPUNIT_ASSERT(stats.nbPools <= 4);
+  CPPUNIT_ASSERT(ceph_posix_pread(fd, &data[0], data.size(), 0) == 200000);
+  CPPUNIT_ASSERT(data == pattern(200000, 1));
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  g_maxCephLayouts = maxLayouts;
+}
+
+//------------------------------------------------------------------------------
+// Connection selection test
+//------------------------------------------------------------------------------
+void CephMemBackendTest::ConnectionPolicyTest() {
+  // the least loaded connection wins, in flight bytes adding to the load
+  XrdCephRegistry registry;
+  registry.init(4);
+  for (unsigned int i = 0; i < 100; i++) registry.opStarted(0, 0);
+  for (unsigned int i = 0; i < 10; i++) registry.opStarted(1, 0);
+  registry.opStarted(2, 64 * CEPH_CONN_BYTES_PER_OP);
+  CPPUNIT_ASSERT(registry.pickConnection(CEPH_CONN_LEAST_OUTSTANDING) == 3);
+  // power of two choices never picks the most loaded connection
+  unsigned int counts[4] = {0, 0, 0, 0};
+  for (unsigned int i = 0; i < 1200; i++) {
+    counts[registry.pickConnection(CEPH_CONN_POWER_OF_TWO)]++;
+  }
+  CPPUNIT_ASSERT(counts[0] == 0);
+  CPPUNIT_ASSERT(counts[3] > counts[1] && counts[1] > counts[2]);
+  registry.opDone(2, 64 * CEPH_CONN_BYTES_PER_OP);
+  CPPUNIT_ASSERT(registry.load(2).score() == 0);
+  CPPUNIT_ASSERT(registry.load(2).totalBytes == 64ull * CEPH_CONN_BYTES_PER_OP);
+  // idle connections share the calls evenly, which leave nothing in flight
+  unsigned int nbConnections = g_maxCephPoolIdx;
+  XrdCephConnectionPolicy policy = g_cephConnectionPolicy;
+  g_maxCephPoolIdx = 4;
+  g_cephConnectionPolicy = CEPH_CONN_LEAST_OUTSTANDING;
+  createFile("/policy", pattern(1000, 0));
+  ceph_posix_disconnect_all();
+  for (unsigned int i = 0; i < 40; i++) {
+    struct stat buf;
+    CPPUNIT_ASSERT(ceph_posix_stat(0, "/policy", &buf) == 0);
+  }
+  for (unsigned int i = 0; i < 4; i++) {
+    XrdCephConnectionStats stats;
+    CPPUNIT_ASSERT(ceph_posix_get_connection_stats(i, &stats) == 0);
+    CPPUNIT_ASSERT(stats.totalOps == 10);
+    CPPUNIT_ASSERT(stats.inflightOps == 0 && stats.inflightBytes == 0);
+  }
+  XrdCephConnectionStats stats;
+  CPPUNIT_ASSERT(ceph_posix_get_connection_stats(4, &stats) == -EINVAL);
+  g_maxCephPoolIdx = nbConnections;
+  g_cephConnectionPolicy = policy;
+}
+
+//------------------------------------------------------------------------------
+// Cpu affinity test
+//------------------------------------------------------------------------------
+void CephMemBackendTest::AffinityTest() {
+  // connections of a group are group, group + nbGroups, ...
+  XrdCephRegistry registry;
+  registry.init(6);
+  for (unsigned int i = 0; i < 10; i++) {
+    CPPUNIT_ASSERT(registry.pickConnection(CEPH_CONN_ROUND_ROBIN, 0, 0, 1, 3) % 3 == 1);
+    CPPUNIT_ASSERT(registry.pickConnection(CEPH_CONN_POWER_OF_TWO, 0, 0, 2, 3) % 3 == 2);
+  }
+  // two fake NUMA nodes made of the cpus we may run on
+  cpu_set_t allowed;
+  CPPUNIT_ASSERT(sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+  std::vector<unsigned int> cpus;
+  for (unsigned int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+  }
+  std::vector<std::vector<unsigned int> > nodes(2);
+  for (unsigned int i = 0; i < cpus.size(); i++) {
+    nodes[i < (cpus.size() + 1) / 2 ? 0 : 1].push_back(cpus[i]);
+  }
+  unsigned int nbNodes = nodes[1].empty() ? 1 : 2;
+  XrdCephAffinity affinity;
+  affinity.init(CEPH_AFFINITY_NUMA, 4, nodes);
+  CPPUNIT_ASSERT(affinity.nbGroups() == nbNodes);
+  CPPUNIT_ASSERT(affinity.groupOfCpu(nodes[0][0]) == 0);
+  if (nbNodes > 1) CPPUNIT_ASSERT(affinity.groupOfCpu(nodes[1][0]) == 1);
+  cpu_set_t set;
+  CPPUNIT_ASSERT(affinity.cpus(2, set));
+  CPPUNIT_ASSERT(CPU_COUNT(&set) == (int)nodes[0].size());
+  // one group per cpu, capped to the number of connections
+  affinity.init(CEPH_AFFINITY_CPU, 2, nodes);
+  CPPUNIT_ASSERT(affinity.nbGroups() == std::min<size_t>(2, cpus.size()));
+  affinity.init(CEPH_AFFINITY_NONE, 4, nodes);
+  CPPUNIT_ASSERT(affinity.nbGroups() == 1);
+  CPPUNIT_ASSERT(!affinity.cpus(0, set));
+  // files keep working with connections bound to the cpus
+  unsigned int nbConnections = g_maxCephPoolIdx;
+  g_maxCephPoolIdx = 4;
+  g_cephAffinityMode = CEPH_AFFINITY_CPU;
+  createFile("/affinity", pattern(1000, 1));
+  std::vector<char> data(1000);
+  int fd = ceph_posix_open(0, "/affinity", O_RDONLY, 0);
+  CPPUNIT_ASSERT(fd >= 0);
+  CPPUNIT_ASSERT(ceph_posix_pread(fd, &data[0], data.size(), 0) == 1000);
+  CPPUNIT_ASSERT(data == pattern(1000, 1));
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  g_maxCephPoolIdx = nbConnections;
+  g_cephAffinityMode = CEPH_AFFINITY_NONE;
+}
+
+//------------------------------------------------------------------------------
+// Connection classes test
+//------------------------------------------------------------------------------
+void CephMemBackendTest::ConnectionClassTest() {
+  // connections are 0 shared by reads and bulk, 1-2 for writes, 3 for metadata
+  ceph_posix_disconnect_all();
+  g_cephClassNbConnections[CEPH_CLASS_WRITE] = 2;
+  g_cephClassNbConnections[CEPH_CLASS_METADATA] = 1;
+  createFile("/classes", pattern(1000, 2));
+  for (unsigned int i = 0; i < 5; i++) {
+    struct stat buf;
+    CPPUNIT_ASSERT(ceph_posix_stat(0, "/classes", &buf) == 0);
+  }
+  std::vector<char> data(1000);
+  int fd = ceph_posix_open(0, "/classes", O_RDONLY, 0);
+  CPPUNIT_ASSERT(fd >= 0);
+  CPPUNIT_ASSERT(ceph_posix_pread(fd, &data[0], data.size(), 0) == 1000);
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  XrdCephRegistryStats registryStats;
+  ceph_posix_get_registry_stats(&registryStats);
+  CPPUNIT_ASSERT(registryStats.nbConnections == 4);
+  XrdCephConnectionStats stats[4];
+  for (unsigned int i = 0; i < 4; i++) {
+    CPPUNIT_ASSERT(ceph_posix_get_connection_stats(i, &stats[i]) == 0);
+  }
+  // open and pread, open and pwrite, then the stats
+  CPPUNIT_ASSERT(stats[0].totalOps == 2 && stats[0].totalBytes == 1000);
+  CPPUNIT_ASSERT(stats[1].totalOps + stats[2].totalOps == 2);
+  CPPUNIT_ASSERT(stats[1].totalBytes + stats[2].totalBytes == 1000);
+  CPPUNIT_ASSERT(stats[3].totalOps == 5 && stats[3].totalBytes == 0);
+  g_cephClassNbConnections[CEPH_CLASS_WRITE] = 0;
+  g_cephClassNbConnections[CEPH_CLASS_METADATA] = 0;
+}
+
+//------------------------------------------------------------------------------
+// Preconnection test
+//------------------------------------------------------------------------------
+void CephMemBackendTest::PreconnectTest() {
+  CPPUNIT_ASSERT(ceph_posix_preconnect("pool1,abc") == -EINVAL);
+  unsigned int nbConnections = g_maxCephPoolIdx;
+  g_maxCephPoolIdx = 3;
+  CPPUNIT_ASSERT(ceph_posix_preconnect("pool1 user@pool2,2,65536,131072") == 0);
+  XrdCephRegistryStats stats;
+  ceph_posix_get_registry_stats(&stats);
+  CPPUNIT_ASSERT(stats.nbConnections == 3);
+  CPPUNIT_ASSERT(stats.nbPools == 2);
+  CPPUNIT_ASSERT(stats.nbLayouts == 2);
+  CPPUNIT_ASSERT(stats.nbIoCtxs == 6);
+  CPPUNIT_ASSERT(stats.nbStripers == 6);
+  // nothing more is needed by files of these layouts
+  unsigned long long nbCreated = stats.nbStripersCreated;
+  createFile("user@pool2,2,65536,131072:/preconnect", pattern(1000, 3));
+  ceph_posix_get_registry_stats(&stats);
+  CPPUNIT_ASSERT(stats.nbStripers == 6 && stats.nbStripersCreated == nbCreated);
+  // and preconnecting again is harmless
+  CPPUNIT_ASSERT(ceph_posix_preconnect("pool1") == 0);
+  ceph_posix_get_registry_stats(&stats);
+  CPPUNIT_ASSERT(stats.nbStripers == 6);
+  g_maxCephPoolIdx = nbConnections;
+}
+
+//------------------------------------------------------------------------------
+// Multi cluster routing test
+//------------------------------------------------------------------------------
+void CephMemBackendTest::ClusterRoutingTest() {
+  // connection 0 is the default cluster, 1-2 serve pool hot
+  ceph_posix_disconnect_all();
+  CPPUNIT_ASSERT(ceph_posix_add_cluster("fast", "", "", 2, "") == -EINVAL);
+  CPPUNIT_ASSERT(ceph_posix_add_cluster("fast", "", "", 2, "hot") == 0);
+  CPPUNIT_ASSERT(ceph_posix_add_cluster("fast", "", "", 1, "other") == -EEXIST);
+  CPPUNIT_ASSERT(ceph_posix_add_cluster("slow", "", "", 1, "cold,hot") == -EEXIST);
+  createFile("hot:/routed", pattern(1000, 4));
+  createFile("/notrouted", pattern(500, 5));
+  XrdCephRegistryStats registryStats;
+  ceph_posix_get_registry_stats(&registryStats);
+  CPPUNIT_ASSERT(registryStats.nbConnections == 3);
+  XrdCephConnectionStats stats[3];
+  for (unsigned int i = 0; i < 3; i++) {
+    CPPUNIT_ASSERT(ceph_posix_get_connection_stats(i, &stats[i]) == 0);
+  }
+  CPPUNIT_ASSERT(stats[0].totalBytes == 500);
+  CPPUNIT_ASSERT(stats[1].totalBytes + stats[2].totalBytes == 1000);
+  // no cluster can be declared once connected
+  CPPUNIT_ASSERT(ceph_posix_add_cluster("late", "", "", 1, "late") == -EBUSY);
+  long long total, free;
+  CPPUNIT_ASSERT(ceph_posix_statfs(&total, &free) == 0);
+  ceph_posix_disconnect_all();
+  ceph_posix_clear_clusters();
+}
+
+//------------------------------------------------------------------------------
+// librados options test
+//------------------------------------------------------------------------------
+void CephMemBackendTest::OptionTest() {
+  // connection 0 is shared, 1 is dedicated to writes
+  ceph_posix_disconnect_all();
+  g_cephClassNbConnections[CEPH_CLASS_WRITE] = 1;
+  CPPUNIT_ASSERT(ceph_posix_add_option("objecter_inflight_ops", "", -1) == -EINVAL);
+  CPPUNIT_ASSERT(ceph_posix_add_option("objecter_inflight_ops", "2048", CEPH_NB_CONNECTION_CLASSES) == -EINVAL);
+  CPPUNIT_ASSERT(ceph_posix_add_option("objecter_inflight_ops", "1024", -1) == 0);
+  CPPUNIT_ASSERT(ceph_posix_add_option("objecter_inflight_ops", "2048", -1) == 0);
+  CPPUNIT_ASSERT(ceph_posix_add_option("ms_async_op_threads", "3", -1) == 0);
+  CPPUNIT_ASSERT(ceph_posix_add_option("ms_async_op_threads", "5", CEPH_CLASS_WRITE) == 0);
+  createFile("/options", pattern(100, 6));
+  struct stat buf;
+  CPPUNIT_ASSERT(ceph_posix_stat(0, "/options", &buf) == 0);
+  char value[16];
+  CPPUNIT_ASSERT(ceph_posix_get_connection_option(0, "objecter_inflight_ops", value, sizeof(value)) == 0);
+  CPPUNIT_ASSERT(std::string(value) == "2048");
+  CPPUNIT_ASSERT(ceph_posix_get_connection_option(0, "ms_async_op_threads", value, sizeof(value)) == 0);
+  CPPUNIT_ASSERT(std::string(value) == "3");
+  CPPUNIT_ASSERT(ceph_posix_get_connection_option(1, "ms_async_op_threads", value, sizeof(value)) == 0);
+  CPPUNIT_ASSERT(std::string(value) == "5");
+  CPPUNIT_ASSERT(ceph_posix_get_connection_option(1, "objecter_inflight_ops", value, 4) == -ERANGE);
+  CPPUNIT_ASSERT(ceph_posix_get_connection_option(0, "rados_osd_op_timeout", value, sizeof(value)) == -ENOENT);
+  CPPUNIT_ASSERT(ceph_posix_get_connection_option(2, "ms_async_op_threads", value, sizeof(value)) == -EINVAL);
+  // no option can be given once connected
+  CPPUNIT_ASSERT(ceph_posix_add_option("rados_osd_op_timeout", "30", -1) == -EBUSY);
+  ceph_posix_disconnect_all();
+  ceph_posix_clear_options();
+  g_cephClassNbConnections[CEPH_CLASS_WRITE] = 0;
+}
+
+//------------------------------------------------------------------------------
+// Vectored read test
+//------------------------------------------------------------------------------
+void CephMemBackendTest::ReadVTest() {
+  std::string path = SMALL_LAYOUT "/readv";
+  std::vector<char> content = pattern(1000000, 8);
+  createFile(path, content);
+  int fd = ceph_posix_open(0, path.c_str(), O_RDONLY, 0);
+  CPPUNIT_ASSERT(fd >= 0);
+  CephFileRef *fh = ceph_posix_get_handle(fd);
+  // scattered, unordered, close and overlapping segments crossing stripe units
+  // and objects, up to the end of the file
+  long long offsets[] = {500000, 0, 100, 65000, 70000, 131000, 262100, 990000, 300, 999999};
+  int sizes[] = {70000, 50, 200, 2000, 100, 150000, 100, 10000, 1000, 1};
+  const int n = sizeof(offsets) / sizeof(long long);
+  std::vector<std::vector<char> > data(n);
+  XrdOucIOVec readV[n];
+  for (int i = 0; i < n; i++) {
+    data[i].resize(sizes[i]);
+    readV[i].offset = offsets[i];
+    readV[i].size = sizes[i];
+    readV[i].info = 0;
+    readV[i].data = &data[i][0];
+  }
+  CPPUNIT_ASSERT(ceph_posix_fh_readv(fh, readV, n) == 233451);
+  for (int i = 0; i < n; i++) {
+    CPPUNIT_ASSERT(!memcmp(&data[i][0], &content[offsets[i]], sizes[i]));
+  }
+  // segments beyond the end of the file
+  readV[1].offset = 999990;
+  CPPUNIT_ASSERT(ceph_posix_fh_readv(fh, readV, n) == -ESPIPE);
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  // holes of sparse files read as zeros
+  path = SMALL_LAYOUT "/readvsparse";
+  fd = ceph_posix_open(0, path.c_str(), O_WRONLY|O_CREAT, 0644);
+  CPPUNIT_ASSERT(fd >= 0);
+  CPPUNIT_ASSERT(ceph_posix_pwrite(fd, &content[0], 1000, 600000) == 1000);
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  fd = ceph_posix_open(0, path.c_str(), O_RDONLY, 0);
+  CPPUNIT_ASSERT(fd >= 0);
+  fh = ceph_posix_get_handle(fd);
+  std::vector<char> hole(300000, 1);
+  std::vector<char> tail(1100, 1);
+  XrdOucIOVec sparseV[2] = {{0, 300000, 0, &hole[0]}, {599900, 1100, 0, &tail[0]}};
+  CPPUNIT_ASSERT(ceph_posix_fh_readv(fh, sparseV, 2) == 301100);
+  CPPUNIT_ASSERT(hole == std::vector<char>(300000, 0));
+  CPPUNIT_ASSERT(std::count(tail.begin(), tail.begin() + 100, 0) == 100);
+  CPPUNIT_ASSERT(!memcmp(&tail[100], &content[0], 1000));
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  // files being written are read through the striper, seeing their new size
+  path = SMALL_LAYOUT "/readvwrite";
+  int wfd = ceph_posix_open(0, path.c_str(), O_WRONLY|O_CREAT, 0644);
+  CPPUNIT_ASSERT(wfd >= 0);
+  CPPUNIT_ASSERT(ceph_posix_pwrite(wfd, &content[0], 1000, 0) == 1000);
+  fd = ceph_posix_open(0, path.c_str(), O_RDONLY, 0);
+  CPPUNIT_ASSERT(fd >= 0);
+  fh = ceph_posix_get_handle(fd);
+  CPPUNIT_ASSERT(ceph_posix_pwrite(wfd, &content[1000], 299000, 1000) == 299000);
+  XrdOucIOVec writtenV[2] = {{200000, 1100, 0, &tail[0]}, {500, 300000, 0, &hole[0]}};
+  CPPUNIT_ASSERT(ceph_posix_fh_readv(fh, writtenV, 2) == -ESPIPE);
+  writtenV[1].size = 299500;
+  CPPUNIT_ASSERT(ceph_posix_fh_readv(fh, writtenV, 2) == 300600);
+  CPPUNIT_ASSERT(!memcmp(&tail[0], &content[200000], 1100));
+  CPPUNIT_ASSERT(!memcmp(&hole[0], &content[500], 299500));
+  CPPUNIT_ASSERT(ceph_posix_close(wfd) == 0);
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+}
+
+//------------------------------------------------------------------------------
+// Vectored write test
+//------------------------------------------------------------------------------
+void CephMemBackendTest::WriteVTest() {
+  std::string path = SMALL_LAYOUT "/writev";
+  std::vector<char> content = pattern(600000, 9);
+  int fd = ceph_posix_open(0, path.c_str(), O_WRONLY|O_CREAT, 0644);
+  CPPUNIT_ASSERT(fd >= 0);
+  CephFileRef *fh = ceph_posix_get_handle(fd);
+  // unordered segments, some contiguous, crossing stripe units and objects
+  long long offsets[] = {400000, 0, 65000, 100, 300000, 65536, 500000};
+  int sizes[] = {100000, 100, 536, 64900, 100000, 234464, 100000};
+  const int n = sizeof(offsets) / sizeof(long long);
+  XrdOucIOVec writeV[n];
+  for (int i = 0; i < n; i++) {
+    writeV[i].offset = offsets[i];
+    writeV[i].size = sizes[i];
+    writeV[i].info = 0;
+    writeV[i].data = &content[offsets[i]];
+  }
+  CPPUNIT_ASSERT(ceph_posix_fh_writev(fh, writeV, n) == 600000);
+  // overlapping segments are written in order
+  std::vector<char> ones(1000, 1);
+  std::vector<char> twos(1000, 2);
+  XrdOucIOVec overlapV[2] = {{550000, 1000, 0, &ones[0]}, {549500, 1000, 0, &twos[0]}};
+  CPPUNIT_ASSERT(ceph_posix_fh_writev(fh, overlapV, 2) == 2000);
+  memset(&content[549500], 2, 1000);
+  memset(&content[550500], 1, 500);
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  fd = ceph_posix_open(0, path.c_str(), O_RDONLY, 0);
+  CPPUNIT_ASSERT(fd >= 0);
+  std::vector<char> data(content.size());
+  CPPUNIT_ASSERT(ceph_posix_pread(fd, &data[0], data.size(), 0) == (ssize_t)content.size());
+  CPPUNIT_ASSERT(data == content);
+  CPPUNIT_ASSERT(ceph_posix_fh_writev(ceph_posix_get_handle(fd), writeV, n) == -EBADF);
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+}
+
+//------------------------------------------------------------------------------
+// Split reads test
+//------------------------------------------------------------------------------
+void CephMemBackendTest::SplitReadTest() {
+  // pieces of 2 stripes of the small layout, spread over 4 connections
+  unsigned int nbConnections = g_maxCephPoolIdx;
+  XrdCephConnectionPolicy policy = g_cephConnectionPolicy;
+  g_maxCephPoolIdx = 4;
+  g_cephConnectionPolicy = CEPH_CONN_ROUND_ROBIN;
+  g_cephReadSplitSize = 200000;
+  std::string path = SMALL_LAYOUT "/split";
+  std::vector<char> content = pattern(1000000, 10);
+  createFile(path, content);
+  int fd = ceph_posix_open(0, path.c_str(), O_RDONLY, 0);
+  CPPUNIT_ASSERT(fd >= 0);
+  unsigned long long opsBefore[4];
+  for (unsigned int i = 0; i < 4; i++) {
+    XrdCephConnectionStats stats;
+    CPPUNIT_ASSERT(ceph_posix_get_connection_stats(i, &stats) == 0);
+    opsBefore[i] = stats.totalOps;
+  }
+  // whole file, unaligned, and going beyond the end of the file
+  std::vector<char> data(content.size());
+  CPPUNIT_ASSERT(ceph_posix_pread(fd, &data[0], data.size(), 0) == (ssize_t)content.size());
+  CPPUNIT_ASSERT(data == content);
+  CPPUNIT_ASSERT(ceph_posix_pread(fd, &data[0], 500000, 100000) == 500000);
+  CPPUNIT_ASSERT(!memcmp(&data[0], &content[100000], 500000));
+  CPPUNIT_ASSERT(ceph_posix_pread(fd, &data[0], 600000, 700000) == 300000);
+  CPPUNIT_ASSERT(!memcmp(&data[0], &content[700000], 300000));
+  CPPUNIT_ASSERT(ceph_posix_pread(fd, &data[0], 300000, 1000000) == 0);
+  // and read, moving the offset
+  CPPUNIT_ASSERT(ceph_posix_lseek(fd, 400000, SEEK_SET) == 400000);
+  CPPUNIT_ASSERT(ceph_posix_read(fd, &data[0], 500000) == 500000);
+  CPPUNIT_ASSERT(!memcmp(&data[0], &content[400000], 500000));
+  CPPUNIT_ASSERT(ceph_posix_read(fd, &data[0], 500000) == 100000);
+  CPPUNIT_ASSERT(!memcmp(&data[0], &content[900000], 100000));
+  // the pieces went to all connections, and none is left in flight
+  for (unsigned int i = 0; i < 4; i++) {
+    XrdCephConnectionStats stats;
+    CPPUNIT_ASSERT(ceph_posix_get_connection_stats(i, &stats) == 0);
+    CPPUNIT_ASSERT(stats.totalOps > opsBefore[i]);
+    CPPUNIT_ASSERT(stats.inflightOps == 0 && stats.inflightBytes == 0);
+  }
+  // asynchronous reads
+  std::fill(data.begin(), data.end(), 0);
+  TestAio aio(&data[0], data.size(), 0);
+  CPPUNIT_ASSERT(ceph_aio_read(fd, &aio, testAioCallback) == 0);
+  aio.wait();
+  CPPUNIT_ASSERT(aio.Result == (ssize_t)content.size());
+  CPPUNIT_ASSERT(data == content);
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  g_cephReadSplitSize = 0;
+  g_maxCephPoolIdx = nbConnections;
+  g_cephConnectionPolicy = policy;
+}
+
+//------------------------------------------------------------------------------
+// Split writes test
+//------------------------------------------------------------------------------
+void CephMemBackendTest::SplitWriteTest() {
+  // pieces of 2 stripes of the small layout, spread over 4 connections
+  unsigned int nbConnections = g_maxCephPoolIdx;
+  XrdCephConnectionPolicy policy = g_cephConnectionPolicy;
+  g_maxCephPoolIdx = 4;
+  g_cephConnectionPolicy = CEPH_CONN_ROUND_ROBIN;
+  g_cephWriteSplitSize = 200000;
+  std::string path = SMALL_LAYOUT "/splitwrite";
+  std::vector<char> content = pattern(1000000, 11);
+  int fd = ceph_posix_open(0, path.c_str(), O_WRONLY|O_CREAT, 0644);
+  CPPUNIT_ASSERT(fd >= 0);
+  // unaligned synchronous write, then asynchronous ones
+  CPPUNIT_ASSERT(ceph_posix_pwrite(fd, &content[0], 300000, 0) == 300000);
+  TestAio aio1(&content[300000], 400000, 300000);
+  TestAio aio2(&content[700000], 300000, 700000);
+  CPPUNIT_ASSERT(ceph_aio_write(fd, &aio1, testAioCallback) == 0);
+  CPPUNIT_ASSERT(ceph_aio_write(fd, &aio2, testAioCallback) == 0);
+  aio1.wait();
+  aio2.wait();
+  CPPUNIT_ASSERT(aio1.Result == 400000);
+  CPPUNIT_ASSERT(aio2.Result == 300000);
+  struct stat buf;
+  CPPUNIT_ASSERT(ceph_posix_fstat(fd, &buf) == 0);
+  CPPUNIT_ASSERT(buf.st_size == (off_t)content.size());
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  // none is left in flight
+  for (unsigned int i = 0; i < 4; i++) {
+    XrdCephConnectionStats stats;
+    CPPUNIT_ASSERT(ceph_posix_get_connection_stats(i, &stats) == 0);
+    CPPUNIT_ASSERT(stats.totalOps > 0);
+    CPPUNIT_ASSERT(stats.inflightOps == 0 && stats.inflightBytes == 0);
+  }
+  fd = ceph_posix_open(0, path.c_str(), O_RDONLY, 0);
+  CPPUNIT_ASSERT(fd >= 0);
+  std::vector<char> data(content.size());
+  CPPUNIT_ASSERT(ceph_posix_pread(fd, &data[0], data.size(), 0) == (ssize_t)content.size());
+  CPPUNIT_ASSERT(data == content);
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  g_cephWriteSplitSize = 0;
+  g_maxCephPoolIdx = nbConnections;
+  g_cephConnectionPolicy = policy;
+}
+
+//------------------------------------------------------------------------------
+// Direct reads test
+//------------------------------------------------------------------------------
+void CephMemBackendTest::DirectReadTest() {
+  // object extents of power of two layouts and others, checked byte per byte
+  unsigned int layouts[][3] = {{2, 65536, 131072}, {3, 65536, 196608}, {4, 65536, 4194304}};
+  for (unsigned int l = 0; l < 3; l++) {
+    unsigned int nbStripes = layouts[l][0], su = layouts[l][1], spo = layouts[l][2] / su;
+    std::vector<CephObjectExtent> extents;
+    ceph_file_to_extents(nbStripes, su, layouts[l][2], 100000, 1000000, extents);
+    size_t total = 0;
+    for (unsigned int i = 0; i < extents.size(); i++) {
+      CPPUNIT_ASSERT(extents[i].bufferOffset == total);
+      for (size_t b = 0; b < extents[i].length; b += 997) {
+        unsigned long long off = 100000 + total + b, blockNo = off / su, stripeNo = blockNo / nbStripes;
+        CPPUNIT_ASSERT(extents[i].objectNo == (stripeNo / spo) * nbStripes + blockNo % nbStripes);
+        CPPUNIT_ASSERT(extents[i].offset + b == (stripeNo % spo) * su + off % su);
+      }
+      total += extents[i].length;
+    }
+    CPPUNIT_ASSERT(total == 1000000);
+  }
+  g_cephDirectRead = true;
+  // a power of two layout and one with 3 stripes and 3 stripe units per object
+  const char* paths[] = {SMALL_LAYOUT "/direct", "user@pool,3,65536,196608:/direct3"};
+  std::vector<char> content = pattern(1000000, 12);
+  for (unsigned int l = 0; l < 2; l++) {
+    createFile(paths[l], content);
+    int fd = ceph_posix_open(0, paths[l], O_RDONLY, 0);
+    CPPUNIT_ASSERT(fd >= 0);
+    // reads crossing stripe units and objects boundaries, and the end of the file
+    size_t offsets[] = {0, 65000, 131000, 262144, 500000, 999000, 1000000};
+    for (unsigned int i = 0; i < sizeof(offsets)/sizeof(size_t); i++) {
+      std::vector<char> data(300000);
+      ssize_t rc = ceph_posix_pread(fd, &data[0], data.size(), offsets[i]);
+      size_t expected = std::min(data.size(), content.size() - offsets[i]);
+      CPPUNIT_ASSERT(rc == (ssize_t)expected);
+      CPPUNIT_ASSERT(!memcmp(&data[0], &content[offsets[i]], expected));
+    }
+    std::vector<char> data(content.size() + 1000);
+    TestAio aio(&data[0], data.size(), 0);
+    CPPUNIT_ASSERT(ceph_aio_read(fd, &aio, testAioCallback) == 0);
+    aio.wait();
+    CPPUNIT_ASSERT(aio.Result == (ssize_t)content.size());
+    CPPUNIT_ASSERT(!memcmp(&data[0], &content[0], content.size()));
+    XrdOucIOVec readV[2] = {{900000, 1000, 0, &data[0]}, {10, 200000, 0, &data[1000]}};
+    CPPUNIT_ASSERT(ceph_posix_fh_readv(ceph_posix_get_handle(fd), readV, 2) == 201000);
+    CPPUNIT_ASSERT(!memcmp(&data[0], &content[900000], 1000));
+    CPPUNIT_ASSERT(!memcmp(&data[1000], &content[10], 200000));
+    CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  }
+  // the size read at open time bounds the reads, pread and aio_read alike,
+  // even when another client appends to the file. Its removal is noticed
+  createFile(SMALL_LAYOUT "/directremote", content);
+  int rfd = ceph_posix_open(0, SMALL_LAYOUT "/directremote", O_RDONLY, 0);
+  CPPUNIT_ASSERT(rfd >= 0);
+  XrdCephCluster *cluster = g_memBackend.newCluster();
+  CPPUNIT_ASSERT(cluster->init("user") == 0 && cluster->connect() == 0);
+  XrdCephIoCtx *ioctx = 0;
+  CPPUNIT_ASSERT(cluster->ioctx_create("pool", &ioctx) == 0);
+  XrdCephStriper *striper = 0;
+  CPPUNIT_ASSERT(ioctx->striper_create(&striper) == 0);
+  CPPUNIT_ASSERT(striper->set_object_layout_stripe_count(2) == 0);
+  CPPUNIT_ASSERT(striper->set_object_layout_stripe_unit(65536) == 0);
+  CPPUNIT_ASSERT(striper->set_object_layout_object_size(131072) == 0);
+  ceph::bufferlist appended;
+  appended.append(&content[0], 1000);
+  CPPUNIT_ASSERT(striper->write("/directremote", appended, 1000, content.size()) == 0);
+  std::vector<char> remote(1000);
+  CPPUNIT_ASSERT(ceph_posix_pread(rfd, &remote[0], remote.size(), content.size()) == 0);
+  TestAio eof(&remote[0], remote.size(), content.size());
+  CPPUNIT_ASSERT(ceph_aio_read(rfd, &eof, testAioCallback) == 0);
+  eof.wait();
+  CPPUNIT_ASSERT(eof.Result == 0);
+  CPPUNIT_ASSERT(striper->remove("/directremote") == 0);
+  CPPUNIT_ASSERT(ceph_posix_pread(rfd, &remote[0], remote.size(), 0) == -ENOENT);
+  TestAio removed(&remote[0], remote.size(), 0);
+  CPPUNIT_ASSERT(ceph_aio_read(rfd, &removed, testAioCallback) == 0);
+  removed.wait();
+  CPPUNIT_ASSERT(removed.Result == -ENOENT);
+  CPPUNIT_ASSERT(ceph_posix_close(rfd) == 0);
+  delete striper;
+  delete ioctx;
+  cluster->shutdown();
+  delete cluster;
+  // files being written are read through the striper, seeing their new size
+  std::string path = SMALL_LAYOUT "/directwrite";
+  int wfd = ceph_posix_open(0, path.c_str(), O_WRONLY|O_CREAT, 0644);
+  CPPUNIT_ASSERT(wfd >= 0);
+  CPPUNIT_ASSERT(ceph_posix_pwrite(wfd, &content[0], 1000, 0) == 1000);
+  int fd = ceph_posix_open(0, path.c_str(), O_RDONLY, 0);
+  CPPUNIT_ASSERT(fd >= 0);
+  CPPUNIT_ASSERT(ceph_posix_pwrite(wfd, &content[1000], 300000, 1000) == 300000);
+  std::vector<char> data(content.size());
+  CPPUNIT_ASSERT(ceph_posix_pread(fd, &data[0], data.size(), 0) == 301000);
+  CPPUNIT_ASSERT(!memcmp(&data[0], &content[0], 301000));
+  CPPUNIT_ASSERT(ceph_posix_close(wfd) == 0);
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  // nor once written here, even when the writer is gone, so that the new size is seen
+  fd = ceph_posix_open(0, path.c_str(), O_RDONLY, 0);
+  CPPUNIT_ASSERT(fd >= 0);
+  CPPUNIT_ASSERT(ceph_posix_pread(fd, &data[0], data.size(), 0) == 301000);
+  wfd = ceph_posix_open(0, path.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
+  CPPUNIT_ASSERT(wfd >= 0);
+  CPPUNIT_ASSERT(ceph_posix_pwrite(wfd, &content[0], 500000, 0) == 500000);
+  CPPUNIT_ASSERT(ceph_posix_close(wfd) == 0);
+  CPPUNIT_ASSERT(ceph_posix_pread(fd, &data[0], data.size(), 0) == 500000);
+  CPPUNIT_ASSERT(!memcmp(&data[0], &content[0], 500000));
+  CPPUNIT_ASSERT(ceph_posix_truncate(0, path.c_str(), 200000) == 0);
+  CPPUNIT_ASSERT(ceph_posix_pread(fd, &data[0], data.size(), 0) == 200000);
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  fd = ceph_posix_open(0, path.c_str(), O_RDONLY, 0);
+  CPPUNIT_ASSERT(fd >= 0);
+  CPPUNIT_ASSERT(ceph_posix_truncate(0, path.c_str(), 100000) == 0);
+  CPPUNIT_ASSERT(ceph_posix_pread(fd, &data[0], data.size(), 0) == 100000);
+  CPPUNIT_ASSERT(ceph_posix_close(fd) == 0);
+  g_cephDirectRead = false;
+}